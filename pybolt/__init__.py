@@ -54,7 +54,8 @@ _seabolt.BoltConnection_open_b.restype = POINTER(_BoltConnection)
 class _BoltValue(Structure):
 
     _fields_ = [
-        ("type", c_int16),
+        ("type", c_int8),
+        ("flags", c_uint8),
         ("code", c_int16),
         ("size", c_int32),
         ("data_size", c_size_t),
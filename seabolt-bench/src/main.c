@@ -0,0 +1,650 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "binding.h"
+#include "compact.h"
+#include "connect.h"
+#include "mem.h"
+#include "pack.h"
+#include "tape.h"
+#include "values.h"
+#include "buffer.h"
+#include "protocol/v1.h"
+
+
+#define DEFAULT_RECORD_COUNT 1000000
+#define MAX_RETAINED_RECORDS 100000
+#define ITERATION_PASSES 10
+
+
+/**
+ * A connection with Bolt v1 state but no socket. Messages are placed
+ * directly into the dechunked receive buffer, so only the decoder is
+ * measured.
+ */
+struct BoltConnection* Bench_offline_connection(struct BoltAllocator* allocator)
+{
+    struct BoltConnection* connection = BoltMem_allocate(sizeof(struct BoltConnection));
+    memset(connection, 0, sizeof(struct BoltConnection));
+    connection->allocator = allocator;
+    connection->protocol_version = 1;
+    connection->protocol_state = BoltProtocolV1_create_state(allocator);
+    return connection;
+}
+
+void Bench_destroy_offline_connection(struct BoltConnection* connection)
+{
+    BoltProtocolV1_destroy_state(BoltProtocolV1_state(connection));
+    BoltMem_deallocate(connection, sizeof(struct BoltConnection));
+}
+
+void Bench_load_string(struct BoltBuffer* buffer, const char* string)
+{
+    size_t size = strlen(string);
+    if (size < 0x10)
+    {
+        BoltBuffer_load_uint8(buffer, (uint8_t)(0x80 + size));
+    }
+    else
+    {
+        BoltBuffer_load_uint8(buffer, 0xD0);
+        BoltBuffer_load_uint8(buffer, (uint8_t)(size));
+    }
+    BoltBuffer_load(buffer, string, (int)(size));
+}
+
+/**
+ * Load a representative RECORD message: a node-like structure with
+ * labels and properties, followed by a handful of scalar columns.
+ */
+void Bench_load_record(struct BoltBuffer* buffer, int64_t id)
+{
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x95);
+    // Node(id, ["Person", "Employee"], {...})
+    BoltBuffer_load_uint8(buffer, 0xB3);
+    BoltBuffer_load_uint8(buffer, 'N');
+    BoltBuffer_load_uint8(buffer, 0xCA);
+    BoltBuffer_load_int32_be(buffer, (int32_t)(id));
+    BoltBuffer_load_uint8(buffer, 0x92);
+    Bench_load_string(buffer, "Person");
+    Bench_load_string(buffer, "Employee");
+    BoltBuffer_load_uint8(buffer, 0xA4);
+    Bench_load_string(buffer, "name");
+    Bench_load_string(buffer, "Alice Wonderland-Smith");
+    Bench_load_string(buffer, "born");
+    BoltBuffer_load_uint8(buffer, 0xC9);
+    BoltBuffer_load_int16_be(buffer, 1970);
+    Bench_load_string(buffer, "email_address");
+    Bench_load_string(buffer, "alice@example.com");
+    Bench_load_string(buffer, "score");
+    BoltBuffer_load_uint8(buffer, 0xC1);
+    BoltBuffer_load_double_be(buffer, 0.75);
+    // scalar columns
+    BoltBuffer_load_uint8(buffer, 0xCB);
+    BoltBuffer_load_int64_be(buffer, id);
+    BoltBuffer_load_uint8(buffer, 0xC3);
+    Bench_load_string(buffer, "a description that is too long to be held inline");
+    BoltBuffer_load_uint8(buffer, 0x93);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0x02);
+    BoltBuffer_load_uint8(buffer, 0x03);
+}
+
+double Bench_seconds(struct timespec* t0, struct timespec* t1)
+{
+    return (double)(t1->tv_sec - t0->tv_sec) + (double)(t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/**
+ * Decode `n` records on an offline connection, returning the elapsed time.
+ */
+double Bench_decode(struct BoltConnection* connection, long n)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer* message = BoltBuffer_create(NULL, 256);
+    Bench_load_record(message, 1);
+    int size = BoltBuffer_unloadable(message);
+    const char* data = BoltBuffer_unload_target(message, size);
+    struct timespec t[2];
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        BoltBuffer_compact(state->rx_buffer);
+        BoltBuffer_load(state->rx_buffer, data, size);
+        BoltProtocolV1_unload(connection);
+    }
+    timespec_get(&t[1], TIME_UTC);
+    BoltBuffer_destroy(message);
+    return Bench_seconds(&t[0], &t[1]);
+}
+
+void Bench_allocator(struct BoltAllocator* allocator, int use_arena, long n)
+{
+    struct BoltConnection* connection = Bench_offline_connection(allocator);
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltArena* arena = state->fetched_arena;
+    if (!use_arena)
+    {
+        state->fetched_arena = NULL;
+    }
+    // values nested within the fetched slot come from the installed allocator
+    BoltMem_set_allocator(allocator);
+    long long events = allocator->stats.allocation_events;
+    size_t peak = allocator->stats.peak_allocation;
+    double seconds = Bench_decode(connection, n);
+    events = allocator->stats.allocation_events - events;
+    peak = allocator->stats.peak_allocation > peak ? allocator->stats.peak_allocation : peak;
+    BoltValue_to_Null(state->fetched);
+    BoltMem_set_allocator(NULL);
+    state->fetched_arena = arena;
+    Bench_destroy_offline_connection(connection);
+    printf("%-10s %-8s %12.1f %14.0f %16lld %12zu\n", allocator->name, use_arena ? "arena" : "heap",
+           1e9 * seconds / n, n / seconds, events, peak);
+}
+
+int Bench_on_int(void* context, int64_t x)
+{
+    *(int64_t*)(context) += x;
+    return 0;
+}
+
+int Bench_on_string(void* context, const char* string, int32_t size)
+{
+    *(int64_t*)(context) += size + string[0];
+    return 0;
+}
+
+/**
+ * Deliver `n` records as events to a handler summing their integers and
+ * string sizes, in place of decoding them.
+ */
+void Bench_events(long n)
+{
+    struct BoltConnection* connection = Bench_offline_connection(NULL);
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer* message = BoltBuffer_create(NULL, 256);
+    Bench_load_record(message, 1);
+    int size = BoltBuffer_unloadable(message);
+    const char* data = BoltBuffer_unload_target(message, size);
+    struct BoltEventHandler handler;
+    memset(&handler, 0, sizeof(handler));
+    handler.on_int = Bench_on_int;
+    handler.on_string = Bench_on_string;
+    int64_t checksum = 0;
+    long long events = BoltMem_allocation_events();
+    struct timespec t[2];
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        BoltBuffer_compact(state->rx_buffer);
+        BoltBuffer_load(state->rx_buffer, data, size);
+        BoltProtocolV1_unload_events(connection, &handler, &checksum);
+    }
+    timespec_get(&t[1], TIME_UTC);
+    events = BoltMem_allocation_events() - events;
+    double seconds = Bench_seconds(&t[0], &t[1]);
+    BoltBuffer_destroy(message);
+    Bench_destroy_offline_connection(connection);
+    printf("%-10s %-8s %12.1f %14.0f %16lld %12s\n", "-", "events", 1e9 * seconds / n, n / seconds, events, "-");
+}
+
+struct BenchRow
+{
+    int64_t id;
+    char active;
+    char description[64];
+    uint64_t nulls;
+};
+
+/**
+ * Decode the scalar columns of `n` records straight into a row struct,
+ * skipping the node, in place of decoding them.
+ */
+void Bench_bound(long n)
+{
+    struct BoltConnection* connection = Bench_offline_connection(NULL);
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer* message = BoltBuffer_create(NULL, 256);
+    Bench_load_record(message, 1);
+    int size = BoltBuffer_unloadable(message);
+    const char* data = BoltBuffer_unload_target(message, size);
+    const struct BoltFieldBinding fields[] = {
+            BOLT_FIELD(1, BOLT_INT64, struct BenchRow, id),
+            BOLT_FIELD(2, BOLT_BIT, struct BenchRow, active),
+            BOLT_FIELD(3, BOLT_STRING8, struct BenchRow, description),
+    };
+    struct BoltRowBinding* binding = BoltRowBinding_create(fields, 3, sizeof(struct BenchRow),
+                                                           offsetof(struct BenchRow, nulls));
+    struct BenchRow row;
+    int64_t checksum = 0;
+    long long events = BoltMem_allocation_events();
+    struct timespec t[2];
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        BoltBuffer_compact(state->rx_buffer);
+        BoltBuffer_load(state->rx_buffer, data, size);
+        BoltRowBinding_unload(binding, connection, &row);
+        checksum += row.id + row.description[0];
+    }
+    timespec_get(&t[1], TIME_UTC);
+    events = BoltMem_allocation_events() - events;
+    double seconds = Bench_seconds(&t[0], &t[1]);
+    BoltRowBinding_destroy(binding);
+    BoltBuffer_destroy(message);
+    Bench_destroy_offline_connection(connection);
+    printf("%-10s %-8s %12.1f %14.0f %16lld %12s\n", "-", "bound", 1e9 * seconds / n, n / seconds, events, "-");
+}
+
+void Bench_allocators(long n)
+{
+    printf("== decode path, by allocator (%ld records)\n", n);
+    printf("%-10s %-8s %12s %14s %16s %12s\n", "allocator", "storage", "ns/record", "records/s", "alloc events", "peak bytes");
+    struct BoltAllocator* slab = BoltMem_create_slab_allocator(256, 4096);
+    for (int use_arena = 0; use_arena <= 1; use_arena++)
+    {
+        Bench_allocator(BoltMem_system_allocator(), use_arena, n);
+        Bench_allocator(slab, use_arena, n);
+    }
+    BoltMem_destroy_slab_allocator(slab);
+    Bench_events(n);
+    Bench_bound(n);
+}
+
+/**
+ * Visit every value in a tree, returning a checksum so that the walk
+ * cannot be optimised away.
+ */
+int64_t Bench_walk(const struct BoltValue* value)
+{
+    switch (BoltValue_type(value))
+    {
+        case BOLT_INT64:
+            return BoltInt64_get(value);
+        case BOLT_STRING8:
+            return value->size + BoltString8_get((struct BoltValue*)(value))[0];
+        case BOLT_LIST:
+        case BOLT_STRUCTURE:
+        {
+            int64_t sum = 0;
+            for (int i = 0; i < value->size; i++)
+            {
+                sum += Bench_walk(BoltValue_type(value) == BOLT_LIST ? BoltList_value(value, i) :
+                                  BoltStructure_value(value, i));
+            }
+            return sum;
+        }
+        case BOLT_DICTIONARY8:
+        {
+            int64_t sum = 0;
+            for (int i = 0; i < value->size; i++)
+            {
+                sum += Bench_walk(BoltDictionary8_key((struct BoltValue*)(value), i)) +
+                       Bench_walk(BoltDictionary8_value((struct BoltValue*)(value), i));
+            }
+            return sum;
+        }
+        default:
+            return 1;
+    }
+}
+
+int64_t Bench_walk_compact(const struct BoltCompactValue* value)
+{
+    switch (BoltCompactValue_type(value))
+    {
+        case BOLT_INT64:
+            return BoltCompactInt64_get(value);
+        case BOLT_STRING8:
+            return value->size + BoltCompactString8_get(value)[0];
+        case BOLT_LIST:
+        case BOLT_STRUCTURE:
+        {
+            int64_t sum = 0;
+            for (int i = 0; i < value->size; i++)
+            {
+                sum += Bench_walk_compact(BoltCompactValue_type(value) == BOLT_LIST ? BoltCompactList_value(value, i) :
+                                          BoltCompactStructure_value(value, i));
+            }
+            return sum;
+        }
+        case BOLT_DICTIONARY8:
+        {
+            int64_t sum = 0;
+            for (int i = 0; i < value->size; i++)
+            {
+                sum += Bench_walk_compact(BoltCompactDictionary8_key(value, i)) +
+                       Bench_walk_compact(BoltCompactDictionary8_value(value, i));
+            }
+            return sum;
+        }
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Visit every value on a tape in one pass from start to end, returning
+ * the same checksum as `Bench_walk` over the equivalent trees.
+ */
+int64_t Bench_walk_tape(const struct BoltTape* tape)
+{
+    int64_t sum = 0;
+    for (int32_t i = 0; i < tape->n_tokens; i++)
+    {
+        switch (BoltTape_type(tape, i))
+        {
+            case BOLT_INT64:
+                sum += BoltTape_int64(tape, i);
+                break;
+            case BOLT_STRING8:
+                sum += BoltTape_size(tape, i) + BoltTape_data(tape, i)[0];
+                break;
+            case BOLT_LIST:
+            case BOLT_DICTIONARY8:
+            case BOLT_STRUCTURE:
+                break;
+            default:
+                sum += 1;
+        }
+    }
+    return sum;
+}
+
+/**
+ * Decode and retain `n` records, as individually allocated BoltValue
+ * trees, as compact copies and on a single tape, then walk all of them.
+ */
+void Bench_layouts(long n)
+{
+    if (n > MAX_RETAINED_RECORDS) n = MAX_RETAINED_RECORDS;
+    printf("== retained records, by layout (%ld records, %d iteration passes)\n", n, ITERATION_PASSES);
+    printf("%-10s %16s %16s %14s %16s\n", "layout", "decode ns/rec", "iterate ns/rec", "bytes/record", "checksum");
+    struct BoltConnection* connection = Bench_offline_connection(NULL);
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer* message = BoltBuffer_create(NULL, 256);
+    Bench_load_record(message, 1);
+    int size = BoltBuffer_unloadable(message);
+    const char* data = BoltBuffer_unload_target(message, size);
+    struct timespec t[3];
+
+    // BoltValue: decode each record straight into a tree of its own
+    struct BoltValue** records = malloc(n * sizeof(struct BoltValue*));
+    struct BoltValue* fetched = state->fetched;
+    struct BoltArena* arena = state->fetched_arena;
+    state->fetched_arena = NULL;
+    size_t memory = BoltMem_current_allocation();
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        BoltBuffer_compact(state->rx_buffer);
+        BoltBuffer_load(state->rx_buffer, data, size);
+        records[i] = state->fetched = BoltValue_create();
+        BoltProtocolV1_unload(connection);
+    }
+    timespec_get(&t[1], TIME_UTC);
+    memory = BoltMem_current_allocation() - memory;
+    int64_t checksum = 0;
+    for (int pass = 0; pass < ITERATION_PASSES; pass++)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            checksum += Bench_walk(records[i]);
+        }
+    }
+    timespec_get(&t[2], TIME_UTC);
+    printf("%-10s %16.1f %16.1f %14.1f %16lld\n", "BoltValue", 1e9 * Bench_seconds(&t[0], &t[1]) / n,
+           1e9 * Bench_seconds(&t[1], &t[2]) / (n * ITERATION_PASSES), (double)(memory) / n, (long long)(checksum));
+    for (long i = 0; i < n; i++)
+    {
+        BoltValue_destroy(records[i]);
+    }
+    free(records);
+    state->fetched = fetched;
+    state->fetched_arena = arena;
+
+    // Compact: decode into the arena, then keep a compact copy
+    const struct BoltCompactValue** compact_records = malloc(n * sizeof(struct BoltCompactValue*));
+    memory = BoltMem_current_allocation();
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        BoltBuffer_compact(state->rx_buffer);
+        BoltBuffer_load(state->rx_buffer, data, size);
+        BoltProtocolV1_unload(connection);
+        compact_records[i] = BoltCompactValue_create(state->fetched);
+    }
+    timespec_get(&t[1], TIME_UTC);
+    memory = BoltMem_current_allocation() - memory;
+    checksum = 0;
+    for (int pass = 0; pass < ITERATION_PASSES; pass++)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            checksum += Bench_walk_compact(compact_records[i]);
+        }
+    }
+    timespec_get(&t[2], TIME_UTC);
+    printf("%-10s %16.1f %16.1f %14.1f %16lld\n", "compact", 1e9 * Bench_seconds(&t[0], &t[1]) / n,
+           1e9 * Bench_seconds(&t[1], &t[2]) / (n * ITERATION_PASSES), (double)(memory) / n, (long long)(checksum));
+    for (long i = 0; i < n; i++)
+    {
+        BoltCompactValue_destroy(compact_records[i]);
+    }
+    free(compact_records);
+
+    // Tape: decode every record onto the end of a single tape
+    memory = BoltMem_current_allocation();
+    timespec_get(&t[0], TIME_UTC);
+    struct BoltTape* tape = BoltTape_create();
+    for (long i = 0; i < n; i++)
+    {
+        BoltBuffer_compact(state->rx_buffer);
+        BoltBuffer_load(state->rx_buffer, data, size);
+        BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape);
+    }
+    timespec_get(&t[1], TIME_UTC);
+    memory = BoltMem_current_allocation() - memory;
+    checksum = 0;
+    for (int pass = 0; pass < ITERATION_PASSES; pass++)
+    {
+        checksum += Bench_walk_tape(tape);
+    }
+    timespec_get(&t[2], TIME_UTC);
+    printf("%-10s %16.1f %16.1f %14.1f %16lld\n", "tape", 1e9 * Bench_seconds(&t[0], &t[1]) / n,
+           1e9 * Bench_seconds(&t[1], &t[2]) / (n * ITERATION_PASSES), (double)(memory) / n, (long long)(checksum));
+    BoltTape_destroy(tape);
+
+    BoltBuffer_destroy(message);
+    Bench_destroy_offline_connection(connection);
+}
+
+#define BENCH_STATEMENT "MATCH (p:Person)-[:LIVES_IN]->(c:City) WHERE p.age >= $minimum_age AND c.name = $city_name " \
+                        "RETURN p.name, p.age ORDER BY p.age DESC LIMIT $limit"
+
+enum BenchRequestMode
+{
+    BENCH_TEMPLATE,     // statement and keys set for every request
+    BENCH_REUSED,       // statement and keys set once, only values set per request
+    BENCH_PREPARED,     // prepared statement
+    BENCH_PACKED,       // parameters written straight into the request
+};
+
+static const char* BENCH_KEYS[] = {"minimum_age", "city_name", "limit"};
+
+void Bench_set_values(struct BoltValue* values[3], long i)
+{
+    BoltValue_to_Int64(values[0], 18 + i % 50);
+    BoltValue_to_String8(values[1], "Gothenburg", 10);
+    BoltValue_to_Int64(values[2], 100);
+}
+
+void Bench_request(enum BenchRequestMode mode, long n)
+{
+    const char* names[] = {"template", "reused", "prepared", "packed"};
+    struct BoltConnection* connection = Bench_offline_connection(NULL);
+    connection->tx_buffer = BoltBuffer_create(NULL, 1024);
+    struct BoltPreparedStatement* prepared = NULL;
+    struct BoltValue* values[3];
+    if (mode == BENCH_PREPARED)
+    {
+        prepared = BoltConnection_prepare(connection, BENCH_STATEMENT, strlen(BENCH_STATEMENT), 3);
+        for (int32_t j = 0; j < 3; j++)
+        {
+            BoltPreparedStatement_set_parameter_key(prepared, j, BENCH_KEYS[j], strlen(BENCH_KEYS[j]));
+            values[j] = BoltPreparedStatement_parameter_value(prepared, j);
+        }
+    }
+    size_t size = 0;
+    struct timespec t[2];
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        if (mode == BENCH_TEMPLATE || (mode == BENCH_REUSED && i == 0))
+        {
+            BoltConnection_set_cypher_template(connection, BENCH_STATEMENT, strlen(BENCH_STATEMENT));
+            BoltConnection_set_n_cypher_parameters(connection, 3);
+            for (int32_t j = 0; j < 3; j++)
+            {
+                BoltConnection_set_cypher_parameter_key(connection, j, BENCH_KEYS[j], strlen(BENCH_KEYS[j]));
+                values[j] = BoltConnection_cypher_parameter_value(connection, j);
+            }
+        }
+        if (mode == BENCH_PACKED)
+        {
+            struct BoltPackWriter writer;
+            BoltPackWriter_begin_run_request(&writer, connection, BENCH_STATEMENT, strlen(BENCH_STATEMENT), 3);
+            BoltPackWriter_write_entry(&writer, BENCH_KEYS[0], 18 + i % 50);
+            BoltPackWriter_write_entry(&writer, BENCH_KEYS[1], "Gothenburg");
+            BoltPackWriter_write_entry(&writer, BENCH_KEYS[2], 100);
+            BoltPackWriter_end(&writer);
+        }
+        else if (mode == BENCH_PREPARED)
+        {
+            Bench_set_values(values, i);
+            BoltConnection_load_prepared_run_request(connection, prepared);
+        }
+        else
+        {
+            Bench_set_values(values, i);
+            BoltConnection_load_run_request(connection);
+        }
+        // discard the request, as if sent
+        int request_size = BoltBuffer_unloadable(connection->tx_buffer);
+        BoltBuffer_unload_target(connection->tx_buffer, request_size);
+        BoltBuffer_compact(connection->tx_buffer);
+        size += request_size;
+    }
+    timespec_get(&t[1], TIME_UTC);
+    double seconds = Bench_seconds(&t[0], &t[1]);
+    printf("%-10s %12.1f %14.0f %14.1f\n", names[mode], 1e9 * seconds / n, n / seconds, (double)(size) / n);
+    if (prepared != NULL)
+    {
+        BoltPreparedStatement_destroy(prepared);
+    }
+    BoltBuffer_destroy(connection->tx_buffer);
+    Bench_destroy_offline_connection(connection);
+}
+
+#define BENCH_IDS_STATEMENT "MATCH (p:Person) WHERE id(p) IN $ids RETURN p"
+#define BENCH_ID_COUNT 10000
+
+void Bench_large_request(int frozen, long n)
+{
+    struct BoltConnection* connection = Bench_offline_connection(NULL);
+    connection->tx_buffer = BoltBuffer_create(NULL, 1024);
+    BoltConnection_set_cypher_template(connection, BENCH_IDS_STATEMENT, strlen(BENCH_IDS_STATEMENT));
+    BoltConnection_set_n_cypher_parameters(connection, 1);
+    BoltConnection_set_cypher_parameter_key(connection, 0, "ids", 3);
+    struct BoltValue* ids = BoltConnection_cypher_parameter_value(connection, 0);
+    BoltValue_to_List(ids, BENCH_ID_COUNT);
+    for (int32_t i = 0; i < BENCH_ID_COUNT; i++)
+    {
+        BoltValue_to_Int64(BoltList_value(ids, i), 1000003LL * i);
+    }
+    if (frozen)
+    {
+        BoltValue_freeze(ids);
+    }
+    size_t size = 0;
+    struct timespec t[2];
+    timespec_get(&t[0], TIME_UTC);
+    for (long i = 0; i < n; i++)
+    {
+        BoltConnection_load_run_request(connection);
+        // discard the request, as if sent
+        int request_size = BoltBuffer_unloadable(connection->tx_buffer);
+        BoltBuffer_unload_target(connection->tx_buffer, request_size);
+        BoltBuffer_compact(connection->tx_buffer);
+        size += request_size;
+    }
+    timespec_get(&t[1], TIME_UTC);
+    double seconds = Bench_seconds(&t[0], &t[1]);
+    printf("%-10s %12.1f %14.0f %14.1f\n", frozen ? "frozen" : "list", 1e9 * seconds / n, n / seconds,
+           (double)(size) / n);
+    BoltBuffer_destroy(connection->tx_buffer);
+    Bench_destroy_offline_connection(connection);
+}
+
+void Bench_requests(long n)
+{
+    printf("== RUN request encoding, by method (%ld requests)\n", n);
+    printf("%-10s %12s %14s %14s\n", "method", "ns/request", "requests/s", "bytes/request");
+    Bench_request(BENCH_TEMPLATE, n);
+    Bench_request(BENCH_REUSED, n);
+    Bench_request(BENCH_PREPARED, n);
+    Bench_request(BENCH_PACKED, n);
+    long large_n = n / 100 > 0 ? n / 100 : 1;
+    printf("== RUN request encoding, %d id parameter (%ld requests)\n", BENCH_ID_COUNT, large_n);
+    printf("%-10s %12s %14s %14s\n", "parameter", "ns/request", "requests/s", "bytes/request");
+    Bench_large_request(0, large_n);
+    Bench_large_request(1, large_n);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* suite = argc >= 2 ? argv[1] : "all";
+    long n = argc >= 3 ? strtol(argv[2], NULL, 10) : DEFAULT_RECORD_COUNT;
+    if (n <= 0)
+    {
+        fprintf(stderr, "usage: %s [all|allocators|layouts|requests] [record count]\n", argv[0]);
+        return 1;
+    }
+    int all = strcmp(suite, "all") == 0;
+    if (all || strcmp(suite, "allocators") == 0)
+    {
+        Bench_allocators(n);
+    }
+    if (all || strcmp(suite, "layouts") == 0)
+    {
+        Bench_layouts(n);
+    }
+    if (all || strcmp(suite, "requests") == 0)
+    {
+        Bench_requests(n);
+    }
+    return 0;
+}
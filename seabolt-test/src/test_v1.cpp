@@ -0,0 +1,2297 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+#include <memory.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "catch.hpp"
+
+extern "C" {
+    #include "arena.h"
+    #include "connect.h"
+    #include "mem.h"
+    #include "values.h"
+    #include "buffer.h"
+    #include "intern.h"
+    #include "reader.h"
+    #include "binding.h"
+    #include "bulk.h"
+    #include "pack.h"
+    #include "packstream.h"
+    #include "tape.h"
+    #include "graph.h"
+    #include "protocol/v1.h"
+}
+
+
+/**
+ * Create a connection with Bolt v1 state but no socket, so that
+ * messages can be placed directly in the dechunked receive buffer.
+ */
+struct BoltConnection* _offline_connection()
+{
+    struct BoltConnection* connection = (struct BoltConnection*)(BoltMem_allocate(sizeof(struct BoltConnection)));
+    memset(connection, 0, sizeof(struct BoltConnection));
+    connection->protocol_version = 1;
+    connection->protocol_state = BoltProtocolV1_create_state(NULL);
+    return connection;
+}
+
+void _destroy_offline_connection(struct BoltConnection* connection)
+{
+    BoltProtocolV1_destroy_state(BoltProtocolV1_state(connection));
+    BoltMem_deallocate(connection, sizeof(struct BoltConnection));
+}
+
+void _load_string(struct BoltBuffer* buffer, const char* string)
+{
+    size_t size = strlen(string);
+    if (size < 0x10)
+    {
+        BoltBuffer_load_uint8(buffer, (uint8_t)(0x80 + size));
+    }
+    else
+    {
+        BoltBuffer_load_uint8(buffer, 0xD0);
+        BoltBuffer_load_uint8(buffer, (uint8_t)(size));
+    }
+    BoltBuffer_load(buffer, string, (int)(size));
+}
+
+/**
+ * RECORD [1, "<long string>", {"key": [1, 2]}]
+ */
+void _load_record(struct BoltBuffer* buffer)
+{
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x93);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    _load_string(buffer, "a string too long to fit inline");
+    BoltBuffer_load_uint8(buffer, 0xA1);
+    _load_string(buffer, "key");
+    BoltBuffer_load_uint8(buffer, 0x92);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0x02);
+}
+
+/**
+ * RECORD [Node(1, ["Person"], {"name": "Alice", "a key too long to fit inline": 1})]
+ */
+void _load_node_record(struct BoltBuffer* buffer)
+{
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x91);
+    BoltBuffer_load_uint8(buffer, 0xB3);
+    BoltBuffer_load_uint8(buffer, 'N');
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0x91);
+    _load_string(buffer, "Person");
+    BoltBuffer_load_uint8(buffer, 0xA2);
+    _load_string(buffer, "name");
+    _load_string(buffer, "Alice");
+    _load_string(buffer, "a key too long to fit inline");
+    BoltBuffer_load_uint8(buffer, 0x01);
+}
+
+SCENARIO("Test record decoding")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        WHEN("a record is received")
+        {
+            _load_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            struct BoltValue* fetched = BoltConnection_fetched(connection);
+            THEN("the record fields should be decoded")
+            {
+                REQUIRE(BoltValue_type(fetched) == BOLT_LIST);
+                REQUIRE(fetched->size == 3);
+                REQUIRE(BoltInt64_get(BoltList_value(fetched, 0)) == 1);
+                struct BoltValue* string = BoltList_value(fetched, 1);
+                REQUIRE(BoltValue_type(string) == BOLT_STRING8);
+                REQUIRE(strncmp(BoltString8_get(string), "a string too long to fit inline", (size_t)(string->size)) == 0);
+                struct BoltValue* map = BoltList_value(fetched, 2);
+                REQUIRE(BoltValue_type(map) == BOLT_DICTIONARY8);
+                REQUIRE(strncmp(BoltString8_get(BoltDictionary8_key(map, 0)), "key", 3) == 0);
+                REQUIRE(BoltInt64_get(BoltList_value(BoltDictionary8_value(map, 0), 1)) == 2);
+            }
+        }
+        WHEN("a record is taken and another received")
+        {
+            _load_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            struct BoltValue* taken = BoltConnection_take_fetched(connection);
+            BoltBuffer_compact(state->rx_buffer);
+            _load_node_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            THEN("the taken record should be unaffected")
+            {
+                REQUIRE(BoltValue_type(taken) == BOLT_LIST);
+                REQUIRE(taken->size == 3);
+                REQUIRE((taken->flags & BOLT_VALUE_ARENA_OWNER) == BOLT_VALUE_ARENA_OWNER);
+                struct BoltValue* string = BoltList_value(taken, 1);
+                REQUIRE(strncmp(BoltString8_get(string), "a string too long to fit inline", (size_t)(string->size)) == 0);
+                struct BoltValue* key = BoltDictionary8_key(BoltList_value(taken, 2), 0);
+                REQUIRE((key->flags & BOLT_VALUE_INTERNED) == 0);
+                REQUIRE(strncmp(BoltString8_get(key), "key", 3) == 0);
+            }
+            BoltValue_destroy(taken);
+        }
+        WHEN("a record is taken")
+        {
+            _load_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            struct BoltArena* arena = state->fetched_arena;
+            long long events = BoltMem_allocation_events();
+            struct BoltValue* taken = BoltConnection_take_fetched(connection);
+            THEN("its arena should be handed over rather than its contents copied")
+            {
+                // One allocation for the value, and two for the fresh arena
+                REQUIRE(BoltMem_allocation_events() == events + 3);
+                REQUIRE(state->fetched_arena != arena);
+                REQUIRE(taken->data.as_ptr[1] == arena);
+                REQUIRE(BoltValue_type(BoltConnection_fetched(connection)) == BOLT_NULL);
+                struct BoltValue* key = BoltDictionary8_key(BoltList_value(taken, 2), 0);
+                REQUIRE((key->flags & BOLT_VALUE_INTERNED) == 0);
+                REQUIRE(strncmp(BoltString8_get(key), "key", 3) == 0);
+            }
+            AND_WHEN("it is then resized")
+            {
+                BoltList_resize(taken, 4);
+                THEN("it should own a copy of its contents instead")
+                {
+                    REQUIRE((taken->flags & BOLT_VALUE_UNOWNED) == 0);
+                    struct BoltValue* string = BoltList_value(taken, 1);
+                    REQUIRE(strncmp(BoltString8_get(string), "a string too long to fit inline", (size_t)(string->size)) == 0);
+                    REQUIRE(BoltValue_type(BoltList_value(taken, 3)) == BOLT_NULL);
+                }
+            }
+            BoltValue_destroy(taken);
+        }
+        WHEN("many records are received in succession")
+        {
+            _load_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            long long events = BoltMem_allocation_events();
+            for (int i = 0; i < 100; i++)
+            {
+                _load_record(state->rx_buffer);
+                BoltProtocolV1_unload(connection);
+            }
+            THEN("no further memory should be allocated or freed")
+            {
+                REQUIRE(BoltMem_allocation_events() == events);
+                REQUIRE(BoltValue_type(BoltConnection_fetched(connection)) == BOLT_LIST);
+            }
+        }
+        _destroy_offline_connection(connection);
+    }
+}
+
+SCENARIO("Test key interning")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        WHEN("the same keys and labels are received twice")
+        {
+            _load_node_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            struct BoltValue* node = BoltList_value(BoltConnection_fetched(connection), 0);
+            const char* label = BoltString8_get(BoltList_value(BoltStructure_value(node, 1), 0));
+            struct BoltValue* properties = BoltStructure_value(node, 2);
+            const char* short_key = BoltString8_get(BoltDictionary8_key(properties, 0));
+            const char* long_key = BoltString8_get(BoltDictionary8_key(properties, 1));
+            BoltBuffer_compact(state->rx_buffer);
+            _load_node_record(state->rx_buffer);
+            BoltProtocolV1_unload(connection);
+            node = BoltList_value(BoltConnection_fetched(connection), 0);
+            properties = BoltStructure_value(node, 2);
+            THEN("both occurrences should share the same storage")
+            {
+                struct BoltValue* labels = BoltStructure_value(node, 1);
+                REQUIRE(BoltString8_get(BoltList_value(labels, 0)) == label);
+                REQUIRE(BoltString8_get(BoltDictionary8_key(properties, 0)) == short_key);
+                REQUIRE(BoltString8_get(BoltDictionary8_key(properties, 1)) == long_key);
+                REQUIRE(strncmp(long_key, "a key too long to fit inline", 28) == 0);
+                REQUIRE(state->interned_keys->count == 3);
+            }
+            THEN("interned keys should carry the hash of their contents")
+            {
+                struct BoltValue* key = BoltDictionary8_key(properties, 1);
+                REQUIRE((key->flags & BOLT_VALUE_INTERNED) != 0);
+                REQUIRE(BoltString8_hash(key) == BoltString8_hash_of("a key too long to fit inline", 28));
+            }
+            THEN("values should not be interned")
+            {
+                struct BoltValue* name = BoltDictionary8_value(properties, 0);
+                REQUIRE((name->flags & BOLT_VALUE_INTERNED) == 0);
+                REQUIRE(strncmp(BoltString8_get(name), "Alice", 5) == 0);
+            }
+        }
+        _destroy_offline_connection(connection);
+    }
+}
+
+SCENARIO("Test string and byte array views")
+{
+    GIVEN("an offline connection with views enabled")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        REQUIRE(BoltConnection_set_view_threshold(connection, 20) == 0);
+        WHEN("a record with a long string and a byte array is received")
+        {
+            // RECORD ["<long string>", "short", #000102...]
+            BoltBuffer_load_uint8(state->rx_buffer, 0xB1);
+            BoltBuffer_load_uint8(state->rx_buffer, 0x71);
+            BoltBuffer_load_uint8(state->rx_buffer, 0x93);
+            _load_string(state->rx_buffer, "a string too long to fit inline");
+            _load_string(state->rx_buffer, "short");
+            BoltBuffer_load_uint8(state->rx_buffer, 0xCC);
+            BoltBuffer_load_uint8(state->rx_buffer, 32);
+            for (int i = 0; i < 32; i++)
+            {
+                BoltBuffer_load_uint8(state->rx_buffer, (uint8_t)(i));
+            }
+            const char* data = state->rx_buffer->data;
+            BoltProtocolV1_unload(connection);
+            struct BoltValue* fetched = BoltConnection_fetched(connection);
+            struct BoltValue* string = BoltList_value(fetched, 0);
+            struct BoltValue* bytes = BoltList_value(fetched, 2);
+            THEN("values above the threshold should refer to the receive buffer")
+            {
+                REQUIRE(BoltValue_type(string) == BOLT_STRING8);
+                REQUIRE((string->flags & BOLT_VALUE_VIEW) != 0);
+                REQUIRE(BoltString8_get(string) == data + 5);
+                REQUIRE(BoltValue_type(bytes) == BOLT_BYTE_ARRAY);
+                REQUIRE((bytes->flags & BOLT_VALUE_VIEW) != 0);
+                REQUIRE(bytes->size == 32);
+                REQUIRE(BoltByteArray_get(bytes, 31) == 31);
+            }
+            THEN("values below the threshold should be copied")
+            {
+                struct BoltValue* short_string = BoltList_value(fetched, 1);
+                REQUIRE((short_string->flags & BOLT_VALUE_VIEW) == 0);
+                REQUIRE(strncmp(BoltString8_get(short_string), "short", 5) == 0);
+            }
+            THEN("materialised copies should outlive the receive buffer")
+            {
+                struct BoltValue* copy = BoltValue_create();
+                REQUIRE(BoltValue_materialise(string, copy) == 0);
+                BoltBuffer_compact(state->rx_buffer);
+                _load_record(state->rx_buffer);
+                BoltProtocolV1_unload(connection);
+                REQUIRE((copy->flags & BOLT_VALUE_VIEW) == 0);
+                REQUIRE(copy->size == 31);
+                REQUIRE(strncmp(BoltString8_get(copy), "a string too long to fit inline", 31) == 0);
+                BoltValue_destroy(copy);
+            }
+        }
+        _destroy_offline_connection(connection);
+    }
+}
+
+SCENARIO("Test keyed lookup in received maps")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        WHEN("a record with a wide map is received")
+        {
+            // RECORD [{"key_0": 0, ..., "key_19": 19}]
+            BoltBuffer_load_uint8(state->rx_buffer, 0xB1);
+            BoltBuffer_load_uint8(state->rx_buffer, 0x71);
+            BoltBuffer_load_uint8(state->rx_buffer, 0x91);
+            BoltBuffer_load_uint8(state->rx_buffer, 0xD8);
+            BoltBuffer_load_uint8(state->rx_buffer, 20);
+            char key[16];
+            for (int i = 0; i < 20; i++)
+            {
+                snprintf(key, sizeof(key), "key_%d", i);
+                _load_string(state->rx_buffer, key);
+                BoltBuffer_load_uint8(state->rx_buffer, (uint8_t)(i));
+            }
+            BoltProtocolV1_unload(connection);
+            struct BoltValue* map = BoltList_value(BoltConnection_fetched(connection), 0);
+            THEN("values should be found by key")
+            {
+                REQUIRE(BoltValue_type(map) == BOLT_DICTIONARY8);
+                REQUIRE(BoltInt64_get(BoltDictionary8_value_by_key(map, "key_17", 6)) == 17);
+                REQUIRE((map->flags & BOLT_VALUE_INDEXED) != 0);
+                REQUIRE(BoltInt64_get(BoltDictionary8_value_by_key(map, "key_3", 5)) == 3);
+            }
+        }
+        _destroy_offline_connection(connection);
+    }
+}
+
+/**
+ * Write chunked RECORD [0, {"key": 0}] ... RECORD [n - 1, {"key": n - 1}]
+ * messages, followed by an empty SUCCESS summary.
+ */
+void _send_records(int socket, int n)
+{
+    struct BoltBuffer* buffer = BoltBuffer_create(NULL, 1024);
+    for (int i = 0; i < n; i++)
+    {
+        BoltBuffer_load_uint16_be(buffer, 14);
+        BoltBuffer_load_uint8(buffer, 0xB1);
+        BoltBuffer_load_uint8(buffer, 0x71);
+        BoltBuffer_load_uint8(buffer, 0x92);
+        BoltBuffer_load_uint8(buffer, 0xC9);
+        BoltBuffer_load_int16_be(buffer, (int16_t)(i));
+        BoltBuffer_load_uint8(buffer, 0xA1);
+        _load_string(buffer, "key");
+        BoltBuffer_load_uint8(buffer, 0xC9);
+        BoltBuffer_load_int16_be(buffer, (int16_t)(i));
+        BoltBuffer_load_uint16_be(buffer, 0);
+    }
+    BoltBuffer_load_uint16_be(buffer, 3);
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x70);
+    BoltBuffer_load_uint8(buffer, 0xA0);
+    BoltBuffer_load_uint16_be(buffer, 0);
+    int size = BoltBuffer_unloadable(buffer);
+    REQUIRE(write(socket, BoltBuffer_unload_target(buffer, size), (size_t)(size)) == size);
+    BoltBuffer_destroy(buffer);
+}
+
+void _fetch_records(struct BoltConnection* connection, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+        struct BoltValue* fetched = BoltConnection_fetched(connection);
+        REQUIRE(BoltValue_type(fetched) == BOLT_LIST);
+        REQUIRE(BoltInt64_get(BoltList_value(fetched, 0)) == i);
+        REQUIRE(BoltInt64_get(BoltDictionary8_value_by_key(BoltList_value(fetched, 1), "key", 3)) == i);
+    }
+    REQUIRE(BoltConnection_fetch_b(connection, 0) == 0);
+    REQUIRE(BoltValue_type(BoltConnection_fetched(connection)) == BOLT_SUMMARY);
+    REQUIRE(BoltSummary_code(BoltConnection_fetched(connection)) == 0x70);
+}
+
+SCENARIO("Test reader thread")
+{
+    GIVEN("an offline connection over a local socket pair")
+    {
+        int sockets[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+        struct BoltConnection* connection = _offline_connection();
+        connection->transport = BOLT_INSECURE_SOCKET;
+        connection->socket = sockets[0];
+        connection->rx_buffer = BoltBuffer_create(NULL, 256);
+        WHEN("a reader thread is started")
+        {
+            REQUIRE(BoltConnection_start_reader(connection, 4, 0) == 0);
+            THEN("a second reader thread should not be started")
+            {
+                REQUIRE(BoltConnection_start_reader(connection, 4, 0) == -1);
+            }
+            THEN("views should not be enabled")
+            {
+                REQUIRE(BoltConnection_set_view_threshold(connection, 0) == -1);
+            }
+            AND_WHEN("more records are sent than fit in the queue")
+            {
+                _send_records(sockets[1], 500);
+                close(sockets[1]);
+                sockets[1] = -1;
+                THEN("each record should be fetched in order")
+                {
+                    _fetch_records(connection, 500);
+                    AND_THEN("the end of transmission should be reported")
+                    {
+                        REQUIRE(BoltConnection_fetch_b(connection, 1) == -1);
+                        REQUIRE(connection->status == BOLT_DISCONNECTED);
+                        REQUIRE(connection->error == BOLT_END_OF_TRANSMISSION);
+                    }
+                }
+            }
+            BoltReader_stop(connection->reader);
+            connection->reader = NULL;
+        }
+        WHEN("a reader thread is started with decoder threads")
+        {
+            REQUIRE(BoltConnection_start_reader(connection, 8, 3) == 0);
+            AND_WHEN("more records are sent than fit in the queue")
+            {
+                _send_records(sockets[1], 500);
+                close(sockets[1]);
+                sockets[1] = -1;
+                THEN("each record should still be fetched in order")
+                {
+                    _fetch_records(connection, 500);
+                    AND_THEN("the end of transmission should be reported")
+                    {
+                        REQUIRE(BoltConnection_fetch_b(connection, 1) == -1);
+                        REQUIRE(connection->status == BOLT_DISCONNECTED);
+                    }
+                }
+            }
+            AND_WHEN("the reader is stopped while records are still being sent")
+            {
+                _send_records(sockets[1], 50);
+                THEN("it should stop cleanly")
+                {
+                    REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+                }
+            }
+            BoltReader_stop(connection->reader);
+            connection->reader = NULL;
+        }
+        WHEN("the connection is secure")
+        {
+            connection->transport = BOLT_SECURE_SOCKET;
+            THEN("a reader thread should not be started")
+            {
+                REQUIRE(BoltConnection_start_reader(connection, 4, 0) == -1);
+                REQUIRE(connection->reader == NULL);
+            }
+        }
+        BoltBuffer_destroy(connection->rx_buffer);
+        _destroy_offline_connection(connection);
+        close(sockets[0]);
+        if (sockets[1] != -1) close(sockets[1]);
+    }
+}
+
+SCENARIO("Test prepared statements")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        connection->tx_buffer = BoltBuffer_create(NULL, 256);
+        const char* statement = "UNWIND range(1, $n) AS x RETURN x, $name, $tags";
+        WHEN("a statement is prepared")
+        {
+            struct BoltPreparedStatement* prepared = BoltConnection_prepare(connection, statement, strlen(statement), 3);
+            REQUIRE(prepared != NULL);
+            THEN("it should not be loaded until every key is set")
+            {
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 0, "n", 1) == 0);
+                REQUIRE(BoltConnection_load_prepared_run_request(connection, prepared) == -1);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == 0);
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 3, "x", 1) == -1);
+            }
+            THEN("a value that cannot be loaded should leave nothing behind")
+            {
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 0, "n", 1) == 0);
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 1, "name", 4) == 0);
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 2, "tags", 4) == 0);
+                BoltValue_to_Int64(BoltPreparedStatement_parameter_value(prepared, 0), 1);
+                BoltValue_to_Float64Pair(BoltPreparedStatement_parameter_value(prepared, 1), 7203, 1.0, 2.0);
+                REQUIRE(BoltConnection_load_prepared_run_request(connection, prepared) == -1);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == 0);
+                BoltValue_to_Null(BoltPreparedStatement_parameter_value(prepared, 1));
+                REQUIRE(BoltConnection_load_prepared_run_request(connection, prepared) >= 0);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) > 0);
+            }
+            AND_WHEN("its keys and values are set")
+            {
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 0, "n", 1) == 0);
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 1, "name", 4) == 0);
+                REQUIRE(BoltPreparedStatement_set_parameter_key(prepared, 2, "tags", 4) == 0);
+                BoltConnection_set_cypher_template(connection, statement, strlen(statement));
+                BoltConnection_set_n_cypher_parameters(connection, 3);
+                BoltConnection_set_cypher_parameter_key(connection, 0, "n", 1);
+                BoltConnection_set_cypher_parameter_key(connection, 1, "name", 4);
+                BoltConnection_set_cypher_parameter_key(connection, 2, "tags", 4);
+                THEN("each request should match one loaded in full")
+                {
+                    for (int64_t n = 1; n <= 1000; n *= 10)
+                    {
+                        BoltValue_to_Int64(BoltPreparedStatement_parameter_value(prepared, 0), n);
+                        BoltValue_to_String8(BoltPreparedStatement_parameter_value(prepared, 1), "Alice", 5);
+                        BoltValue_to_List(BoltPreparedStatement_parameter_value(prepared, 2), 1);
+                        BoltValue_to_Null(BoltList_value(BoltPreparedStatement_parameter_value(prepared, 2), 0));
+                        int prepared_id = BoltConnection_load_prepared_run_request(connection, prepared);
+                        char data[256];
+                        int size = BoltBuffer_unloadable(connection->tx_buffer);
+                        REQUIRE(size <= (int)(sizeof(data)));
+                        BoltBuffer_unload(connection->tx_buffer, data, size);
+                        BoltValue_to_Int64(BoltConnection_cypher_parameter_value(connection, 0), n);
+                        BoltValue_to_String8(BoltConnection_cypher_parameter_value(connection, 1), "Alice", 5);
+                        BoltValue_to_List(BoltConnection_cypher_parameter_value(connection, 2), 1);
+                        BoltValue_to_Null(BoltList_value(BoltConnection_cypher_parameter_value(connection, 2), 0));
+                        int run_id = BoltConnection_load_run_request(connection);
+                        REQUIRE(run_id == prepared_id + 1);
+                        REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == size);
+                        REQUIRE(memcmp(BoltBuffer_unload_target(connection->tx_buffer, size), data, (size_t)(size)) == 0);
+                    }
+                }
+            }
+            BoltPreparedStatement_destroy(prepared);
+        }
+        THEN("nothing should be prepared without a usable connection and a statement")
+        {
+            REQUIRE(BoltConnection_prepare(NULL, statement, strlen(statement), 3) == NULL);
+            REQUIRE(BoltConnection_prepare(connection, NULL, 0, 3) == NULL);
+            REQUIRE(BoltConnection_load_prepared_run_request(connection, NULL) == -1);
+            connection->status = BOLT_DEFUNCT;
+            REQUIRE(BoltConnection_prepare(connection, statement, strlen(statement), 3) == NULL);
+        }
+        BoltBuffer_destroy(connection->tx_buffer);
+        _destroy_offline_connection(connection);
+    }
+}
+
+SCENARIO("Test frozen parameter values")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        connection->tx_buffer = BoltBuffer_create(NULL, 256);
+        const char* statement = "MATCH (a) WHERE id(a) IN $ids RETURN a";
+        BoltConnection_set_cypher_template(connection, statement, strlen(statement));
+        BoltConnection_set_n_cypher_parameters(connection, 1);
+        BoltConnection_set_cypher_parameter_key(connection, 0, "ids", 3);
+        struct BoltValue* ids = BoltConnection_cypher_parameter_value(connection, 0);
+        BoltValue_to_List(ids, 1000);
+        for (int32_t i = 0; i < 1000; i++)
+        {
+            BoltValue_to_Int64(BoltList_value(ids, i), 1000 * i);
+        }
+        WHEN("the parameter value is frozen")
+        {
+            BoltConnection_load_run_request(connection);
+            int size = BoltBuffer_unloadable(connection->tx_buffer);
+            char* data = (char*)(malloc((size_t)(size)));
+            BoltBuffer_unload(connection->tx_buffer, data, size);
+            REQUIRE(BoltValue_freeze(ids) == 0);
+            THEN("it should become a frozen byte array")
+            {
+                REQUIRE(BoltValue_type(ids) == BOLT_BYTE_ARRAY);
+                REQUIRE((ids->flags & BOLT_VALUE_FROZEN) != 0);
+                REQUIRE(BoltValue_freeze(ids) == 0);
+                REQUIRE(BoltValue_type(ids) == BOLT_BYTE_ARRAY);
+            }
+            THEN("each request should match one loaded from the original value")
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    BoltConnection_load_run_request(connection);
+                    REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == size);
+                    REQUIRE(memcmp(BoltBuffer_unload_target(connection->tx_buffer, size), data, (size_t)(size)) == 0);
+                }
+            }
+            THEN("a copy should stay frozen")
+            {
+                struct BoltValue* copy = BoltValue_create();
+                BoltValue_copy(ids, copy);
+                REQUIRE((copy->flags & BOLT_VALUE_FROZEN) != 0);
+                BoltValue_copy(copy, ids);
+                BoltConnection_load_run_request(connection);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == size);
+                REQUIRE(memcmp(BoltBuffer_unload_target(connection->tx_buffer, size), data, (size_t)(size)) == 0);
+                BoltValue_destroy(copy);
+            }
+            THEN("setting another value should thaw it")
+            {
+                char bytes[] = {1, 2, 3};
+                BoltValue_to_ByteArray(ids, bytes, sizeof(bytes));
+                REQUIRE((ids->flags & BOLT_VALUE_FROZEN) == 0);
+                BoltConnection_load_run_request(connection);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) < size);
+            }
+            free(data);
+        }
+        WHEN("a map is frozen")
+        {
+            struct BoltValue* value = BoltValue_create();
+            BoltValue_to_Dictionary8(value, 2);
+            BoltDictionary8_set_key(value, 0, "name", 4);
+            BoltValue_to_String8(BoltDictionary8_value(value, 0), "Alice", 5);
+            BoltDictionary8_set_key(value, 1, "age", 3);
+            BoltValue_to_Int64(BoltDictionary8_value(value, 1), 33);
+            REQUIRE(BoltValue_freeze(value) == 0);
+            THEN("it should hold the PackStream encoding of the map")
+            {
+                const char expected[] = {'\xA2', '\x84', 'n', 'a', 'm', 'e', '\x85', 'A', 'l', 'i', 'c', 'e',
+                                         '\x83', 'a', 'g', 'e', '\x21'};
+                REQUIRE(value->size == (int32_t)(sizeof(expected)));
+                REQUIRE(memcmp(BoltByteArray_get_all(value), expected, sizeof(expected)) == 0);
+            }
+            BoltValue_destroy(value);
+        }
+        BoltBuffer_destroy(connection->tx_buffer);
+        _destroy_offline_connection(connection);
+    }
+}
+
+/**
+ * Encode a RUN request for "RETURN $blob" on an offline connection, with
+ * the parameter copied as usual, and return its chunked bytes.
+ */
+std::string _expected_blob_request(const char* data, int32_t size, int is_string)
+{
+    struct BoltConnection* connection = _offline_connection();
+    connection->tx_buffer = BoltBuffer_create(NULL, 256);
+    BoltConnection_set_cypher_template(connection, "RETURN $blob", 12);
+    BoltConnection_set_n_cypher_parameters(connection, 1);
+    BoltConnection_set_cypher_parameter_key(connection, 0, "blob", 4);
+    struct BoltValue* blob = BoltConnection_cypher_parameter_value(connection, 0);
+    if (is_string)
+    {
+        BoltValue_to_String8(blob, data, size);
+    }
+    else
+    {
+        BoltValue_to_ByteArray(blob, (char*)(data), size);
+    }
+    BoltConnection_load_run_request(connection);
+    int request_size = BoltBuffer_unloadable(connection->tx_buffer);
+    std::string request(BoltBuffer_unload_target(connection->tx_buffer, request_size), (size_t)(request_size));
+    BoltBuffer_destroy(connection->tx_buffer);
+    _destroy_offline_connection(connection);
+    return request;
+}
+
+/**
+ * Send whatever has been loaded, and return what arrives at the other end.
+ */
+std::string _send_and_receive(struct BoltConnection* connection, int socket, size_t size)
+{
+    REQUIRE(BoltConnection_send_b(connection) >= 0);
+    std::string received(size, '\0');
+    size_t total = 0;
+    while (total < size)
+    {
+        ssize_t n = read(socket, &received[total], size - total);
+        REQUIRE(n > 0);
+        total += (size_t)(n);
+    }
+    return received;
+}
+
+SCENARIO("Test borrowed parameter values")
+{
+    GIVEN("an offline connection over a local socket pair")
+    {
+        int sockets[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        connection->transport = BOLT_INSECURE_SOCKET;
+        connection->socket = sockets[0];
+        connection->tx_buffer = BoltBuffer_create(NULL, 256);
+        BoltConnection_set_cypher_template(connection, "RETURN $blob", 12);
+        BoltConnection_set_n_cypher_parameters(connection, 1);
+        BoltConnection_set_cypher_parameter_key(connection, 0, "blob", 4);
+        struct BoltValue* blob = BoltConnection_cypher_parameter_value(connection, 0);
+        const int32_t size = 70000;
+        std::string data((size_t)(size), '\0');
+        for (int32_t i = 0; i < size; i++)
+        {
+            data[i] = (char)(i % 251);
+        }
+        WHEN("a large borrowed byte array is sent")
+        {
+            BoltValue_to_BorrowedByteArray(blob, data.data(), size);
+            std::string expected = _expected_blob_request(data.data(), size, 0);
+            BoltConnection_load_run_request(connection);
+            THEN("its data should be gathered in rather than copied")
+            {
+                REQUIRE((blob->flags & BOLT_VALUE_BORROWED) != 0);
+                REQUIRE(BoltByteArray_get_all(blob) == data.data());
+                REQUIRE(state->queued.size == 2);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) < 100);
+            }
+            THEN("the request should match one with the data copied")
+            {
+                REQUIRE(_send_and_receive(connection, sockets[1], expected.size()) == expected);
+                REQUIRE(state->queued.size == 0);
+            }
+        }
+        WHEN("a large borrowed string is sent twice")
+        {
+            BoltValue_to_BorrowedString8(blob, data.data(), size);
+            std::string expected = _expected_blob_request(data.data(), size, 1);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_run_request(connection);
+            THEN("both requests should match one with the data copied")
+            {
+                REQUIRE(_send_and_receive(connection, sockets[1], 2 * expected.size()) == expected + expected);
+            }
+        }
+        WHEN("a small borrowed string is sent")
+        {
+            BoltValue_to_BorrowedString8(blob, data.data(), 100);
+            std::string expected = _expected_blob_request(data.data(), 100, 1);
+            BoltConnection_load_run_request(connection);
+            THEN("it should be copied as usual")
+            {
+                REQUIRE(BoltString8_get(blob) == data.data());
+                REQUIRE(state->queued.size == 0);
+                REQUIRE(_send_and_receive(connection, sockets[1], expected.size()) == expected);
+            }
+        }
+        WHEN("a region of a file is mapped")
+        {
+            char path[] = "/tmp/seabolt-test-XXXXXX";
+            int fd = mkstemp(path);
+            REQUIRE(fd != -1);
+            unlink(path);
+            REQUIRE(write(fd, "header", 6) == 6);
+            REQUIRE(write(fd, data.data(), (size_t)(size)) == size);
+            REQUIRE(BoltValue_to_MappedByteArray(blob, fd, 6, size) == 0);
+            close(fd);
+            std::string expected = _expected_blob_request(data.data(), size, 0);
+            THEN("it should hold the data in that region")
+            {
+                REQUIRE((blob->flags & BOLT_VALUE_MAPPED) != 0);
+                REQUIRE(BoltValue_type(blob) == BOLT_BYTE_ARRAY);
+                REQUIRE(blob->size == size);
+                REQUIRE(memcmp(BoltByteArray_get_all(blob), data.data(), (size_t)(size)) == 0);
+            }
+            THEN("a request should match one with the data copied")
+            {
+                BoltConnection_load_run_request(connection);
+                REQUIRE(_send_and_receive(connection, sockets[1], expected.size()) == expected);
+            }
+            THEN("a copy should own its data")
+            {
+                struct BoltValue* copy = BoltValue_create();
+                BoltValue_copy(blob, copy);
+                BoltValue_to_Null(blob);
+                REQUIRE(copy->flags == 0);
+                REQUIRE(memcmp(BoltByteArray_get_all(copy), data.data(), (size_t)(size)) == 0);
+                BoltValue_destroy(copy);
+            }
+        }
+        WHEN("a region of an invalid file is mapped")
+        {
+            THEN("it should fail")
+            {
+                REQUIRE(BoltValue_to_MappedByteArray(blob, -1, 0, size) == -1);
+                REQUIRE(BoltValue_type(blob) == BOLT_NULL);
+            }
+        }
+        BoltBuffer_destroy(connection->tx_buffer);
+        _destroy_offline_connection(connection);
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+}
+
+/**
+ * Write a summary per request ahead of time: SUCCESS up to the one
+ * failing (if any), FAILURE for that and IGNORED for the rest.
+ */
+void _send_summaries(int socket, int n, int failure)
+{
+    struct BoltBuffer* buffer = BoltBuffer_create(NULL, 256);
+    for (int i = 0; i < n; i++)
+    {
+        BoltBuffer_load_uint16_be(buffer, 3);
+        BoltBuffer_load_uint8(buffer, 0xB1);
+        BoltBuffer_load_uint8(buffer, (uint8_t)(failure == -1 || i < failure ? 0x70 : i == failure ? 0x7F : 0x7E));
+        BoltBuffer_load_uint8(buffer, 0xA0);
+        BoltBuffer_load_uint16_be(buffer, 0);
+    }
+    int size = BoltBuffer_unloadable(buffer);
+    REQUIRE(write(socket, BoltBuffer_unload_target(buffer, size), (size_t)(size)) == size);
+    BoltBuffer_destroy(buffer);
+}
+
+/**
+ * Receive every request sent so far, dechunked into the receive buffer
+ * of an offline connection.
+ */
+void _receive_requests(int socket, struct BoltConnection* receiver)
+{
+    struct BoltBuffer* buffer = BoltBuffer_create(NULL, 4096);
+    char data[4096];
+    ssize_t received;
+    while ((received = recv(socket, data, sizeof(data), MSG_DONTWAIT)) > 0)
+    {
+        BoltBuffer_load(buffer, data, (int)(received));
+    }
+    struct BoltBuffer* rx_buffer = BoltProtocolV1_state(receiver)->rx_buffer;
+    uint16_t chunk_size;
+    while (BoltBuffer_unload_uint16_be(buffer, &chunk_size) == 0)
+    {
+        BoltBuffer_load(rx_buffer, BoltBuffer_unload_target(buffer, chunk_size), chunk_size);
+    }
+    BoltBuffer_destroy(buffer);
+}
+
+/**
+ * Check the next batch received: BEGIN, RUN, DISCARD_ALL, COMMIT.
+ */
+void _check_batch(struct BoltConnection* receiver, int32_t first_row, int32_t n_rows)
+{
+    struct BoltValue* request = BoltProtocolV1_state(receiver)->fetched;
+    REQUIRE(BoltProtocolV1_unload(receiver) == 1);
+    REQUIRE(BoltSummary_code(request) == 0x10);
+    REQUIRE(strncmp(BoltString8_get(BoltSummary_value(request, 0)), "BEGIN", 5) == 0);
+    REQUIRE(BoltProtocolV1_unload(receiver) == 1);
+    REQUIRE(BoltSummary_code(request) == 0x2F);
+    REQUIRE(BoltProtocolV1_unload(receiver) == 1);
+    REQUIRE(BoltSummary_code(request) == 0x10);
+    struct BoltValue* rows = BoltDictionary8_value_by_key(BoltSummary_value(request, 1), "rows", 4);
+    REQUIRE(BoltValue_type(rows) == BOLT_LIST);
+    REQUIRE(rows->size == n_rows);
+    for (int32_t i = 0; i < n_rows; i++)
+    {
+        struct BoltValue* row = BoltList_value(rows, i);
+        REQUIRE(BoltInt64_get(BoltDictionary8_value_by_key(row, "id", 2)) == first_row + i);
+        REQUIRE(BoltString8_get(BoltDictionary8_value_by_key(row, "name", 4))[0] == 'x');
+    }
+    REQUIRE(BoltProtocolV1_unload(receiver) == 1);
+    REQUIRE(BoltSummary_code(request) == 0x2F);
+    REQUIRE(BoltProtocolV1_unload(receiver) == 1);
+    REQUIRE(BoltSummary_code(request) == 0x10);
+    REQUIRE(strncmp(BoltString8_get(BoltSummary_value(request, 0)), "COMMIT", 6) == 0);
+    REQUIRE(BoltProtocolV1_unload(receiver) == 1);
+    REQUIRE(BoltSummary_code(request) == 0x2F);
+}
+
+int _append_rows(struct BoltBulkWriter* writer, int32_t n, size_t name_size)
+{
+    char name[100000];
+    memset(name, 'x', sizeof(name));
+    for (int32_t i = 0; i < n; i++)
+    {
+        BoltBulkWriter_set_integer(writer, 0, i);
+        BoltBulkWriter_set_string(writer, 1, name, name_size);
+        try(BoltBulkWriter_append_b(writer));
+    }
+    return 0;
+}
+
+SCENARIO("Test bulk writer")
+{
+    GIVEN("two offline connections over local socket pairs")
+    {
+        int sockets[2][2];
+        struct BoltConnection* connections[2];
+        struct BoltConnection* receivers[2];
+        for (int i = 0; i < 2; i++)
+        {
+            REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets[i]) == 0);
+            connections[i] = _offline_connection();
+            connections[i]->transport = BOLT_INSECURE_SOCKET;
+            connections[i]->socket = sockets[i][0];
+            connections[i]->tx_buffer = BoltBuffer_create(NULL, 256);
+            connections[i]->rx_buffer = BoltBuffer_create(NULL, 256);
+            receivers[i] = _offline_connection();
+        }
+        const char* statement = "UNWIND $rows AS row CREATE (:Person {id: row.id, name: row.name})";
+        WHEN("a writer over one connection is given more rows than fit in a batch")
+        {
+            struct BoltBulkWriter* writer = BoltBulkWriter_create(connections, 1, statement, strlen(statement), 2);
+            REQUIRE(writer != NULL);
+            REQUIRE(BoltBulkWriter_set_field_key(writer, 0, "id", 2) == 0);
+            REQUIRE(BoltBulkWriter_set_field_key(writer, 1, "name", 4) == 0);
+            REQUIRE(BoltBulkWriter_set_field_key(writer, 2, "age", 3) == -1);
+            REQUIRE(BoltBulkWriter_set_batch_limits(writer, 3, 1000000) == 0);
+            REQUIRE(BoltBulkWriter_set_max_in_flight(writer, 2) == 0);
+            THEN("every row should be written in batches")
+            {
+                _send_summaries(sockets[0][1], 3 * 6, -1);
+                REQUIRE(_append_rows(writer, 7, 10) == 0);
+                REQUIRE(BoltBulkWriter_finish_b(writer) == 0);
+                REQUIRE(BoltBulkWriter_rows_written(writer) == 7);
+                _receive_requests(sockets[0][1], receivers[0]);
+                _check_batch(receivers[0], 0, 3);
+                _check_batch(receivers[0], 3, 3);
+                _check_batch(receivers[0], 6, 1);
+                REQUIRE(BoltProtocolV1_unload(receivers[0]) == 0);
+            }
+            THEN("a row too big for a single chunk should be split across several")
+            {
+                _send_summaries(sockets[0][1], 6, -1);
+                REQUIRE(_append_rows(writer, 1, 100000) == 0);
+                REQUIRE(BoltBulkWriter_finish_b(writer) == 0);
+                _receive_requests(sockets[0][1], receivers[0]);
+                _check_batch(receivers[0], 0, 1);
+                // The batch is sent from where it was encoded, never copied
+                REQUIRE(connections[0]->tx_buffer->size < 100000);
+                REQUIRE(BoltProtocolV1_state(connections[0])->tx_buffer->size < 100000);
+            }
+            THEN("a row that cannot be encoded should be left out")
+            {
+                _send_summaries(sockets[0][1], 6, -1);
+                BoltValue_to_Char16(BoltBulkWriter_field_value(writer, 0), 'x');
+                REQUIRE(BoltBulkWriter_append_b(writer) == -1);
+                REQUIRE(_append_rows(writer, 2, 10) == 0);
+                REQUIRE(BoltBulkWriter_finish_b(writer) == 0);
+                REQUIRE(BoltBulkWriter_rows_written(writer) == 2);
+            }
+            THEN("a failed batch should stop the writer")
+            {
+                // BEGIN succeeds, the batch itself fails
+                _send_summaries(sockets[0][1], 6, 2);
+                REQUIRE(_append_rows(writer, 3, 10) == 0);
+                REQUIRE(BoltBulkWriter_finish_b(writer) == -1);
+                REQUIRE(BoltBulkWriter_rows_written(writer) == 0);
+                REQUIRE(connections[0]->status == BOLT_FAILED);
+                REQUIRE(BoltBulkWriter_append_b(writer) == -1);
+            }
+            BoltBulkWriter_destroy(writer);
+        }
+        WHEN("a writer is created over a defunct connection")
+        {
+            connections[1]->status = BOLT_DEFUNCT;
+            THEN("it should not be created")
+            {
+                REQUIRE(BoltBulkWriter_create(connections, 2, statement, strlen(statement), 2) == NULL);
+            }
+        }
+        WHEN("a writer is sharded over two connections")
+        {
+            struct BoltBulkWriter* writer = BoltBulkWriter_create(connections, 2, statement, strlen(statement), 2);
+            BoltBulkWriter_set_field_key(writer, 0, "id", 2);
+            BoltBulkWriter_set_field_key(writer, 1, "name", 4);
+            BoltBulkWriter_set_batch_limits(writer, 2, 1000000);
+            BoltBulkWriter_set_max_in_flight(writer, 1);
+            THEN("batches should be sent to each connection in turn")
+            {
+                _send_summaries(sockets[0][1], 2 * 6, -1);
+                _send_summaries(sockets[1][1], 2 * 6, -1);
+                REQUIRE(_append_rows(writer, 8, 10) == 0);
+                REQUIRE(BoltBulkWriter_finish_b(writer) == 0);
+                REQUIRE(BoltBulkWriter_rows_written(writer) == 8);
+                _receive_requests(sockets[0][1], receivers[0]);
+                _receive_requests(sockets[1][1], receivers[1]);
+                _check_batch(receivers[0], 0, 2);
+                _check_batch(receivers[1], 2, 2);
+                _check_batch(receivers[0], 4, 2);
+                _check_batch(receivers[1], 6, 2);
+            }
+            BoltBulkWriter_destroy(writer);
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            _destroy_offline_connection(receivers[i]);
+            BoltBuffer_destroy(connections[i]->rx_buffer);
+            BoltBuffer_destroy(connections[i]->tx_buffer);
+            _destroy_offline_connection(connections[i]);
+            close(sockets[i][0]);
+            close(sockets[i][1]);
+        }
+    }
+}
+
+/**
+ * Check that a partly written request has been taken back and the
+ * writer stopped.
+ */
+void _require_stopped(struct BoltConnection* connection, struct BoltPackWriter* writer)
+{
+    REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == 0);
+    REQUIRE(BoltBuffer_unloadable(BoltProtocolV1_state(connection)->tx_buffer) == 0);
+    REQUIRE(BoltPackWriter_write_null(writer) == -1);
+}
+
+SCENARIO("Test pack writer")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        connection->tx_buffer = BoltBuffer_create(NULL, 256);
+        const char* statement = "CREATE (a:Person {name: $name, age: $age, tags: $tags, address: $address})";
+        struct BoltPackWriter writer;
+        WHEN("a RUN request is written")
+        {
+            REQUIRE(BoltPackWriter_begin_run_request(&writer, connection, statement, strlen(statement), 4) == 0);
+            REQUIRE(BoltPackWriter_write_cstring(&writer, "name") == 0);
+            REQUIRE(BoltPackWriter_write_string(&writer, "Alice", 5) == 0);
+            REQUIRE(BoltPackWriter_write_cstring(&writer, "age") == 0);
+            REQUIRE(BoltPackWriter_write_int(&writer, 33) == 0);
+            REQUIRE(BoltPackWriter_write_cstring(&writer, "tags") == 0);
+            REQUIRE(BoltPackWriter_begin_list(&writer, 3) == 0);
+            REQUIRE(BoltPackWriter_write_boolean(&writer, 1) == 0);
+            REQUIRE(BoltPackWriter_write_float(&writer, 1.5) == 0);
+            REQUIRE(BoltPackWriter_write_null(&writer) == 0);
+            REQUIRE(BoltPackWriter_end(&writer) == 0);
+            REQUIRE(BoltPackWriter_write_cstring(&writer, "address") == 0);
+            REQUIRE(BoltPackWriter_begin_map(&writer, 1) == 0);
+            REQUIRE(BoltPackWriter_write_cstring(&writer, "city") == 0);
+            REQUIRE(BoltPackWriter_write_cstring(&writer, "Malmö") == 0);
+            REQUIRE(BoltPackWriter_end(&writer) == 0);
+            int written_id = BoltPackWriter_end(&writer);
+            THEN("it should match one loaded from a value tree")
+            {
+                char data[256];
+                int size = BoltBuffer_unloadable(connection->tx_buffer);
+                REQUIRE(size <= (int)(sizeof(data)));
+                BoltBuffer_unload(connection->tx_buffer, data, size);
+                BoltConnection_set_cypher_template(connection, statement, strlen(statement));
+                BoltConnection_set_n_cypher_parameters(connection, 4);
+                BoltConnection_set_cypher_parameter_key(connection, 0, "name", 4);
+                BoltValue_to_String8(BoltConnection_cypher_parameter_value(connection, 0), "Alice", 5);
+                BoltConnection_set_cypher_parameter_key(connection, 1, "age", 3);
+                BoltValue_to_Int64(BoltConnection_cypher_parameter_value(connection, 1), 33);
+                BoltConnection_set_cypher_parameter_key(connection, 2, "tags", 4);
+                struct BoltValue* tags = BoltConnection_cypher_parameter_value(connection, 2);
+                BoltValue_to_List(tags, 3);
+                BoltValue_to_Bit(BoltList_value(tags, 0), 1);
+                BoltValue_to_Float64(BoltList_value(tags, 1), 1.5);
+                BoltConnection_set_cypher_parameter_key(connection, 3, "address", 7);
+                struct BoltValue* address = BoltConnection_cypher_parameter_value(connection, 3);
+                BoltValue_to_Dictionary8(address, 1);
+                BoltDictionary8_set_key(address, 0, "city", 4);
+                BoltValue_to_String8(BoltDictionary8_value(address, 0), "Malmö", strlen("Malmö"));
+                int run_id = BoltConnection_load_run_request(connection);
+                REQUIRE(run_id == written_id + 1);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == size);
+                REQUIRE(memcmp(BoltBuffer_unload_target(connection->tx_buffer, size), data, (size_t)(size)) == 0);
+            }
+            THEN("nothing more should be written")
+            {
+                int size = BoltBuffer_unloadable(connection->tx_buffer);
+                REQUIRE(BoltPackWriter_write_int(&writer, 1) == -1);
+                REQUIRE(BoltBuffer_unloadable(connection->tx_buffer) == size);
+            }
+        }
+        WHEN("a request is written wrongly")
+        {
+            REQUIRE(BoltPackWriter_begin_run_request(&writer, connection, statement, strlen(statement), 1) == 0);
+            THEN("a map key that is not a string should be rejected")
+            {
+                REQUIRE(BoltPackWriter_write_int(&writer, 1) == -1);
+                _require_stopped(connection, &writer);
+            }
+            THEN("too many items should be rejected")
+            {
+                REQUIRE(BoltPackWriter_write_cstring(&writer, "ids") == 0);
+                REQUIRE(BoltPackWriter_begin_list(&writer, 1) == 0);
+                REQUIRE(BoltPackWriter_write_int(&writer, 1) == 0);
+                REQUIRE(BoltPackWriter_write_int(&writer, 2) == -1);
+                _require_stopped(connection, &writer);
+            }
+            THEN("too few items should be rejected")
+            {
+                REQUIRE(BoltPackWriter_write_cstring(&writer, "ids") == 0);
+                REQUIRE(BoltPackWriter_begin_list(&writer, 2) == 0);
+                REQUIRE(BoltPackWriter_write_int(&writer, 1) == 0);
+                REQUIRE(BoltPackWriter_end(&writer) == -1);
+                _require_stopped(connection, &writer);
+            }
+        }
+        BoltBuffer_destroy(connection->tx_buffer);
+        _destroy_offline_connection(connection);
+    }
+}
+
+/**
+ * Write each event into a string, in a form that can be compared.
+ */
+struct EventLog
+{
+    char text[1024];
+    size_t size;
+    int stop_at_string;
+};
+
+void _log_event(void* context, const char* format, ...)
+{
+    struct EventLog* log = (struct EventLog*)(context);
+    va_list args;
+    va_start(args, format);
+    log->size += vsnprintf(&log->text[log->size], sizeof(log->text) - log->size, format, args);
+    va_end(args);
+}
+
+int _on_null(void* context)
+{
+    _log_event(context, "null ");
+    return 0;
+}
+
+int _on_boolean(void* context, int x)
+{
+    _log_event(context, "%s ", x ? "true" : "false");
+    return 0;
+}
+
+int _on_int(void* context, int64_t x)
+{
+    _log_event(context, "%lld ", (long long)(x));
+    return 0;
+}
+
+int _on_float(void* context, double x)
+{
+    _log_event(context, "%g ", x);
+    return 0;
+}
+
+int _on_string(void* context, const char* string, int32_t size)
+{
+    _log_event(context, "\"%.*s\" ", (int)(size), string);
+    return ((struct EventLog*)(context))->stop_at_string;
+}
+
+int _on_bytes(void* context, const char* data, int32_t size)
+{
+    _log_event(context, "#%d ", (int)(size));
+    return 0;
+}
+
+int _on_list_begin(void* context, int32_t size)
+{
+    _log_event(context, "[%d ", (int)(size));
+    return 0;
+}
+
+int _on_map_begin(void* context, int32_t size)
+{
+    _log_event(context, "{%d ", (int)(size));
+    return 0;
+}
+
+int _on_struct_begin(void* context, int16_t code, int32_t size)
+{
+    _log_event(context, "%c(%d ", (char)(code), (int)(size));
+    return 0;
+}
+
+int _on_end(void* context)
+{
+    _log_event(context, ") ");
+    return 0;
+}
+
+const struct BoltEventHandler EVENT_LOGGER = {
+        _on_null, _on_boolean, _on_int, _on_float, _on_string, _on_bytes,
+        _on_list_begin, _on_map_begin, _on_struct_begin, _on_end,
+};
+
+int _on_int_sum(void* context, int64_t x)
+{
+    *(int64_t*)(context) += x;
+    return 0;
+}
+
+SCENARIO("Test record events")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        struct EventLog log;
+        memset(&log, 0, sizeof(log));
+        WHEN("a record is received")
+        {
+            _load_record(state->rx_buffer);
+            THEN("its fields should be delivered as events")
+            {
+                REQUIRE(BoltProtocolV1_unload_events(connection, &EVENT_LOGGER, &log) == 1);
+                REQUIRE(std::string(log.text) ==
+                        "[3 1 \"a string too long to fit inline\" {1 \"key\" [2 1 2 ) ) ) ");
+                REQUIRE(BoltBuffer_unloadable(state->rx_buffer) == 0);
+            }
+            THEN("a callback should be able to stop it")
+            {
+                log.stop_at_string = 1;
+                REQUIRE(BoltProtocolV1_unload_events(connection, &EVENT_LOGGER, &log) == -1);
+                REQUIRE(std::string(log.text) == "[3 1 \"a string too long to fit inline\" ");
+                REQUIRE(BoltBuffer_unloadable(state->rx_buffer) == 0);
+            }
+            THEN("events without a callback should be skipped")
+            {
+                int64_t sum = 0;
+                struct BoltEventHandler handler;
+                memset(&handler, 0, sizeof(handler));
+                handler.on_int = _on_int_sum;
+                REQUIRE(BoltProtocolV1_unload_events(connection, &handler, &sum) == 1);
+                REQUIRE(sum == 4);
+            }
+        }
+        WHEN("a record holding a node is received")
+        {
+            _load_node_record(state->rx_buffer);
+            THEN("the node should be delivered as a structure")
+            {
+                REQUIRE(BoltProtocolV1_unload_events(connection, &EVENT_LOGGER, &log) == 1);
+                REQUIRE(std::string(log.text) ==
+                        "[1 N(3 1 [1 \"Person\" ) {2 \"name\" \"Alice\" \"a key too long to fit inline\" 1 ) ) ) ");
+            }
+        }
+        WHEN("many records are received in succession")
+        {
+            long long events = BoltMem_allocation_events();
+            for (int i = 0; i < 100; i++)
+            {
+                log.size = 0;
+                _load_record(state->rx_buffer);
+                REQUIRE(BoltProtocolV1_unload_events(connection, &EVENT_LOGGER, &log) == 1);
+            }
+            THEN("no memory should be allocated or freed")
+            {
+                REQUIRE(BoltMem_allocation_events() == events);
+            }
+        }
+        WHEN("a summary is received")
+        {
+            BoltBuffer_load_uint8(state->rx_buffer, 0xB1);
+            BoltBuffer_load_uint8(state->rx_buffer, 0x70);
+            BoltBuffer_load_uint8(state->rx_buffer, 0xA0);
+            THEN("it should be left to be unloaded as usual")
+            {
+                REQUIRE(BoltProtocolV1_unload_events(connection, &EVENT_LOGGER, &log) == 0);
+                REQUIRE(log.size == 0);
+                REQUIRE(BoltProtocolV1_unload(connection) == 1);
+                REQUIRE(BoltSummary_code(BoltConnection_fetched(connection)) == 0x70);
+            }
+        }
+        _destroy_offline_connection(connection);
+    }
+    GIVEN("an offline connection over a local socket pair")
+    {
+        int sockets[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+        struct BoltConnection* connection = _offline_connection();
+        connection->transport = BOLT_INSECURE_SOCKET;
+        connection->socket = sockets[0];
+        connection->rx_buffer = BoltBuffer_create(NULL, 256);
+        WHEN("records are sent")
+        {
+            _send_records(sockets[1], 100);
+            THEN("each should be fetched as events, followed by the summary")
+            {
+                struct BoltEventHandler handler;
+                memset(&handler, 0, sizeof(handler));
+                handler.on_int = _on_int_sum;
+                int64_t sum = 0;
+                for (int i = 0; i < 100; i++)
+                {
+                    REQUIRE(BoltConnection_fetch_events_b(connection, 0, &handler, &sum) == 1);
+                }
+                REQUIRE(sum == 2 * (99 * 100 / 2));
+                REQUIRE(BoltConnection_fetch_events_b(connection, 0, &handler, &sum) == 0);
+                REQUIRE(BoltSummary_code(BoltConnection_fetched(connection)) == 0x70);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        BoltBuffer_destroy(connection->rx_buffer);
+        _destroy_offline_connection(connection);
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+}
+
+SCENARIO("Test tape decoding")
+{
+    GIVEN("an offline connection and a tape")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        struct BoltTape* tape = BoltTape_create();
+        WHEN("two records are appended")
+        {
+            _load_record(state->rx_buffer);
+            REQUIRE(BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape) == 1);
+            _load_node_record(state->rx_buffer);
+            REQUIRE(BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape) == 1);
+            THEN("the first record should be laid out flat")
+            {
+                REQUIRE(tape->n_records == 2);
+                REQUIRE(BoltTape_type(tape, 0) == BOLT_LIST);
+                REQUIRE(BoltTape_size(tape, 0) == 3);
+                REQUIRE(BoltTape_int64(tape, 1) == 1);
+                REQUIRE(BoltTape_type(tape, 2) == BOLT_STRING8);
+                REQUIRE(BoltTape_size(tape, 2) == 31);
+                REQUIRE(strncmp(BoltTape_data(tape, 2), "a string too long to fit inline", 31) == 0);
+                REQUIRE(BoltTape_type(tape, 3) == BOLT_DICTIONARY8);
+                REQUIRE(BoltTape_size(tape, 3) == 1);
+                REQUIRE(strncmp(BoltTape_data(tape, 4), "key", 3) == 0);
+                REQUIRE(BoltTape_type(tape, 5) == BOLT_LIST);
+                REQUIRE(BoltTape_int64(tape, 7) == 2);
+            }
+            THEN("each value should be skipped in one step")
+            {
+                REQUIRE(BoltTape_next(tape, 1) == 2);
+                REQUIRE(BoltTape_next(tape, 3) == 8);
+                REQUIRE(BoltTape_next(tape, 0) == 8);
+            }
+            THEN("the second record should follow the first")
+            {
+                int32_t node = 9;
+                REQUIRE(BoltTape_type(tape, 8) == BOLT_LIST);
+                REQUIRE(BoltTape_type(tape, node) == BOLT_STRUCTURE);
+                REQUIRE(BoltTape_code(tape, node) == 'N');
+                int32_t labels = BoltTape_next(tape, node + 1);
+                REQUIRE(BoltTape_size(tape, labels) == 1);
+                int32_t properties = BoltTape_next(tape, labels);
+                REQUIRE(BoltTape_type(tape, properties) == BOLT_DICTIONARY8);
+                REQUIRE(strncmp(BoltTape_data(tape, properties + 2), "Alice", 5) == 0);
+                REQUIRE(BoltTape_next(tape, 8) == tape->n_tokens);
+            }
+        }
+        WHEN("the tape is reset and reused")
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                _load_record(state->rx_buffer);
+                BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape);
+            }
+            BoltTape_reset(tape);
+            long long events = BoltMem_allocation_events();
+            for (int i = 0; i < 10; i++)
+            {
+                _load_record(state->rx_buffer);
+                BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape);
+            }
+            THEN("no memory should be allocated or freed")
+            {
+                REQUIRE(tape->n_records == 10);
+                REQUIRE(BoltMem_allocation_events() == events);
+            }
+        }
+        BoltTape_destroy(tape);
+        _destroy_offline_connection(connection);
+    }
+    GIVEN("an offline connection over a local socket pair")
+    {
+        int sockets[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+        struct BoltConnection* connection = _offline_connection();
+        connection->transport = BOLT_INSECURE_SOCKET;
+        connection->socket = sockets[0];
+        connection->rx_buffer = BoltBuffer_create(NULL, 256);
+        struct BoltTape* tape = BoltTape_create();
+        WHEN("records are sent")
+        {
+            _send_records(sockets[1], 100);
+            THEN("a batch of records should be fetched onto the tape")
+            {
+                while (BoltTape_fetch_b(tape, connection, 0) == 1);
+                REQUIRE(tape->n_records == 100);
+                int32_t record = 0;
+                for (int i = 0; i < 100; i++)
+                {
+                    REQUIRE(BoltTape_int64(tape, record + 1) == i);
+                    REQUIRE(BoltTape_int64(tape, record + 4) == i);
+                    record = BoltTape_next(tape, record);
+                }
+                REQUIRE(record == tape->n_tokens);
+            }
+        }
+        WHEN("the connection closes part way through a batch")
+        {
+            _send_records(sockets[1], 1);
+            close(sockets[1]);
+            sockets[1] = -1;
+            REQUIRE(BoltTape_fetch_b(tape, connection, 0) == 1);
+            REQUIRE(BoltTape_fetch_b(tape, connection, 0) == 0);
+            THEN("the records already fetched should be kept")
+            {
+                REQUIRE(BoltTape_fetch_b(tape, connection, 1) == -1);
+                REQUIRE(tape->n_records == 1);
+                REQUIRE(BoltTape_next(tape, 0) == tape->n_tokens);
+            }
+        }
+        BoltTape_destroy(tape);
+        BoltBuffer_destroy(connection->rx_buffer);
+        _destroy_offline_connection(connection);
+        close(sockets[0]);
+        if (sockets[1] != -1) close(sockets[1]);
+    }
+}
+
+void _load_path_node(struct BoltBuffer* buffer, uint8_t id, const char* label)
+{
+    BoltBuffer_load_uint8(buffer, 0xB3);
+    BoltBuffer_load_uint8(buffer, 'N');
+    BoltBuffer_load_uint8(buffer, id);
+    BoltBuffer_load_uint8(buffer, 0x91);
+    _load_string(buffer, label);
+    BoltBuffer_load_uint8(buffer, 0xA1);
+    _load_string(buffer, "age");
+    BoltBuffer_load_uint8(buffer, (uint8_t)(10 * id));
+}
+
+/**
+ * Load a record holding the path (1)-[10:KNOWS]->(2)<-[11:LIKES]-(3)
+ * and the relationship (1)-[12:KNOWS]->(2).
+ */
+void _load_path_record(struct BoltBuffer* buffer)
+{
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x92);
+    BoltBuffer_load_uint8(buffer, 0xB3);
+    BoltBuffer_load_uint8(buffer, 'P');
+    BoltBuffer_load_uint8(buffer, 0x93);
+    _load_path_node(buffer, 1, "Person");
+    _load_path_node(buffer, 2, "Person");
+    _load_path_node(buffer, 3, "Robot");
+    BoltBuffer_load_uint8(buffer, 0x92);
+    BoltBuffer_load_uint8(buffer, 0xB3);
+    BoltBuffer_load_uint8(buffer, 'r');
+    BoltBuffer_load_uint8(buffer, 10);
+    _load_string(buffer, "KNOWS");
+    BoltBuffer_load_uint8(buffer, 0xA1);
+    _load_string(buffer, "since");
+    BoltBuffer_load_uint8(buffer, 0x2A);
+    BoltBuffer_load_uint8(buffer, 0xB3);
+    BoltBuffer_load_uint8(buffer, 'r');
+    BoltBuffer_load_uint8(buffer, 11);
+    _load_string(buffer, "LIKES");
+    BoltBuffer_load_uint8(buffer, 0xA0);
+    BoltBuffer_load_uint8(buffer, 0x94);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0xFE);
+    BoltBuffer_load_uint8(buffer, 0x02);
+    BoltBuffer_load_uint8(buffer, 0xB5);
+    BoltBuffer_load_uint8(buffer, 'R');
+    BoltBuffer_load_uint8(buffer, 12);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0x02);
+    _load_string(buffer, "KNOWS");
+    BoltBuffer_load_uint8(buffer, 0xA0);
+}
+
+SCENARIO("Test graph entity views")
+{
+    GIVEN("an offline connection and a tape")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        struct BoltTape* tape = BoltTape_create();
+        struct BoltPathView* path = BoltPathView_create();
+        WHEN("a record holding a path and a relationship is decoded")
+        {
+            _load_path_record(state->rx_buffer);
+            REQUIRE(BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape) == 1);
+            int32_t first = 1;
+            int32_t second = BoltTape_next(tape, first);
+            THEN("the path should be resolved into nodes, relationships and hops")
+            {
+                REQUIRE(BoltTape_path(tape, first, path) == 0);
+                REQUIRE(path->n_nodes == 3);
+                REQUIRE(path->nodes[2].id == 3);
+                REQUIRE(path->nodes[2].n_labels == 1);
+                REQUIRE(strncmp(BoltTape_data(tape, path->nodes[2].labels), "Robot", 5) == 0);
+                REQUIRE(path->n_relationships == 2);
+                REQUIRE(path->n_hops == 2);
+                REQUIRE(path->hops[0].relationship == 0);
+                REQUIRE(path->hops[0].forward == 1);
+                REQUIRE(path->hops[0].node == 1);
+                REQUIRE(path->hops[1].relationship == 1);
+                REQUIRE(path->hops[1].forward == 0);
+                REQUIRE(path->hops[1].node == 2);
+            }
+            THEN("the relationships of the path should be bound to their nodes")
+            {
+                REQUIRE(BoltTape_path(tape, first, path) == 0);
+                struct BoltRelationshipView* knows = &path->relationships[0];
+                REQUIRE(knows->id == 10);
+                REQUIRE(knows->start_id == 1);
+                REQUIRE(knows->end_id == 2);
+                REQUIRE(strncmp(BoltTape_data(tape, knows->type), "KNOWS", 5) == 0);
+                REQUIRE(BoltTape_size(tape, knows->properties) == 1);
+                REQUIRE(BoltTape_int64(tape, knows->properties + 2) == 42);
+                struct BoltRelationshipView* likes = &path->relationships[1];
+                REQUIRE(likes->start_id == 3);
+                REQUIRE(likes->end_id == 2);
+            }
+            THEN("a bound relationship should be read as it is")
+            {
+                struct BoltRelationshipView relationship;
+                REQUIRE(BoltTape_relationship(tape, second, &relationship) == 0);
+                REQUIRE(relationship.id == 12);
+                REQUIRE(relationship.start_id == 1);
+                REQUIRE(relationship.end_id == 2);
+            }
+            THEN("values of other kinds should be rejected")
+            {
+                struct BoltNodeView node;
+                struct BoltRelationshipView relationship;
+                REQUIRE(BoltTape_node(tape, second, &node) == -1);
+                REQUIRE(BoltTape_relationship(tape, first, &relationship) == -1);
+                REQUIRE(BoltTape_path(tape, second, path) == -1);
+            }
+        }
+        WHEN("a path refers to a relationship it does not hold")
+        {
+            _load_path_record(state->rx_buffer);
+            REQUIRE(BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape) == 1);
+            int32_t sequence = BoltTape_next(tape, BoltTape_next(tape, 2));
+            tape->tokens[sequence + 3].data.as_int64 = -3;
+            THEN("the path should be rejected")
+            {
+                REQUIRE(BoltTape_path(tape, 1, path) == -1);
+            }
+        }
+        BoltPathView_destroy(path);
+        BoltTape_destroy(tape);
+        _destroy_offline_connection(connection);
+    }
+}
+
+SCENARIO("Test graph builder")
+{
+    GIVEN("an offline connection and a graph builder")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        struct BoltTape* tape = BoltTape_create();
+        struct BoltGraphBuilder* builder = BoltGraphBuilder_create();
+        int age = BoltGraphBuilder_add_vertex_column(builder, "age", 3);
+        int since = BoltGraphBuilder_add_edge_column(builder, "since", 5);
+        WHEN("the same path and relationship are received twice")
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                _load_path_record(state->rx_buffer);
+                BoltTape_reset(tape);
+                REQUIRE(BoltProtocolV1_unload_events(connection, BoltTape_handler(), tape) == 1);
+                REQUIRE(BoltGraphBuilder_add(builder, tape, 0) == 0);
+            }
+            BoltGraphBuilder_build(builder);
+            THEN("each entity should be added once, with dense vertex numbers")
+            {
+                REQUIRE(BoltGraphBuilder_vertex_count(builder) == 3);
+                REQUIRE(BoltGraphBuilder_edge_count(builder) == 3);
+                REQUIRE(BoltGraphBuilder_vertex(builder, 3) == 2);
+                REQUIRE(BoltGraphBuilder_vertex(builder, 4) == -1);
+                REQUIRE(BoltGraphBuilder_vertex_ids(builder)[1] == 2);
+                REQUIRE(BoltGraphBuilder_vertex_column(builder, age)[2] == 30.0);
+            }
+            THEN("the edges should be laid out by start vertex")
+            {
+                const int32_t* offsets = BoltGraphBuilder_offsets(builder);
+                REQUIRE(offsets[0] == 0);
+                REQUIRE(offsets[1] == 2);
+                REQUIRE(offsets[2] == 2);
+                REQUIRE(offsets[3] == 3);
+                const int64_t* edge_ids = BoltGraphBuilder_edge_ids(builder);
+                REQUIRE(edge_ids[0] == 10);
+                REQUIRE(edge_ids[1] == 12);
+                REQUIRE(edge_ids[2] == 11);
+                for (int32_t e = 0; e < 3; e++)
+                {
+                    REQUIRE(BoltGraphBuilder_targets(builder)[e] == 1);
+                }
+            }
+            THEN("edge columns should follow the edges")
+            {
+                const double* column = BoltGraphBuilder_edge_column(builder, since);
+                REQUIRE(column[0] == 42.0);
+                REQUIRE(std::isnan(column[1]));
+                REQUIRE(std::isnan(column[2]));
+            }
+            THEN("no more columns should be added")
+            {
+                REQUIRE(BoltGraphBuilder_add_vertex_column(builder, "name", 4) == -1);
+            }
+        }
+        BoltGraphBuilder_destroy(builder);
+        BoltTape_destroy(tape);
+        _destroy_offline_connection(connection);
+    }
+}
+
+/**
+ * Load a record holding node 1 twice over, with different ages.
+ */
+void _load_repeated_node_record(struct BoltBuffer* buffer, uint8_t first_age, uint8_t second_age)
+{
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x92);
+    for (int i = 0; i < 2; i++)
+    {
+        BoltBuffer_load_uint8(buffer, 0xB3);
+        BoltBuffer_load_uint8(buffer, 'N');
+        BoltBuffer_load_uint8(buffer, 0x01);
+        BoltBuffer_load_uint8(buffer, 0x91);
+        _load_string(buffer, "Person");
+        BoltBuffer_load_uint8(buffer, 0xA1);
+        _load_string(buffer, "age");
+        BoltBuffer_load_uint8(buffer, i == 0 ? first_age : second_age);
+    }
+}
+
+int64_t _fetched_age(struct BoltConnection* connection, int32_t index)
+{
+    struct BoltValue* node = BoltList_value(BoltConnection_fetched(connection), index);
+    return BoltInt64_get(BoltDictionary8_value(BoltStructure_value(node, 2), 0));
+}
+
+SCENARIO("Test entity sharing")
+{
+    GIVEN("an offline connection")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        WHEN("sharing is off")
+        {
+            _load_repeated_node_record(state->rx_buffer, 10, 99);
+            BoltProtocolV1_unload(connection);
+            THEN("every occurrence should be decoded separately")
+            {
+                REQUIRE(_fetched_age(connection, 0) == 10);
+                REQUIRE(_fetched_age(connection, 1) == 99);
+            }
+        }
+        WHEN("sharing is on and the same node occurs twice in a record")
+        {
+            REQUIRE(BoltConnection_set_entity_sharing(connection, 1) == 0);
+            _load_repeated_node_record(state->rx_buffer, 10, 99);
+            BoltProtocolV1_unload(connection);
+            struct BoltValue* fetched = BoltConnection_fetched(connection);
+            THEN("the second occurrence should share the first")
+            {
+                REQUIRE(BoltValue_type(BoltList_value(fetched, 1)) == BOLT_STRUCTURE);
+                REQUIRE(BoltStructure_code(BoltList_value(fetched, 1)) == 'N');
+                REQUIRE(_fetched_age(connection, 1) == 10);
+                REQUIRE(BoltStructure_value(BoltList_value(fetched, 0), 2) ==
+                        BoltStructure_value(BoltList_value(fetched, 1), 2));
+                REQUIRE(BoltBuffer_unloadable(state->rx_buffer) == 0);
+            }
+            AND_WHEN("the node occurs again in the next record")
+            {
+                struct BoltValue* properties = BoltStructure_value(BoltList_value(fetched, 0), 2);
+                _load_repeated_node_record(state->rx_buffer, 50, 60);
+                BoltProtocolV1_unload(connection);
+                THEN("it should still be shared")
+                {
+                    REQUIRE(_fetched_age(connection, 0) == 10);
+                    REQUIRE(BoltStructure_value(BoltList_value(fetched, 0), 2) == properties);
+                }
+            }
+            AND_WHEN("the record is taken and the result ends")
+            {
+                struct BoltValue* taken = BoltConnection_take_fetched(connection);
+                BoltBuffer_load_uint8(state->rx_buffer, 0xB1);
+                BoltBuffer_load_uint8(state->rx_buffer, 0x70);
+                BoltBuffer_load_uint8(state->rx_buffer, 0xA0);
+                BoltProtocolV1_unload(connection);
+                _load_repeated_node_record(state->rx_buffer, 50, 60);
+                BoltProtocolV1_unload(connection);
+                THEN("the taken record should keep its own copy of the node")
+                {
+                    struct BoltValue* properties = BoltStructure_value(BoltList_value(taken, 1), 2);
+                    REQUIRE(BoltInt64_get(BoltDictionary8_value(properties, 0)) == 10);
+                    REQUIRE(BoltValue_type(BoltList_value(BoltStructure_value(BoltList_value(taken, 0), 1), 0)) ==
+                            BOLT_STRING8);
+                    REQUIRE(_fetched_age(connection, 0) == 50);
+                }
+                BoltValue_destroy(taken);
+            }
+            AND_WHEN("the result ends and the node occurs in the next")
+            {
+                BoltBuffer_load_uint8(state->rx_buffer, 0xB1);
+                BoltBuffer_load_uint8(state->rx_buffer, 0x70);
+                BoltBuffer_load_uint8(state->rx_buffer, 0xA0);
+                BoltProtocolV1_unload(connection);
+                _load_repeated_node_record(state->rx_buffer, 50, 60);
+                BoltProtocolV1_unload(connection);
+                THEN("it should be decoded afresh")
+                {
+                    REQUIRE(_fetched_age(connection, 0) == 50);
+                    REQUIRE(_fetched_age(connection, 1) == 50);
+                }
+            }
+        }
+        _destroy_offline_connection(connection);
+    }
+}
+
+/**
+ * RECORD [id, name, 1.5, [1, 2], true]
+ */
+void _load_typed_record(struct BoltBuffer* buffer, uint8_t id, const char* name)
+{
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x95);
+    BoltBuffer_load_uint8(buffer, id);
+    if (name == NULL)
+    {
+        BoltBuffer_load_uint8(buffer, 0xC0);
+    }
+    else
+    {
+        _load_string(buffer, name);
+    }
+    BoltBuffer_load_uint8(buffer, 0xC1);
+    BoltBuffer_load_double_be(buffer, 1.5);
+    BoltBuffer_load_uint8(buffer, 0x92);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    BoltBuffer_load_uint8(buffer, 0x02);
+    BoltBuffer_load_uint8(buffer, 0xC3);
+}
+
+struct TypedRow
+{
+    int32_t id;
+    char name[8];
+    double score;
+    char flag;
+    int16_t missing;
+    uint64_t nulls;
+};
+
+SCENARIO("Test typed row binding")
+{
+    const struct BoltFieldBinding fields[] = {
+            BOLT_FIELD(0, BOLT_INT32, struct TypedRow, id),
+            BOLT_FIELD(1, BOLT_STRING8, struct TypedRow, name),
+            BOLT_FIELD(2, BOLT_FLOAT64, struct TypedRow, score),
+            BOLT_FIELD(4, BOLT_BIT, struct TypedRow, flag),
+            BOLT_FIELD(5, BOLT_INT16, struct TypedRow, missing),
+    };
+    GIVEN("an offline connection and a row binding")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        struct BoltRowBinding* binding = BoltRowBinding_create(fields, 5, sizeof(struct TypedRow),
+                                                               offsetof(struct TypedRow, nulls));
+        REQUIRE(binding != NULL);
+        struct TypedRow row;
+        memset(&row, 0xFF, sizeof(row));
+        WHEN("a record is decoded into a row")
+        {
+            _load_typed_record(state->rx_buffer, 7, "Alice");
+            REQUIRE(BoltRowBinding_unload(binding, connection, &row) == 1);
+            THEN("each bound field should be written to its member")
+            {
+                REQUIRE(row.id == 7);
+                REQUIRE(strcmp(row.name, "Alice") == 0);
+                REQUIRE(row.score == 1.5);
+                REQUIRE(row.flag == 1);
+            }
+            THEN("only the missing field should be flagged as null")
+            {
+                REQUIRE(row.missing == 0);
+                REQUIRE(row.nulls == (uint64_t)(1) << 4);
+            }
+        }
+        WHEN("a record with a null field is decoded")
+        {
+            _load_typed_record(state->rx_buffer, 7, NULL);
+            REQUIRE(BoltRowBinding_unload(binding, connection, &row) == 1);
+            THEN("the field should be zeroed and flagged as null")
+            {
+                REQUIRE(row.name[0] == '\0');
+                REQUIRE(row.nulls == ((uint64_t)(1) << 1 | (uint64_t)(1) << 4));
+            }
+        }
+        WHEN("a field does not fit its member")
+        {
+            _load_typed_record(state->rx_buffer, 7, "Alexander");
+            THEN("the record should fail and be discarded")
+            {
+                REQUIRE(BoltRowBinding_unload(binding, connection, &row) == -1);
+                REQUIRE(BoltBuffer_unloadable(state->rx_buffer) == 0);
+            }
+        }
+        WHEN("a message other than a record is received")
+        {
+            BoltBuffer_load_uint8(state->rx_buffer, 0xB1);
+            BoltBuffer_load_uint8(state->rx_buffer, 0x70);
+            BoltBuffer_load_uint8(state->rx_buffer, 0xA0);
+            THEN("it should be left alone")
+            {
+                REQUIRE(BoltRowBinding_unload(binding, connection, &row) == 0);
+                REQUIRE(BoltBuffer_unloadable(state->rx_buffer) == 3);
+            }
+        }
+        BoltRowBinding_destroy(binding);
+        _destroy_offline_connection(connection);
+    }
+    GIVEN("invalid field bindings")
+    {
+        THEN("no binding should be created")
+        {
+            const struct BoltFieldBinding twice[] = {
+                    BOLT_FIELD(0, BOLT_INT32, struct TypedRow, id),
+                    BOLT_FIELD(0, BOLT_FLOAT64, struct TypedRow, score),
+            };
+            REQUIRE(BoltRowBinding_create(twice, 2, sizeof(struct TypedRow), BOLT_BINDING_NO_NULL_MASK) == NULL);
+            const struct BoltFieldBinding wrong_size[] = {
+                    BOLT_FIELD(0, BOLT_INT64, struct TypedRow, id),
+            };
+            REQUIRE(BoltRowBinding_create(wrong_size, 1, sizeof(struct TypedRow), BOLT_BINDING_NO_NULL_MASK) == NULL);
+            REQUIRE(BoltRowBinding_create(fields, 5, sizeof(struct TypedRow), sizeof(struct TypedRow)) == NULL);
+        }
+    }
+    GIVEN("an offline connection over a local socket pair")
+    {
+        int sockets[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+        struct BoltConnection* connection = _offline_connection();
+        connection->transport = BOLT_INSECURE_SOCKET;
+        connection->socket = sockets[0];
+        connection->rx_buffer = BoltBuffer_create(NULL, 256);
+        const struct BoltFieldBinding id_field[] = {BOLT_FIELD(0, BOLT_INT32, struct TypedRow, id)};
+        struct BoltRowBinding* binding = BoltRowBinding_create(id_field, 1, sizeof(struct TypedRow),
+                                                               BOLT_BINDING_NO_NULL_MASK);
+        WHEN("records are sent")
+        {
+            _send_records(sockets[1], 100);
+            THEN("they should be fetched in batches of rows")
+            {
+                struct TypedRow rows[64];
+                REQUIRE(BoltRowBinding_fetch_batch_b(binding, connection, 0, rows, 64) == 64);
+                REQUIRE(BoltRowBinding_fetch_batch_b(binding, connection, 0, rows, 64) == 36);
+                for (int i = 0; i < 36; i++)
+                {
+                    REQUIRE(rows[i].id == 64 + i);
+                }
+            }
+        }
+        BoltRowBinding_destroy(binding);
+        BoltBuffer_destroy(connection->rx_buffer);
+        _destroy_offline_connection(connection);
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+}
+
+SCENARIO("Test standalone packing and unpacking")
+{
+    GIVEN("a packer")
+    {
+        struct BoltPacker* packer = BoltPacker_create(NULL);
+        WHEN("values are packed")
+        {
+            struct BoltValue* value = BoltValue_create();
+            BoltValue_to_Dictionary8(value, 2);
+            BoltDictionary8_set_key(value, 0, "name", 4);
+            BoltValue_to_String8(BoltDictionary8_value(value, 0), "Alice", 5);
+            BoltDictionary8_set_key(value, 1, "scores", 6);
+            BoltValue_to_List(BoltDictionary8_value(value, 1), 2);
+            BoltValue_to_Int64(BoltList_value(BoltDictionary8_value(value, 1), 0), 1);
+            BoltValue_to_Float64(BoltList_value(BoltDictionary8_value(value, 1), 1), 2.5);
+            REQUIRE(BoltPacker_pack(packer, value) == 0);
+            REQUIRE(BoltPacker_pack_list_header(packer, 2) == 0);
+            REQUIRE(BoltPacker_pack_null(packer) == 0);
+            REQUIRE(BoltPacker_pack_bytes(packer, "\x01\x02", 2) == 0);
+            int32_t size;
+            const char* data = BoltPacker_data(packer, &size);
+            THEN("they should be unpacked from a span of memory")
+            {
+                struct BoltUnpacker* unpacker = BoltUnpacker_create_span(data, size);
+                struct BoltValue* unpacked = BoltValue_create();
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == 1);
+                REQUIRE(BoltValue_type(unpacked) == BOLT_DICTIONARY8);
+                struct BoltValue* name = BoltDictionary8_value_by_key(unpacked, "name", 4);
+                REQUIRE(strncmp(BoltString8_get(name), "Alice", 5) == 0);
+                struct BoltValue* scores = BoltDictionary8_value_by_key(unpacked, "scores", 6);
+                REQUIRE(BoltInt64_get(BoltList_value(scores, 0)) == 1);
+                REQUIRE(BoltFloat64_get(BoltList_value(scores, 1)) == 2.5);
+                struct EventLog log;
+                memset(&log, 0, sizeof(log));
+                REQUIRE(BoltUnpacker_unpack_events(unpacker, &EVENT_LOGGER, &log) == 1);
+                REQUIRE(std::string(log.text) == "[2 null #2 ) ");
+                REQUIRE(BoltUnpacker_remaining(unpacker) == 0);
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == 0);
+                BoltValue_destroy(unpacked);
+                BoltUnpacker_destroy(unpacker);
+            }
+            THEN("a truncated value should not be unpacked")
+            {
+                struct BoltUnpacker* unpacker = BoltUnpacker_create_span(data, size - 1);
+                struct BoltValue* unpacked = BoltValue_create();
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == 1);
+                int32_t remaining = BoltUnpacker_remaining(unpacker);
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == -1);
+                REQUIRE(BoltUnpacker_remaining(unpacker) == remaining);
+                BoltValue_destroy(unpacked);
+                BoltUnpacker_destroy(unpacker);
+            }
+            BoltValue_destroy(value);
+        }
+        WHEN("a value that cannot be packed is packed")
+        {
+            struct BoltValue* value = BoltValue_create();
+            BoltValue_to_List(value, 1);
+            BoltValue_to_Request(BoltList_value(value, 0), 0x2F, 0);
+            THEN("nothing should be packed")
+            {
+                int32_t size;
+                REQUIRE(BoltPacker_pack(packer, value) == -1);
+                BoltPacker_data(packer, &size);
+                REQUIRE(size == 0);
+            }
+            BoltValue_destroy(value);
+        }
+        BoltPacker_destroy(packer);
+    }
+}
+
+struct StreamedValues
+{
+    int type;
+    int32_t size;
+    std::string data;
+    int ends;
+    int32_t fail_after;
+};
+
+int _on_stream_begin(void* context, int type, int32_t size)
+{
+    struct StreamedValues* streamed = (struct StreamedValues*)(context);
+    streamed->type = type;
+    streamed->size = size;
+    return 0;
+}
+
+int _on_stream_data(void* context, const char* data, int32_t size)
+{
+    struct StreamedValues* streamed = (struct StreamedValues*)(context);
+    streamed->data.append(data, (size_t)(size));
+    return streamed->fail_after >= 0 && (int32_t)(streamed->data.size()) > streamed->fail_after ? -1 : 0;
+}
+
+int _on_stream_end(void* context)
+{
+    ((struct StreamedValues*)(context))->ends += 1;
+    return 0;
+}
+
+/**
+ * Write RECORD ["xx...x" (`size` bytes), "small"], chunked so that the
+ * string header is split across chunks, then RECORD [1, "small"] and an
+ * empty SUCCESS summary.
+ */
+void _send_large_record(int socket, int32_t size)
+{
+    struct BoltBuffer* message = BoltBuffer_create(NULL, 1024);
+    BoltBuffer_load_uint8(message, 0xB1);
+    BoltBuffer_load_uint8(message, 0x71);
+    BoltBuffer_load_uint8(message, 0x92);
+    BoltBuffer_load_uint8(message, 0xD2);
+    BoltBuffer_load_int32_be(message, size);
+    memset(BoltBuffer_load_target(message, size), 'x', (size_t)(size));
+    _load_string(message, "small");
+    struct BoltBuffer* buffer = BoltBuffer_create(NULL, 1024);
+    int chunk_size = 5;
+    while (BoltBuffer_unloadable(message) > 0)
+    {
+        if (chunk_size > BoltBuffer_unloadable(message)) chunk_size = BoltBuffer_unloadable(message);
+        BoltBuffer_load_uint16_be(buffer, (uint16_t)(chunk_size));
+        BoltBuffer_load(buffer, BoltBuffer_unload_target(message, chunk_size), chunk_size);
+        chunk_size = 0xFFFF;
+    }
+    BoltBuffer_load_uint16_be(buffer, 0);
+    BoltBuffer_load_uint16_be(buffer, 10);
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x92);
+    BoltBuffer_load_uint8(buffer, 0x01);
+    _load_string(buffer, "small");
+    BoltBuffer_load_uint16_be(buffer, 0);
+    BoltBuffer_load_uint16_be(buffer, 3);
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x70);
+    BoltBuffer_load_uint8(buffer, 0xA0);
+    BoltBuffer_load_uint16_be(buffer, 0);
+    int total = BoltBuffer_unloadable(buffer);
+    REQUIRE(write(socket, BoltBuffer_unload_target(buffer, total), (size_t)(total)) == total);
+    BoltBuffer_destroy(buffer);
+    BoltBuffer_destroy(message);
+}
+
+void _send_large_key_and_failure(int socket, int32_t size)
+{
+    struct BoltBuffer* buffer = BoltBuffer_create(NULL, 1024);
+    BoltBuffer_load_uint16_be(buffer, (uint16_t)(size + 9));
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x71);
+    BoltBuffer_load_uint8(buffer, 0x91);
+    BoltBuffer_load_uint8(buffer, 0xA1);
+    BoltBuffer_load_uint8(buffer, 0xD1);
+    BoltBuffer_load_uint16_be(buffer, (uint16_t)(size));
+    memset(BoltBuffer_load_target(buffer, size), 'k', (size_t)(size));
+    _load_string(buffer, "v");
+    BoltBuffer_load_uint16_be(buffer, 0);
+    BoltBuffer_load_uint16_be(buffer, (uint16_t)(size + 23));
+    BoltBuffer_load_uint8(buffer, 0xB1);
+    BoltBuffer_load_uint8(buffer, 0x7F);
+    BoltBuffer_load_uint8(buffer, 0xA2);
+    _load_string(buffer, "code");
+    _load_string(buffer, "Neo");
+    _load_string(buffer, "message");
+    BoltBuffer_load_uint8(buffer, 0xD1);
+    BoltBuffer_load_uint16_be(buffer, (uint16_t)(size));
+    memset(BoltBuffer_load_target(buffer, size), 'm', (size_t)(size));
+    BoltBuffer_load_uint16_be(buffer, 0);
+    int total = BoltBuffer_unloadable(buffer);
+    REQUIRE(write(socket, BoltBuffer_unload_target(buffer, total), (size_t)(total)) == total);
+    BoltBuffer_destroy(buffer);
+}
+
+SCENARIO("Test streaming large values")
+{
+    GIVEN("an offline connection over a local socket pair, streaming to a sink")
+    {
+        int sockets[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+        struct BoltConnection* connection = _offline_connection();
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        connection->transport = BOLT_INSECURE_SOCKET;
+        connection->socket = sockets[0];
+        connection->rx_buffer = BoltBuffer_create(NULL, 256);
+        const struct BoltStreamSink sink = {_on_stream_begin, _on_stream_data, _on_stream_end};
+        struct StreamedValues streamed = {-1, -1, "", 0, -1};
+        REQUIRE(BoltConnection_set_stream_sink(connection, -1, &sink, &streamed) == -1);
+        REQUIRE(BoltConnection_set_stream_sink(connection, 1024, &sink, &streamed) == 0);
+        int32_t size = 100000;
+        WHEN("a record with a large string is received")
+        {
+            _send_large_record(sockets[1], size);
+            REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+            struct BoltValue* fetched = BoltConnection_fetched(connection);
+            THEN("the string should be streamed to the sink")
+            {
+                REQUIRE(streamed.type == BOLT_STRING8);
+                REQUIRE(streamed.size == size);
+                REQUIRE(streamed.data == std::string((size_t)(size), 'x'));
+                REQUIRE(streamed.ends == 1);
+                REQUIRE(state->rx_buffer->size < size);
+            }
+            THEN("a placeholder should be left in its stead")
+            {
+                REQUIRE(BoltValue_type(fetched) == BOLT_LIST);
+                struct BoltValue* placeholder = BoltList_value(fetched, 0);
+                REQUIRE(BoltValue_type(placeholder) == BOLT_STRUCTURE);
+                REQUIRE(BoltStructure_code(placeholder) == BOLT_STREAMED_CODE);
+                REQUIRE(BoltInt64_get(BoltStructure_value(placeholder, 0)) == BOLT_STRING8);
+                REQUIRE(BoltInt64_get(BoltStructure_value(placeholder, 1)) == size);
+                REQUIRE(BoltValue_type(BoltList_value(fetched, 1)) == BOLT_STRING8);
+                REQUIRE(BoltList_value(fetched, 1)->size == 5);
+            }
+            THEN("smaller values should be received as usual")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(BoltConnection_fetched(connection), 0)) == 1);
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == 0);
+                REQUIRE(streamed.ends == 1);
+            }
+        }
+        WHEN("the sink fails part way through")
+        {
+            streamed.fail_after = 0;
+            _send_large_record(sockets[1], size);
+            THEN("the record should be discarded and the rest received")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == -1);
+                REQUIRE((int32_t)(streamed.data.size()) < size);
+                REQUIRE(streamed.ends == 0);
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(BoltConnection_fetched(connection), 0)) == 1);
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == 0);
+            }
+        }
+        WHEN("a record with a large key and a failure with a large message are received")
+        {
+            _send_large_key_and_failure(sockets[1], 2000);
+            THEN("neither should be streamed to the sink")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+                struct BoltValue* map = BoltList_value(BoltConnection_fetched(connection), 0);
+                REQUIRE(BoltValue_type(map) == BOLT_DICTIONARY8);
+                REQUIRE(BoltDictionary8_key(map, 0)->size == 2000);
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == -1);
+                struct BoltValue* metadata = BoltSummary_value(BoltConnection_fetched(connection), 0);
+                REQUIRE(BoltValue_type(metadata) == BOLT_DICTIONARY8);
+                REQUIRE(BoltDictionary8_value(metadata, 1)->size == 2000);
+                REQUIRE(streamed.size == -1);
+            }
+        }
+        WHEN("a reader thread is started")
+        {
+            THEN("it should be refused while streaming to a sink")
+            {
+                REQUIRE(BoltConnection_start_reader(connection, 4, 0) == -1);
+                REQUIRE(connection->reader == NULL);
+                REQUIRE(BoltConnection_set_stream_sink(connection, 0, NULL, NULL) == 0);
+                REQUIRE(BoltConnection_start_reader(connection, 4, 0) == 0);
+                BoltReader_stop(connection->reader);
+                connection->reader = NULL;
+            }
+        }
+        WHEN("streaming is turned off")
+        {
+            REQUIRE(BoltConnection_set_stream_sink(connection, 0, NULL, NULL) == 0);
+            _send_large_record(sockets[1], size);
+            THEN("the string should be received in full")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, 0) == 1);
+                REQUIRE(BoltList_value(BoltConnection_fetched(connection), 0)->size == size);
+                REQUIRE(streamed.size == -1);
+            }
+        }
+        BoltBuffer_destroy(connection->rx_buffer);
+        _destroy_offline_connection(connection);
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+}
+
+SCENARIO("Test spatial points")
+{
+    GIVEN("a packer")
+    {
+        struct BoltPacker* packer = BoltPacker_create(NULL);
+        struct BoltValue* value = BoltValue_create();
+        WHEN("points and arrays of points are packed")
+        {
+            BoltValue_to_List(value, 4);
+            BoltValue_to_Float64Pair(BoltList_value(value, 0), 7203, 1.0, 2.0);
+            BoltValue_to_Float64Triple(BoltList_value(value, 1), 4979, 12.5, 55.75, 100.0);
+            struct BoltValue* pairs = BoltList_value(value, 2);
+            BoltValue_to_Float64PairArray(pairs, 4326, 3);
+            for (int32_t i = 0; i < 3; i++)
+            {
+                BoltFloat64PairArray_set(pairs, i, i, 10 * i);
+            }
+            BoltValue_to_Float64TripleArray(BoltList_value(value, 3), 9157, 1);
+            REQUIRE(BoltPacker_pack(packer, value) == 0);
+            int32_t size;
+            const char* data = BoltPacker_data(packer, &size);
+            THEN("they should be packed as Point2D and Point3D structures")
+            {
+                const char expected[] = {'\x94', '\xB3', 'X', '\xC9', '\x1C', '\x23',
+                                         '\xC1', '\x3F', '\xF0', 0, 0, 0, 0, 0, 0,
+                                         '\xC1', '\x40', 0, 0, 0, 0, 0, 0, 0,
+                                         '\xB4', 'Y', '\xC9', '\x13', '\x73'};
+                REQUIRE(memcmp(data, expected, sizeof(expected)) == 0);
+            }
+            THEN("they should be unpacked as points")
+            {
+                struct BoltUnpacker* unpacker = BoltUnpacker_create_span(data, size);
+                struct BoltValue* unpacked = BoltValue_create();
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == 1);
+                struct BoltValue* pair = BoltList_value(unpacked, 0);
+                REQUIRE(BoltValue_type(pair) == BOLT_FLOAT64_PAIR);
+                REQUIRE(BoltPoint_srid(pair) == 7203);
+                REQUIRE(BoltFloat64Pair_get_second(pair) == 2.0);
+                struct BoltValue* triple = BoltList_value(unpacked, 1);
+                REQUIRE(BoltValue_type(triple) == BOLT_FLOAT64_TRIPLE);
+                REQUIRE(BoltPoint_srid(triple) == 4979);
+                REQUIRE(BoltFloat64Triple_get_third(triple) == 100.0);
+                struct BoltValue* list = BoltList_value(unpacked, 2);
+                REQUIRE(BoltValue_type(list) == BOLT_LIST);
+                REQUIRE(list->size == 3);
+                REQUIRE(BoltPoint_srid(BoltList_value(list, 2)) == 4326);
+                REQUIRE(BoltFloat64Pair_get_second(BoltList_value(list, 2)) == 20.0);
+                REQUIRE(BoltValue_type(BoltList_value(BoltList_value(unpacked, 3), 0)) == BOLT_FLOAT64_TRIPLE);
+                BoltValue_destroy(unpacked);
+                BoltUnpacker_destroy(unpacker);
+            }
+        }
+        WHEN("points with SRIDs beyond 16 bits are packed")
+        {
+            BoltValue_to_List(value, 2);
+            BoltValue_to_Float64Pair(BoltList_value(value, 0), 100000, 1.0, 2.0);
+            BoltValue_to_Float64Triple(BoltList_value(value, 1), -5000000000, 1.0, 2.0, 3.0);
+            REQUIRE(BoltPacker_pack(packer, value) == 0);
+            int32_t size;
+            const char* data = BoltPacker_data(packer, &size);
+            THEN("they should be unpacked as points with the same SRIDs")
+            {
+                const char expected[] = {'\x92', '\xB3', 'X', '\xCA', 0, '\x01', '\x86', '\xA0'};
+                REQUIRE(memcmp(data, expected, sizeof(expected)) == 0);
+                struct BoltUnpacker* unpacker = BoltUnpacker_create_span(data, size);
+                struct BoltValue* unpacked = BoltValue_create();
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == 1);
+                REQUIRE(BoltValue_type(BoltList_value(unpacked, 0)) == BOLT_FLOAT64_PAIR);
+                REQUIRE(BoltPoint_srid(BoltList_value(unpacked, 0)) == 100000);
+                REQUIRE(BoltValue_type(BoltList_value(unpacked, 1)) == BOLT_FLOAT64_TRIPLE);
+                REQUIRE(BoltPoint_srid(BoltList_value(unpacked, 1)) == -5000000000);
+                REQUIRE(BoltFloat64Triple_get_third(BoltList_value(unpacked, 1)) == 3.0);
+                BoltValue_destroy(unpacked);
+                BoltUnpacker_destroy(unpacker);
+            }
+        }
+        WHEN("a structure like a point has fields of the wrong types")
+        {
+            BoltValue_to_Structure(value, 'X', 3);
+            BoltValue_to_String8(BoltStructure_value(value, 0), "7203", 4);
+            BoltValue_to_Float64(BoltStructure_value(value, 1), 1.0);
+            BoltValue_to_Float64(BoltStructure_value(value, 2), 2.0);
+            REQUIRE(BoltPacker_pack(packer, value) == 0);
+            int32_t size;
+            const char* data = BoltPacker_data(packer, &size);
+            THEN("it should be unpacked as a plain structure")
+            {
+                struct BoltUnpacker* unpacker = BoltUnpacker_create_span(data, size);
+                struct BoltValue* unpacked = BoltValue_create();
+                REQUIRE(BoltUnpacker_unpack(unpacker, unpacked) == 1);
+                REQUIRE(BoltValue_type(unpacked) == BOLT_STRUCTURE);
+                REQUIRE(BoltStructure_code(unpacked) == 'X');
+                REQUIRE(BoltValue_type(BoltStructure_value(unpacked, 0)) == BOLT_STRING8);
+                BoltValue_destroy(unpacked);
+                BoltUnpacker_destroy(unpacker);
+            }
+        }
+        BoltValue_destroy(value);
+        BoltPacker_destroy(packer);
+    }
+    GIVEN("an offline connection speaking Bolt v1")
+    {
+        struct BoltConnection* connection = _offline_connection();
+        connection->tx_buffer = BoltBuffer_create(NULL, 256);
+        struct BoltValue* value = BoltValue_create();
+        BoltValue_to_Float64Pair(value, 7203, 1.0, 2.0);
+        THEN("points should not be loaded")
+        {
+            REQUIRE(BoltProtocolV1_load(connection, value) == -1);
+            connection->protocol_version = 2;
+            REQUIRE(BoltProtocolV1_load(connection, value) == 0);
+        }
+        THEN("frozen points should not be loaded either")
+        {
+            REQUIRE(BoltValue_freeze(value) == 0);
+            REQUIRE((value->flags & BOLT_VALUE_FROZEN_V2) != 0);
+            REQUIRE(BoltProtocolV1_load(connection, value) == -1);
+            connection->protocol_version = 2;
+            REQUIRE(BoltProtocolV1_load(connection, value) == 0);
+        }
+        THEN("a bulk writer over it should not take points")
+        {
+            const char* statement = "UNWIND $rows AS row CREATE (:Place {at: row.at})";
+            struct BoltBulkWriter* writer = BoltBulkWriter_create(&connection, 1, statement, strlen(statement), 1);
+            REQUIRE(writer != NULL);
+            REQUIRE(BoltBulkWriter_set_field_key(writer, 0, "at", 2) == 0);
+            BoltValue_copy(value, BoltBulkWriter_field_value(writer, 0));
+            REQUIRE(BoltBulkWriter_append_b(writer) == -1);
+            REQUIRE(BoltBulkWriter_set_integer(writer, 0, 1) == 0);
+            REQUIRE(BoltBulkWriter_append_b(writer) == 0);
+            BoltBulkWriter_destroy(writer);
+        }
+        BoltValue_destroy(value);
+        BoltBuffer_destroy(connection->tx_buffer);
+        _destroy_offline_connection(connection);
+    }
+}
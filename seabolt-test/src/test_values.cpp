@@ -23,6 +23,8 @@
 #include "test_values.hpp"
 
 extern "C" {
+    #include "arena.h"
+    #include "compact.h"
     #include "mem.h"
     #include "values.h"
 }
@@ -957,3 +959,330 @@ int test_types()
     assert(BoltMem_current_allocation() == 0);
     printf("*******\nMemory activity: %lld\n*******\n", BoltMem_allocation_events());
 }
+
+SCENARIO("Test Dictionary8 keyed lookup")
+{
+    GIVEN("dictionaries below and above the index threshold")
+    {
+        for (int32_t size = 4; size <= 64; size *= 4)
+        {
+            struct BoltValue* value = BoltValue_create();
+            BoltValue_to_Dictionary8(value, size);
+            char key[16];
+            for (int32_t i = 0; i < size; i++)
+            {
+                int key_size = snprintf(key, sizeof(key), "key_%d", i);
+                BoltDictionary8_set_key(value, i, key, (size_t)(key_size));
+                BoltValue_to_Int64(BoltDictionary8_value(value, i), i);
+            }
+            WHEN("every key is looked up")
+            {
+                THEN("the matching value should be found")
+                {
+                    for (int32_t i = 0; i < size; i++)
+                    {
+                        int key_size = snprintf(key, sizeof(key), "key_%d", i);
+                        struct BoltValue* found = BoltDictionary8_value_by_key(value, key, (size_t)(key_size));
+                        REQUIRE(found != NULL);
+                        REQUIRE(BoltInt64_get(found) == i);
+                    }
+                    REQUIRE(BoltDictionary8_value_by_key(value, "missing", 7) == NULL);
+                    REQUIRE(((value->flags & BOLT_VALUE_INDEXED) != 0) == (size >= 16));
+                }
+            }
+            WHEN("a key is changed after lookup")
+            {
+                BoltDictionary8_value_by_key(value, "key_0", 5);
+                BoltDictionary8_set_key(value, 0, "renamed", 7);
+                THEN("the new key should be found and the old one not")
+                {
+                    REQUIRE(BoltDictionary8_value_by_key(value, "key_0", 5) == NULL);
+                    REQUIRE(BoltInt64_get(BoltDictionary8_value_by_key(value, "renamed", 7)) == 0);
+                }
+            }
+            WHEN("the dictionary is shrunk after lookup")
+            {
+                BoltDictionary8_value_by_key(value, "key_0", 5);
+                BoltValue_to_Dictionary8(value, 2);
+                THEN("removed keys should no longer be found")
+                {
+                    REQUIRE((value->flags & BOLT_VALUE_INDEXED) == 0);
+                    REQUIRE(BoltDictionary8_value_by_key(value, "key_3", 5) == NULL);
+                    REQUIRE(BoltInt64_get(BoltDictionary8_value_by_key(value, "key_1", 5)) == 1);
+                }
+            }
+            BoltValue_destroy(value);
+        }
+    }
+}
+
+SCENARIO("Test arena chunk reuse")
+{
+    GIVEN("an arena")
+    {
+        struct BoltArena* arena = BoltArena_create(NULL, 1024);
+        WHEN("a round of allocations overflows the first chunk")
+        {
+            BoltArena_allocate(arena, 3000);
+            BoltArena_reset(arena);
+            size_t capacity = arena->capacity;
+            THEN("later rounds of the same size should allocate nothing further")
+            {
+                REQUIRE(capacity > 3000);
+                long long events = BoltMem_allocation_events();
+                for (int i = 0; i < 10; i++)
+                {
+                    BoltArena_allocate(arena, 3000);
+                    BoltArena_reset(arena);
+                }
+                REQUIRE(BoltMem_allocation_events() == events);
+                REQUIRE(arena->capacity == capacity);
+            }
+            THEN("the chunk should be given back after many small rounds")
+            {
+                for (int i = 0; i < 15; i++)
+                {
+                    BoltArena_allocate(arena, 100);
+                    BoltArena_reset(arena);
+                }
+                REQUIRE(arena->capacity == capacity);
+                BoltArena_reset(arena);
+                REQUIRE(arena->capacity == 1024);
+            }
+        }
+        WHEN("a round of allocations is very large")
+        {
+            BoltArena_allocate(arena, 4 * 1024 * 1024);
+            BoltArena_reset(arena);
+            THEN("the arena should drop back to its initial chunk size")
+            {
+                REQUIRE(arena->capacity == 1024);
+            }
+        }
+        BoltArena_destroy(arena);
+    }
+}
+
+SCENARIO("Test container storage reuse")
+{
+    GIVEN("a value reused for containers of different shapes")
+    {
+        struct BoltValue* value = BoltValue_create();
+        BoltValue_to_List(value, 5);
+        BoltValue_to_Int64(BoltList_value(value, 4), 4);
+        WHEN("it alternates between lists, summaries and dictionaries")
+        {
+            long long events = BoltMem_allocation_events();
+            for (int i = 0; i < 10; i++)
+            {
+                BoltValue_to_Summary(value, 0x70, 1);
+                BoltValue_to_Dictionary8(value, 2);
+                BoltValue_to_List(value, 5);
+            }
+            THEN("its storage should be reused")
+            {
+                REQUIRE(BoltMem_allocation_events() == events);
+                REQUIRE(BoltValue_type(BoltList_value(value, 4)) == BOLT_NULL);
+            }
+        }
+        WHEN("a list grows one entry at a time")
+        {
+            BoltValue_to_List(value, 0);
+            long long events = BoltMem_allocation_events();
+            for (int i = 0; i < 1000; i++)
+            {
+                BoltList_resize(value, i + 1);
+                BoltValue_to_Int64(BoltList_value(value, i), i);
+            }
+            THEN("storage should be reallocated only occasionally")
+            {
+                REQUIRE(BoltMem_allocation_events() - events < 40);
+                REQUIRE(BoltInt64_get(BoltList_value(value, 999)) == 999);
+            }
+            AND_WHEN("it shrinks to almost nothing")
+            {
+                BoltList_resize(value, 1);
+                THEN("most of its storage should be given back")
+                {
+                    REQUIRE(value->data_size < 1000 * sizeof(struct BoltValue) / 4);
+                    REQUIRE(BoltInt64_get(BoltList_value(value, 0)) == 0);
+                }
+            }
+        }
+        BoltValue_destroy(value);
+    }
+}
+
+SCENARIO("Test copying, moving and swapping values")
+{
+    GIVEN("a nested value")
+    {
+        struct BoltValue* value = BoltValue_create();
+        BoltValue_to_List(value, 3);
+        BoltValue_to_String8(BoltList_value(value, 0), "a string too long to fit inline", 31);
+        struct BoltValue* map = BoltList_value(value, 1);
+        BoltValue_to_Dictionary8(map, 1);
+        BoltDictionary8_set_key(map, 0, "numbers", 7);
+        int32_t numbers[] = {1, 2, 3, 4, 5, 6, 7, 8};
+        BoltValue_to_Int32Array(BoltDictionary8_value(map, 0), numbers, 8);
+        BoltValue_to_Float64(BoltList_value(value, 2), 1.5);
+        struct BoltValue* target = BoltValue_create();
+        WHEN("the value is copied")
+        {
+            BoltValue_copy(value, target);
+            BoltValue_to_Null(value);
+            THEN("the copy should hold the same data in storage of its own")
+            {
+                REQUIRE(BoltValue_type(target) == BOLT_LIST);
+                REQUIRE(target->size == 3);
+                REQUIRE(strncmp(BoltString8_get(BoltList_value(target, 0)), "a string too long to fit inline", 31) == 0);
+                struct BoltValue* array = BoltDictionary8_value_by_key(BoltList_value(target, 1), "numbers", 7);
+                REQUIRE(array != NULL);
+                REQUIRE(BoltInt32Array_get(array, 7) == 8);
+                REQUIRE(BoltFloat64_get(BoltList_value(target, 2)) == 1.5);
+            }
+        }
+        WHEN("the value is moved")
+        {
+            struct BoltValue* nested = BoltList_value(value, 0);
+            BoltValue_move(value, target);
+            THEN("the target should take over the storage and the source become null")
+            {
+                REQUIRE(BoltValue_type(value) == BOLT_NULL);
+                REQUIRE(BoltValue_type(target) == BOLT_LIST);
+                REQUIRE(BoltList_value(target, 0) == nested);
+            }
+        }
+        WHEN("the value is swapped with another")
+        {
+            BoltValue_to_Int64(target, 42);
+            BoltValue_swap(value, target);
+            THEN("each should hold the other's contents")
+            {
+                REQUIRE(BoltValue_type(value) == BOLT_INT64);
+                REQUIRE(BoltInt64_get(value) == 42);
+                REQUIRE(BoltValue_type(target) == BOLT_LIST);
+                REQUIRE(target->size == 3);
+            }
+        }
+        BoltValue_destroy(target);
+        BoltValue_destroy(value);
+    }
+}
+
+SCENARIO("Test Float64 point values")
+{
+    GIVEN("a new value")
+    {
+        struct BoltValue* value = BoltValue_create();
+        WHEN("it is set to a 2D point")
+        {
+            BoltValue_to_Float64Pair(value, 7203, 1.5, -2.5);
+            THEN("it should hold the coordinates and SRID")
+            {
+                REQUIRE(BoltValue_type(value) == BOLT_FLOAT64_PAIR);
+                REQUIRE(BoltPoint_srid(value) == 7203);
+                REQUIRE(BoltFloat64Pair_get_first(value) == 1.5);
+                REQUIRE(BoltFloat64Pair_get_second(value) == -2.5);
+            }
+        }
+        WHEN("it is set to a 3D point and copied")
+        {
+            BoltValue_to_Float64Triple(value, 4979, 12.5, 55.75, 100.0);
+            struct BoltValue* copy = BoltValue_create();
+            BoltValue_copy(value, copy);
+            BoltValue_to_Null(value);
+            THEN("the copy should hold the coordinates and SRID")
+            {
+                REQUIRE(BoltValue_type(copy) == BOLT_FLOAT64_TRIPLE);
+                REQUIRE(BoltPoint_srid(copy) == 4979);
+                REQUIRE(BoltFloat64Triple_get_first(copy) == 12.5);
+                REQUIRE(BoltFloat64Triple_get_second(copy) == 55.75);
+                REQUIRE(BoltFloat64Triple_get_third(copy) == 100.0);
+            }
+            BoltValue_destroy(copy);
+        }
+        WHEN("it is set to arrays of points")
+        {
+            THEN("each point should be held in turn")
+            {
+                for (int32_t size = 0; size < 4; size++)
+                {
+                    BoltValue_to_Float64PairArray(value, 4326, size);
+                    for (int32_t i = 0; i < size; i++)
+                    {
+                        BoltFloat64PairArray_set(value, i, i, -i);
+                    }
+                    REQUIRE(BoltValue_type(value) == BOLT_FLOAT64_PAIR_ARRAY);
+                    REQUIRE(value->size == size);
+                    REQUIRE(BoltPoint_srid(value) == 4326);
+                    for (int32_t i = 0; i < size; i++)
+                    {
+                        REQUIRE(BoltFloat64PairArray_get_first(value, i) == i);
+                        REQUIRE(BoltFloat64PairArray_get_second(value, i) == -i);
+                    }
+                }
+                BoltValue_to_Float64TripleArray(value, 9157, 3);
+                BoltFloat64TripleArray_set(value, 2, 1.0, 2.0, 3.0);
+                REQUIRE(BoltValue_type(value) == BOLT_FLOAT64_TRIPLE_ARRAY);
+                REQUIRE(BoltFloat64TripleArray_get_first(value, 0) == 0.0);
+                REQUIRE(BoltFloat64TripleArray_get_first(value, 2) == 1.0);
+                REQUIRE(BoltFloat64TripleArray_get_second(value, 2) == 2.0);
+                REQUIRE(BoltFloat64TripleArray_get_third(value, 2) == 3.0);
+            }
+        }
+        BoltValue_destroy(value);
+    }
+}
+
+SCENARIO("Test compact values")
+{
+    GIVEN("a nested value")
+    {
+        struct BoltValue* value = BoltValue_create();
+        BoltValue_to_List(value, 4);
+        BoltValue_to_Int64(BoltList_value(value, 0), 123456789012LL);
+        BoltValue_to_String8(BoltList_value(value, 1), "short", 5);
+        BoltValue_to_String8(BoltList_value(value, 2), "a string too long to fit inline", 31);
+        struct BoltValue* map = BoltList_value(value, 3);
+        BoltValue_to_Dictionary8(map, 1);
+        BoltDictionary8_set_key(map, 0, "score", 5);
+        BoltValue_to_Float64(BoltDictionary8_value(map, 0), 0.75);
+        WHEN("a compact copy is created")
+        {
+            const struct BoltCompactValue* compact = BoltCompactValue_create(value);
+            THEN("each compact value should occupy 16 bytes")
+            {
+                REQUIRE(sizeof(struct BoltCompactValue) == 16);
+            }
+            THEN("the copy should hold the same data")
+            {
+                REQUIRE(BoltCompactValue_type(compact) == BOLT_LIST);
+                REQUIRE(compact->size == 4);
+                REQUIRE(BoltCompactInt64_get(BoltCompactList_value(compact, 0)) == 123456789012LL);
+                REQUIRE(strncmp(BoltCompactString8_get(BoltCompactList_value(compact, 1)), "short", 5) == 0);
+                const struct BoltCompactValue* string = BoltCompactList_value(compact, 2);
+                REQUIRE(string->size == 31);
+                REQUIRE(strncmp(BoltCompactString8_get(string), "a string too long to fit inline", 31) == 0);
+                const struct BoltCompactValue* compact_map = BoltCompactList_value(compact, 3);
+                REQUIRE(BoltCompactValue_type(compact_map) == BOLT_DICTIONARY8);
+                REQUIRE(strncmp(BoltCompactString8_get(BoltCompactDictionary8_key(compact_map, 0)), "score", 5) == 0);
+                REQUIRE(BoltCompactFloat64_get(BoltCompactDictionary8_value(compact_map, 0)) == 0.75);
+            }
+            THEN("the copy should occupy a single block of memory")
+            {
+                REQUIRE(BoltCompactValue_memory(compact) == 16 + 7 * 16 + 31);
+            }
+            BoltCompactValue_destroy(compact);
+        }
+        WHEN("the value contains an unsupported type")
+        {
+            BoltValue_to_Int32(BoltList_value(value, 0), 1);
+            THEN("no compact copy should be created")
+            {
+                REQUIRE(BoltCompactValue_create(value) == NULL);
+            }
+        }
+        BoltValue_destroy(value);
+    }
+}
@@ -24,6 +24,7 @@
 
 extern "C" {
     #include "mem.h"
+    #include "values.h"
 }
 
 
@@ -77,3 +78,159 @@ SCENARIO("Test memcpy_be macro")
         }
     }
 }
+
+SCENARIO("Test fixed-width byte-swap primitives")
+{
+    GIVEN("multi-byte integers")
+    {
+        THEN("the bytes of each should be reversed")
+        {
+            REQUIRE(bswap_uint16((uint16_t)(0xABCD)) == 0xCDAB);
+            REQUIRE(bswap_uint32(0x01234567U) == 0x67452301U);
+            REQUIRE(bswap_uint64(0x0123456789ABCDEFULL) == 0xEFCDAB8967452301ULL);
+        }
+    }
+    GIVEN("an 8-byte big-endian block")
+    {
+        const char* data = "\x01\x23\x45\x67\x89\xAB\xCD\xEF";
+        WHEN("the data is copied into an unsigned 64-bit integer in big-endian order")
+        {
+            uint64_t x;
+            memcpy_be64(&x, data);
+            THEN("the first byte should be most significant")
+            {
+                REQUIRE(x == 0x0123456789ABCDEFULL);
+            }
+        }
+    }
+}
+
+SCENARIO("Test bulk byte-order conversion against memcpy_r")
+{
+    GIVEN("arrays long enough to exercise both vector and scalar paths")
+    {
+        const size_t n = 37;
+        uint64_t source[n];
+        for (size_t i = 0; i < n; i++)
+        {
+            source[i] = 0x0102030405060708ULL * (i + 1);
+        }
+        WHEN("2-byte elements are converted")
+        {
+            uint16_t target[n];
+            memcpy_be16_array(&target[0], &source[0], n);
+            THEN("each element should match a single reversed copy")
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    uint16_t expected;
+                    memcpy_r(&expected, &((uint16_t*)(&source[0]))[i], 2);
+                    REQUIRE(target[i] == expected);
+                }
+            }
+        }
+        WHEN("4-byte elements are converted")
+        {
+            uint32_t target[n];
+            memcpy_be32_array(&target[0], &source[0], n);
+            THEN("each element should match a single reversed copy")
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    uint32_t expected;
+                    memcpy_r(&expected, &((uint32_t*)(&source[0]))[i], 4);
+                    REQUIRE(target[i] == expected);
+                }
+            }
+        }
+        WHEN("8-byte elements are converted")
+        {
+            uint64_t target[n];
+            memcpy_be64_array(&target[0], &source[0], n);
+            THEN("each element should match a single reversed copy")
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    uint64_t expected;
+                    memcpy_r(&expected, &source[i], 8);
+                    REQUIRE(target[i] == expected);
+                }
+            }
+        }
+    }
+}
+
+static long long outstanding_bytes = 0;
+
+static void* counting_allocate(void* context, size_t size)
+{
+    outstanding_bytes += size;
+    return malloc(size);
+}
+
+static void* counting_reallocate(void* context, void* ptr, size_t old_size, size_t new_size)
+{
+    outstanding_bytes += new_size - old_size;
+    return realloc(ptr, new_size);
+}
+
+static void counting_deallocate(void* context, void* ptr, size_t size)
+{
+    outstanding_bytes -= size;
+    free(ptr);
+}
+
+SCENARIO("Test pluggable allocators")
+{
+    GIVEN("a custom allocator installed at startup")
+    {
+        struct BoltAllocator allocator = {"counting", counting_allocate, counting_reallocate, counting_deallocate,
+                                          NULL, {0, 0, 0}};
+        BoltMem_set_allocator(&allocator);
+        WHEN("values are created, resized and destroyed")
+        {
+            struct BoltValue* value = BoltValue_create();
+            BoltValue_to_List(value, 4);
+            BoltValue_to_String8(BoltList_value(value, 0), "a string too long to fit inline", 31);
+            BoltList_resize(value, 8);
+            size_t peak = allocator.stats.peak_allocation;
+            BoltValue_destroy(value);
+            BoltMem_set_allocator(NULL);
+            THEN("every block should be returned with the size it was allocated with")
+            {
+                REQUIRE(outstanding_bytes == 0);
+                REQUIRE(allocator.stats.current_allocation == 0);
+                REQUIRE(peak > 0);
+                REQUIRE(allocator.stats.allocation_events > 0);
+            }
+        }
+        BoltMem_set_allocator(NULL);
+    }
+    GIVEN("a slab allocator")
+    {
+        struct BoltAllocator* slab = BoltMem_create_slab_allocator(sizeof(struct BoltValue), 4);
+        WHEN("more blocks are allocated than fit in one slab and then freed")
+        {
+            void* blocks[10];
+            for (int i = 0; i < 10; i++)
+            {
+                blocks[i] = BoltAllocator_allocate(slab, sizeof(struct BoltValue));
+                memset(blocks[i], i, sizeof(struct BoltValue));
+            }
+            void* large = BoltAllocator_allocate(slab, 1000);
+            for (int i = 0; i < 10; i++)
+            {
+                BoltAllocator_deallocate(slab, blocks[i], sizeof(struct BoltValue));
+            }
+            BoltAllocator_deallocate(slab, large, 1000);
+            THEN("freed blocks should be reused")
+            {
+                void* block = BoltAllocator_allocate(slab, sizeof(struct BoltValue));
+                REQUIRE(block == blocks[9]);
+                BoltAllocator_deallocate(slab, block, sizeof(struct BoltValue));
+                REQUIRE(slab->stats.current_allocation == 0);
+            }
+        }
+        BoltMem_destroy_slab_allocator(slab);
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_BINDING
+#define SEABOLT_BINDING
+
+#include <stddef.h>
+#include <stdint.h>
+#include "connect.h"
+#include "values.h"
+
+
+/// Maximum number of fields in a row binding
+#define BOLT_BINDING_MAX_FIELDS 64
+
+/// Null mask offset of a row binding that has no null mask
+#define BOLT_BINDING_NO_NULL_MASK ((size_t)(-1))
+
+/**
+ * Describe how a record field is written to a member of a row struct.
+ *
+ * The type of the member is given as one of:
+ *
+ * - `BOLT_BIT` for a `char` set to 0 or 1, from a boolean
+ * - `BOLT_INT8`, `BOLT_INT16`, `BOLT_INT32` or `BOLT_INT64` for an
+ *   integer of that width, from an integer in range or a boolean
+ * - `BOLT_FLOAT32` or `BOLT_FLOAT64` for a `float` or `double`, from a
+ *   float or an integer
+ * - `BOLT_STRING8` for a `char` array, from a string short enough to fit
+ *   with a terminating null
+ */
+struct BoltFieldBinding
+{
+    /// Index of the field within each record
+    int32_t field;
+    enum BoltType type;
+    /// Offset of the member within the row struct
+    size_t offset;
+    /// Size of the member
+    size_t size;
+};
+
+/**
+ * Describe the binding of record field `field` to `member` of `row_type`.
+ */
+#define BOLT_FIELD(field, type, row_type, member) \
+    { (field), (type), offsetof(row_type, member), sizeof(((row_type*)(0))->member) }
+
+/**
+ * A fixed mapping from the fields of each received record to the
+ * members of a caller-defined row struct, so that records are decoded
+ * straight into rows without building any values along the way.
+ *
+ * Where a row has a null mask, a `uint64_t` member, bit `i` of it is
+ * set if the field of binding `i` is null or missing from the record
+ * (the member itself is then zeroed) and cleared otherwise. Without a
+ * null mask, nulls are only zeroed. Fields that are not bound are
+ * skipped over.
+ *
+ * A field that cannot be converted to the type of its member fails the
+ * whole record, leaving the row partly written.
+ */
+struct BoltRowBinding;
+
+
+/**
+ * Create a row binding.
+ *
+ * @param fields
+ * @param n_fields
+ * @param row_size the size of the row struct
+ * @param null_offset the offset of the null mask within the row struct,
+ *                    or BOLT_BINDING_NO_NULL_MASK
+ * @return the binding, or NULL if any field is unsupported or lies
+ *         outside of the row
+ */
+struct BoltRowBinding* BoltRowBinding_create(const struct BoltFieldBinding* fields, int32_t n_fields,
+                                             size_t row_size, size_t null_offset);
+
+void BoltRowBinding_destroy(struct BoltRowBinding* binding);
+
+/**
+ * Decode a received record into a row.
+ *
+ * @param binding
+ * @param connection
+ * @param row
+ * @return 1 if a record was decoded, 0 if the message is not a record
+ *         (and is left for `BoltProtocolV1_unload`), -1 on error
+ */
+int BoltRowBinding_unload(struct BoltRowBinding* binding, struct BoltConnection* connection, void* row);
+
+/**
+ * Fetch a record into a row.
+ *
+ * @param binding
+ * @param connection
+ * @param request_id
+ * @param row
+ * @return 1 if a record was fetched, 0 if the summary was received, -1
+ *         on error
+ */
+int BoltRowBinding_fetch_b(struct BoltRowBinding* binding, struct BoltConnection* connection, int request_id,
+                           void* row);
+
+/**
+ * Fetch records into consecutive rows of an array, until the array is
+ * full or the summary is received.
+ *
+ * @param binding
+ * @param connection
+ * @param request_id
+ * @param rows
+ * @param n_rows the number of rows in the array
+ * @return the number of rows fetched (fewer than `n_rows` only once the
+ *         summary has been received), or -1 on error
+ */
+int32_t BoltRowBinding_fetch_batch_b(struct BoltRowBinding* binding, struct BoltConnection* connection,
+                                     int request_id, void* rows, int32_t n_rows);
+
+
+#endif // SEABOLT_BINDING
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_BULK
+#define SEABOLT_BULK
+
+#include <stdint.h>
+#include "connect.h"
+#include "values.h"
+
+
+#define BOLT_BULK_DEFAULT_MAX_ROWS 1000
+#define BOLT_BULK_DEFAULT_MAX_BYTES (1024 * 1024)
+#define BOLT_BULK_DEFAULT_MAX_IN_FLIGHT 2
+
+/**
+ * A writer that loads rows in bulk, in batches run through a single
+ * `UNWIND $rows AS row ...` statement.
+ *
+ * Rows are appended one at a time: each field of the current row is set
+ * and the row is then appended with `BoltBulkWriter_append_b`, which
+ * encodes it straight into the current batch as a map from field key to
+ * value. The batch is sent as the `rows` parameter of the statement,
+ * in a transaction of its own, as soon as it reaches the row or byte
+ * limit. Batches are pipelined: the writer only waits for a batch to be
+ * acknowledged when the maximum number of batches is already in flight
+ * on its connection. Where the writer is given several connections,
+ * batches are sent to each in turn.
+ *
+ * Once a batch fails, the writer stops sending and every further call
+ * returns -1. The status of the connection on which it failed is left
+ * as reported by the server.
+ */
+struct BoltBulkWriter;
+
+
+/**
+ * Create a bulk writer.
+ *
+ * @param connections the (initialised) connections to send batches over
+ * @param n_connections
+ * @param statement the statement to run for each batch, which should
+ *                  read its rows from the `rows` parameter
+ * @param size the size of the statement
+ * @param n_fields the number of fields in each row
+ * @return the writer, or NULL if any connection does not support it or
+ *         the statement cannot be prepared for it (see
+ *         `BoltConnection_prepare`)
+ */
+struct BoltBulkWriter* BoltBulkWriter_create(struct BoltConnection** connections, int n_connections,
+                                             const char* statement, size_t size, int32_t n_fields);
+
+/**
+ * Destroy a bulk writer, discarding any rows not yet sent. Use
+ * `BoltBulkWriter_finish_b` first to send them.
+ *
+ * @param writer
+ */
+void BoltBulkWriter_destroy(struct BoltBulkWriter* writer);
+
+/**
+ * Set the key of a row field, as read by the statement (`row.key`).
+ *
+ * @param writer
+ * @param index
+ * @param key
+ * @param key_size
+ * @return 0 on success, -1 if the index is out of range
+ */
+int BoltBulkWriter_set_field_key(struct BoltBulkWriter* writer, int32_t index, const char* key, size_t key_size);
+
+/**
+ * Set the size at which a batch is sent.
+ *
+ * @param writer
+ * @param max_rows the maximum number of rows per batch
+ * @param max_bytes the encoded size above which a batch is sent early
+ * @return 0 on success, -1 if either limit is out of range
+ */
+int BoltBulkWriter_set_batch_limits(struct BoltBulkWriter* writer, int32_t max_rows, int32_t max_bytes);
+
+/**
+ * Set the maximum number of batches awaiting acknowledgement on each
+ * connection.
+ *
+ * @param writer
+ * @param n at least 1
+ * @return 0 on success, -1 if out of range or batches are already in flight
+ */
+int BoltBulkWriter_set_max_in_flight(struct BoltBulkWriter* writer, int32_t n);
+
+int BoltBulkWriter_set_null(struct BoltBulkWriter* writer, int32_t field);
+
+int BoltBulkWriter_set_boolean(struct BoltBulkWriter* writer, int32_t field, int x);
+
+int BoltBulkWriter_set_integer(struct BoltBulkWriter* writer, int32_t field, int64_t x);
+
+int BoltBulkWriter_set_float(struct BoltBulkWriter* writer, int32_t field, double x);
+
+int BoltBulkWriter_set_string(struct BoltBulkWriter* writer, int32_t field, const char* string, size_t size);
+
+/**
+ * Obtain the value of a field of the current row, to set it to a type
+ * with no setter of its own (such as a list).
+ *
+ * @param writer
+ * @param field
+ * @return the value, or NULL if the index is out of range
+ */
+struct BoltValue* BoltBulkWriter_field_value(struct BoltBulkWriter* writer, int32_t field);
+
+/**
+ * Append the current row to the batch, sending the batch if it is full.
+ *
+ * Every field is reset to null afterwards.
+ *
+ * @param writer
+ * @return 0 on success, -1 if the row cannot be encoded (it is then left
+ *         out) or a batch fails
+ */
+int BoltBulkWriter_append_b(struct BoltBulkWriter* writer);
+
+/**
+ * Send the current batch, if it holds any rows.
+ *
+ * @param writer
+ * @return 0 on success, -1 if a batch fails
+ */
+int BoltBulkWriter_flush_b(struct BoltBulkWriter* writer);
+
+/**
+ * Send the current batch and wait for every batch in flight to be
+ * acknowledged.
+ *
+ * @param writer
+ * @return 0 on success, -1 if a batch fails
+ */
+int BoltBulkWriter_finish_b(struct BoltBulkWriter* writer);
+
+/**
+ * The number of rows written so far, in batches acknowledged as
+ * committed.
+ *
+ * @param writer
+ * @return
+ */
+int64_t BoltBulkWriter_rows_written(struct BoltBulkWriter* writer);
+
+
+#endif // SEABOLT_BULK
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_COMPACT
+#define SEABOLT_COMPACT
+
+#include <stdint.h>
+#include "values.h"
+
+
+/**
+ * A compact, immutable copy of a value.
+ *
+ * Each compact value occupies 16 bytes (half the size of a BoltValue)
+ * and a whole tree, including any string data, is held in a single
+ * block of memory. Nested values are laid out contiguously, four to a
+ * 64-byte cache line, and no spare capacity is ever reserved. This
+ * makes compact values well suited to holding on to large numbers of
+ * records once fetched.
+ *
+ * Strings and byte arrays of up to 8 bytes are held inline. Supported
+ * types are null, bit, Int64, Float64, UTF-8 strings, byte arrays,
+ * lists, UTF-8 dictionaries, structures and summaries.
+ */
+struct BoltCompactValue
+{
+    int8_t type;
+    uint8_t flags;              // reserved
+    int16_t code;
+    int32_t size;
+    union
+    {
+        char as_char[8];
+        int64_t as_int64;
+        double as_double;
+        const char* as_ptr;
+        const struct BoltCompactValue* as_value;
+    } data;
+};
+
+
+/**
+ * Create a compact copy of a value.
+ *
+ * @param value the value to copy
+ * @return the compact copy, or NULL if the value contains an unsupported type
+ */
+const struct BoltCompactValue* BoltCompactValue_create(const struct BoltValue* value);
+
+/**
+ * Destroy a compact value created by `BoltCompactValue_create`.
+ *
+ * Only the top-level value should be destroyed; nested values share
+ * its storage.
+ *
+ * @param value
+ */
+void BoltCompactValue_destroy(const struct BoltCompactValue* value);
+
+/**
+ * Return the number of bytes of memory occupied by a compact value tree.
+ *
+ * @param value
+ * @return
+ */
+size_t BoltCompactValue_memory(const struct BoltCompactValue* value);
+
+enum BoltType BoltCompactValue_type(const struct BoltCompactValue* value);
+
+char BoltCompactBit_get(const struct BoltCompactValue* value);
+
+int64_t BoltCompactInt64_get(const struct BoltCompactValue* value);
+
+double BoltCompactFloat64_get(const struct BoltCompactValue* value);
+
+const char* BoltCompactString8_get(const struct BoltCompactValue* value);
+
+const char* BoltCompactByteArray_get_all(const struct BoltCompactValue* value);
+
+const struct BoltCompactValue* BoltCompactList_value(const struct BoltCompactValue* value, int32_t index);
+
+const struct BoltCompactValue* BoltCompactDictionary8_key(const struct BoltCompactValue* value, int32_t index);
+
+const struct BoltCompactValue* BoltCompactDictionary8_value(const struct BoltCompactValue* value, int32_t index);
+
+const struct BoltCompactValue* BoltCompactStructure_value(const struct BoltCompactValue* value, int32_t index);
+
+
+#endif // SEABOLT_COMPACT
@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include <netdb.h>
+#include "events.h"
 
 
 #define try(code) { int status = (code); if (status == -1) { return status; } }
@@ -145,6 +146,12 @@ struct BoltConnection
     enum BoltConnectionStatus status;
     /// Current connection error code
     enum BoltConnectionError error;
+
+    /// Background reader thread, if started
+    struct BoltReader* reader;
+
+    /// Allocator used for buffers and protocol state belonging to this connection
+    struct BoltAllocator* allocator;
 };
 
 
@@ -187,6 +194,28 @@ struct BoltConnection
  */
 struct BoltConnection* BoltConnection_open_b(enum BoltTransport transport, struct BoltAddress* address);
 
+/**
+ * Open a connection to a Bolt server, drawing the memory for the connection,
+ * its buffers and its protocol state from a specific allocator.
+ *
+ * This otherwise behaves exactly as `BoltConnection_open_b`. Only part of
+ * the memory used for the connection comes from this allocator: the
+ * connection itself, its transmit and receive buffers, the arena from which
+ * fetched values draw their storage, the key intern table and any reader
+ * thread queue. Every `BoltValue` (including the fetched value and request
+ * templates themselves, as well as values created by the caller, such as
+ * Cypher parameters) and any storage not drawn from the arena (such as that
+ * of values decoded on a reader thread) continue to use the installed
+ * allocator.
+ *
+ * @param transport the type of transport over which to connect
+ * @param address descriptor of the remote Bolt server address
+ * @param allocator the allocator to use, or NULL for the installed allocator
+ * @return a pointer to a new BoltConnection struct
+ */
+struct BoltConnection* BoltConnection_open_with_allocator_b(enum BoltTransport transport, struct BoltAddress* address,
+                                                            struct BoltAllocator* allocator);
+
 /**
  * Close a connection.
  *
@@ -228,6 +257,26 @@ int BoltConnection_send_b(struct BoltConnection * connection);
  */
 int BoltConnection_fetch_b(struct BoltConnection * connection, int request_id);
 
+/**
+ * Fetch the next value from the current result stream, delivering a
+ * record as a sequence of decoding events rather than decoding it into
+ * the fetched value.
+ *
+ * This otherwise behaves exactly as `BoltConnection_fetch_b`: a summary
+ * is still decoded into the value returned by `BoltConnection_fetched`.
+ * Nothing is allocated while a record is delivered. Not available while
+ * a reader thread is running.
+ *
+ * @param connection
+ * @param request_id
+ * @param handler the callbacks for each event (see `events.h`)
+ * @param context passed to every callback
+ * @return 1 if record data is received, 0 if summary metadata is received,
+ *         -1 on error (including a callback stopping the record)
+ */
+int BoltConnection_fetch_events_b(struct BoltConnection * connection, int request_id,
+                                  const struct BoltEventHandler * handler, void * context);
+
 /**
  * Fetch values from the current result stream, up to and
  * including the next summary.
@@ -259,6 +308,123 @@ int BoltConnection_fetch_summary_b(struct BoltConnection * connection, int reque
  */
 struct BoltValue* BoltConnection_fetched(struct BoltConnection * connection);
 
+/**
+ * Take ownership of the last fetched data values or summary metadata.
+ *
+ * The fetched value is moved into a new value, which remains valid
+ * until destroyed by the caller with `BoltValue_destroy`, and the
+ * fetched slot is left null. By default, the value is held in an arena,
+ * which is handed over along with it: only views of the receive buffer,
+ * interned map keys and entities shared between records are copied into
+ * it, and the connection starts afresh with a new arena. The arena is
+ * drawn from the connection allocator, which must therefore outlive the
+ * value. Values fetched without an arena, such as through a reader, are
+ * moved without copying where they own all of their storage, and are
+ * otherwise copied in full.
+ *
+ * @param connection
+ * @return a new value, or NULL if not supported by the protocol version
+ */
+struct BoltValue* BoltConnection_take_fetched(struct BoltConnection * connection);
+
+/**
+ * Start a background thread that receives and decodes messages ahead
+ * of the consumer, so that network latency and decoding overlap with
+ * processing of the previous record.
+ *
+ * Up to _queue_size_ received messages are held at any one time; once
+ * the queue is full, the thread stops reading from the socket until the
+ * consumer catches up. `BoltConnection_fetch_b` and
+ * `BoltConnection_fetched` then work exactly as before, except that the
+ * fetched value always has storage of its own and is never a view. The
+ * thread is stopped when the connection is closed.
+ *
+ * Where decoding rather than the network is the bottleneck (such as for
+ * very wide records) messages can instead be decoded on a pool of
+ * _n_decoders_ further threads, the reader thread only receiving and
+ * dechunking them. Messages are always delivered in the order received.
+ * Each decoder thread interns map keys separately.
+ *
+ * Only insecure connections are supported, as a TLS session cannot be
+ * read and written from different threads at the same time. Fetched
+ * values are allocated from the reader (or decoder) threads, so the
+ * installed allocator must be safe to use from more than one thread (as
+ * the built-in system allocator is, but pools and slab allocators are
+ * not).
+ *
+ * @param connection
+ * @param queue_size the maximum number of messages to receive ahead
+ * @param n_decoders the number of decoder threads, or 0 to decode on
+ *                   the reader thread itself
+ * @return 0 on success, -1 if not supported for this connection,
+ *         already started or streaming to a sink (see
+ *         `BoltConnection_set_stream_sink`)
+ */
+int BoltConnection_start_reader(struct BoltConnection * connection, int queue_size, int n_decoders);
+
+/**
+ * Decode received strings and byte arrays of at least a given size as
+ * views, rather than copying them.
+ *
+ * Views (values flagged `BOLT_VALUE_VIEW`) refer directly to data in the
+ * receive buffer and so are only valid until the next receive function
+ * call. Use `BoltValue_materialise` to keep hold of the data beyond that.
+ *
+ * Views cannot be used while a reader thread is running.
+ *
+ * @param connection
+ * @param size the minimum size to decode as a view, or -1 to disable views
+ * @return 0 on success, -1 if not supported by the protocol version
+ *         or a reader thread is running
+ */
+int BoltConnection_set_view_threshold(struct BoltConnection * connection, int32_t size);
+
+/**
+ * Share received nodes and relationships between their occurrences
+ * within each result.
+ *
+ * Where sharing is on, the first occurrence of each node or relationship
+ * in a result is decoded as usual, and any later occurrence (by id) is
+ * skipped over in the received data, taking the nested values of the
+ * first instead. Shared nested values are read-only and last until the
+ * summary at the end of the result is received.
+ *
+ * Sharing cannot be used while a reader thread is running.
+ *
+ * @param connection
+ * @param enabled 1 to share, 0 to decode every occurrence separately
+ * @return 0 on success, -1 if not supported by the protocol version
+ *         or a reader thread is running
+ */
+int BoltConnection_set_entity_sharing(struct BoltConnection * connection, int enabled);
+
+/**
+ * Stream received strings and byte arrays of at least `threshold` bytes
+ * to a sink as they arrive, instead of holding them in memory, or stop
+ * streaming if the sink is NULL.
+ *
+ * Only values within records are streamed; map keys and summary
+ * messages (such as a FAILURE) are always received in full, as are
+ * records nested too deeply to follow.
+ *
+ * Each such value is left in its record as a placeholder structure with
+ * code `BOLT_STREAMED_CODE`, holding its type and size (see
+ * `BoltStreamSink`). Where a sink callback fails, the record being
+ * received is discarded and the fetch returns -1; later records are
+ * received as usual.
+ *
+ * Streaming cannot be used while a reader thread is running.
+ *
+ * @param connection
+ * @param threshold minimum size of value to stream
+ * @param sink callbacks to stream to, or NULL
+ * @param context passed to each callback
+ * @return 0 on success, -1 if not supported by the protocol version,
+ *         a reader thread is running or the threshold is negative
+ */
+int BoltConnection_set_stream_sink(struct BoltConnection * connection, int32_t threshold,
+                                   const struct BoltStreamSink * sink, void * context);
+
 /**
  * Set a Cypher statement for subsequent execution.
  *
@@ -290,6 +456,62 @@ int BoltConnection_load_rollback_request(struct BoltConnection * connection);
 
 int BoltConnection_load_run_request(struct BoltConnection * connection);
 
+/**
+ * Prepare a Cypher statement for repeated execution.
+ *
+ * The statement text, and each parameter key once set, is encoded only
+ * once. Loading the prepared statement with
+ * `BoltConnection_load_prepared_run_request` then only encodes the
+ * current parameter values, which makes it much cheaper than
+ * `BoltConnection_load_run_request` for a statement run many times.
+ *
+ * @param connection
+ * @param statement
+ * @param size
+ * @param n_parameters
+ * @return the prepared statement, to be destroyed with
+ *         `BoltPreparedStatement_destroy`, or NULL if the connection or
+ *         statement is NULL, the connection has no protocol state or is
+ *         defunct, or the protocol version does not support it
+ */
+struct BoltPreparedStatement* BoltConnection_prepare(struct BoltConnection * connection, const char * statement,
+                                                     size_t size, int32_t n_parameters);
+
+void BoltPreparedStatement_destroy(struct BoltPreparedStatement * prepared);
+
+/**
+ * Set the key of a prepared statement parameter.
+ *
+ * @param prepared
+ * @param index
+ * @param key
+ * @param key_size
+ * @return 0 on success, -1 if the index is out of range
+ */
+int BoltPreparedStatement_set_parameter_key(struct BoltPreparedStatement * prepared, int32_t index,
+                                            const char * key, size_t key_size);
+
+/**
+ * Obtain the value of a prepared statement parameter, to be set before
+ * each execution.
+ *
+ * @param prepared
+ * @param index
+ * @return
+ */
+struct BoltValue* BoltPreparedStatement_parameter_value(struct BoltPreparedStatement * prepared, int32_t index);
+
+/**
+ * Load a RUN request for a prepared statement, using the current values
+ * of its parameters.
+ *
+ * @param connection the connection the statement was prepared for
+ * @param prepared
+ * @return request ID, or -1 if any parameter key is not set or any
+ *         value cannot be sent
+ */
+int BoltConnection_load_prepared_run_request(struct BoltConnection * connection, struct BoltPreparedStatement * prepared);
+
 int BoltConnection_load_discard_request(struct BoltConnection * connection, int32_t n);
 
 int BoltConnection_load_pull_request(struct BoltConnection * connection, int32_t n);
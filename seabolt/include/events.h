@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_EVENTS
+#define SEABOLT_EVENTS
+
+#include <stdint.h>
+
+
+/**
+ * Callbacks through which a received record is delivered as a sequence
+ * of decoding events, rather than decoded into a `BoltValue` tree (see
+ * `BoltConnection_fetch_events_b`).
+ *
+ * The record fields arrive as a list: `on_list_begin`, then one event
+ * (or nested sequence of events) per field, then `on_end`. Each list,
+ * map and structure begins with its own event and finishes with
+ * `on_end`. Map keys and values alternate, keys arriving through
+ * `on_string`. String and byte data point into the receive buffer, so
+ * are only valid until the callback returns.
+ *
+ * Any callback may be NULL, in which case its events are skipped. A
+ * callback returning anything other than 0 stops decoding; the rest of
+ * the record is then discarded.
+ */
+struct BoltEventHandler
+{
+    int (*on_null)(void* context);
+    int (*on_boolean)(void* context, int x);
+    int (*on_int)(void* context, int64_t x);
+    int (*on_float)(void* context, double x);
+    int (*on_string)(void* context, const char* string, int32_t size);
+    int (*on_bytes)(void* context, const char* data, int32_t size);
+    int (*on_list_begin)(void* context, int32_t size);
+    int (*on_map_begin)(void* context, int32_t size);
+    int (*on_struct_begin)(void* context, int16_t code, int32_t size);
+    int (*on_end)(void* context);
+};
+
+
+/// Structure code of the placeholder left in place of a streamed value
+#define BOLT_STREAMED_CODE 0x00
+
+/**
+ * Callbacks through which record values (strings and byte arrays above
+ * a size threshold) are streamed as they arrive, rather than held in
+ * memory (see `BoltConnection_set_stream_sink`).
+ *
+ * Each streamed value is delivered as `on_begin`, any number of calls
+ * to `on_data` (with parts of at most 64 KiB, pointing into a scratch
+ * buffer) and `on_end`. The value is replaced, within the message, by a
+ * structure with code `BOLT_STREAMED_CODE` and two fields: the type
+ * (`BOLT_STRING8` or `BOLT_BYTE_ARRAY`) and size of the streamed value.
+ *
+ * A callback returning anything other than 0 fails the message, the
+ * rest of which is then received and discarded with no further calls.
+ */
+struct BoltStreamSink
+{
+    int (*on_begin)(void* context, int type, int32_t size);
+    int (*on_data)(void* context, const char* data, int32_t size);
+    int (*on_end)(void* context);
+};
+
+
+#endif // SEABOLT_EVENTS
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_GRAPH
+#define SEABOLT_GRAPH
+
+#include <stdint.h>
+#include "connect.h"
+#include "tape.h"
+
+
+/// Maximum number of property columns, for each of vertices and edges
+#define BOLT_GRAPH_MAX_COLUMNS 16
+
+
+/**
+ * A node decoded onto a tape.
+ *
+ * Labels are strings held one after another on the tape, so label `i`
+ * is at index `labels + i`.
+ */
+struct BoltNodeView
+{
+    int64_t id;
+    int32_t n_labels;
+    /// Tape index of the first label
+    int32_t labels;
+    /// Tape index of the property dictionary
+    int32_t properties;
+};
+
+/**
+ * A relationship decoded onto a tape, either bound ('R') or unbound
+ * ('r', as within a path). The start and end of an unbound relationship
+ * are only known once resolved as part of a path, and are -1 until then.
+ */
+struct BoltRelationshipView
+{
+    int64_t id;
+    int64_t start_id;
+    int64_t end_id;
+    /// Tape index of the type string
+    int32_t type;
+    /// Tape index of the property dictionary
+    int32_t properties;
+};
+
+/**
+ * One step along a path: a relationship followed, in either direction,
+ * to the next node.
+ */
+struct BoltPathHop
+{
+    /// Index of the relationship within the path
+    int32_t relationship;
+    /// 1 if followed from start to end, 0 if from end to start
+    int32_t forward;
+    /// Index of the node reached within the path
+    int32_t node;
+};
+
+/**
+ * A path decoded onto a tape, resolved into contiguous arrays of its
+ * distinct nodes and relationships and a list of the hops taken from
+ * the first node (`nodes[0]`) onwards.
+ *
+ * The relationships of a path arrive unbound, their start and end
+ * implied by the sequence of hops. These are filled in when resolved,
+ * from the first hop over each relationship.
+ *
+ * A path view can be reused for path after path, keeping its capacity.
+ */
+struct BoltPathView
+{
+    int32_t n_nodes;
+    struct BoltNodeView* nodes;
+    int32_t n_relationships;
+    struct BoltRelationshipView* relationships;
+    int32_t n_hops;
+    struct BoltPathHop* hops;
+
+    int32_t node_capacity;
+    int32_t relationship_capacity;
+    int32_t hop_capacity;
+};
+
+
+/**
+ * Read a node from a tape.
+ *
+ * @param tape
+ * @param index the tape index of the node structure
+ * @param node the view to fill in
+ * @return 0 on success, -1 if the value is not a node
+ */
+int BoltTape_node(const struct BoltTape* tape, int32_t index, struct BoltNodeView* node);
+
+/**
+ * Read a relationship, bound or unbound, from a tape.
+ *
+ * @param tape
+ * @param index the tape index of the relationship structure
+ * @param relationship the view to fill in
+ * @return 0 on success, -1 if the value is not a relationship
+ */
+int BoltTape_relationship(const struct BoltTape* tape, int32_t index, struct BoltRelationshipView* relationship);
+
+struct BoltPathView* BoltPathView_create();
+
+void BoltPathView_destroy(struct BoltPathView* path);
+
+/**
+ * Read and resolve a path from a tape, in a single pass over it.
+ *
+ * @param tape
+ * @param index the tape index of the path structure
+ * @param path the view to fill in
+ * @return 0 on success, -1 if the value is not a valid path
+ */
+int BoltTape_path(const struct BoltTape* tape, int32_t index, struct BoltPathView* path);
+
+
+/**
+ * A sink that builds a directed graph from the nodes, relationships and
+ * paths of a result, as records are fetched.
+ *
+ * Entities are deduplicated by id. Each distinct node becomes a vertex,
+ * numbered densely from zero in the order first seen, and each distinct
+ * relationship an edge from its start vertex to its end vertex. A node
+ * seen only as the end of a relationship is given a vertex all the same.
+ *
+ * Numeric properties can be gathered into columns, with one value per
+ * vertex or edge. Columns hold floating point values, with NaN wherever
+ * the property is missing or not a number.
+ *
+ * Once built, the edges are laid out in compressed sparse row form:
+ * the outgoing edges of vertex `v` are at positions `offsets[v]` up to
+ * `offsets[v + 1]`, in the order first seen, with their end vertices in
+ * `targets` and their relationship ids and edge columns alongside.
+ */
+struct BoltGraphBuilder;
+
+
+struct BoltGraphBuilder* BoltGraphBuilder_create();
+
+void BoltGraphBuilder_destroy(struct BoltGraphBuilder* builder);
+
+/**
+ * Gather a node property into a vertex column. Columns must be added
+ * before any entity.
+ *
+ * @param builder
+ * @param key
+ * @param key_size
+ * @return the column index, or -1 if no more columns can be added
+ */
+int BoltGraphBuilder_add_vertex_column(struct BoltGraphBuilder* builder, const char* key, int32_t key_size);
+
+/**
+ * Gather a relationship property into an edge column. Columns must be
+ * added before any entity.
+ *
+ * @param builder
+ * @param key
+ * @param key_size
+ * @return the column index, or -1 if no more columns can be added
+ */
+int BoltGraphBuilder_add_edge_column(struct BoltGraphBuilder* builder, const char* key, int32_t key_size);
+
+/**
+ * Add every node, relationship and path within a value on a tape,
+ * however deeply nested. Unbound relationships outside of a path are
+ * ignored, having no start or end.
+ *
+ * @param builder
+ * @param tape
+ * @param index the tape index of the value, such as a whole record
+ * @return 0 on success, -1 if a graph entity is malformed
+ */
+int BoltGraphBuilder_add(struct BoltGraphBuilder* builder, const struct BoltTape* tape, int32_t index);
+
+/**
+ * Fetch a record and add every graph entity within it.
+ *
+ * @param builder
+ * @param connection
+ * @param request_id
+ * @return 1 if a record was added, 0 if the summary was received, -1 on
+ *         error
+ */
+int BoltGraphBuilder_fetch_b(struct BoltGraphBuilder* builder, struct BoltConnection* connection, int request_id);
+
+/**
+ * Lay out the edges added so far in compressed sparse row form. Adding
+ * further entities requires the graph to be built again.
+ *
+ * @param builder
+ */
+void BoltGraphBuilder_build(struct BoltGraphBuilder* builder);
+
+int32_t BoltGraphBuilder_vertex_count(const struct BoltGraphBuilder* builder);
+
+int32_t BoltGraphBuilder_edge_count(const struct BoltGraphBuilder* builder);
+
+/**
+ * Find the vertex of a node.
+ *
+ * @param builder
+ * @param id the node id
+ * @return the vertex, or -1 if not present
+ */
+int32_t BoltGraphBuilder_vertex(const struct BoltGraphBuilder* builder, int64_t id);
+
+/**
+ * The node id of each vertex.
+ *
+ * @param builder
+ * @return
+ */
+const int64_t* BoltGraphBuilder_vertex_ids(const struct BoltGraphBuilder* builder);
+
+const double* BoltGraphBuilder_vertex_column(const struct BoltGraphBuilder* builder, int column);
+
+/**
+ * The offset of the outgoing edges of each vertex, as last built, with
+ * the edge count as a final entry.
+ *
+ * @param builder
+ * @return
+ */
+const int32_t* BoltGraphBuilder_offsets(const struct BoltGraphBuilder* builder);
+
+/**
+ * The end vertex of each edge, as last built.
+ *
+ * @param builder
+ * @return
+ */
+const int32_t* BoltGraphBuilder_targets(const struct BoltGraphBuilder* builder);
+
+/**
+ * The relationship id of each edge, as last built.
+ *
+ * @param builder
+ * @return
+ */
+const int64_t* BoltGraphBuilder_edge_ids(const struct BoltGraphBuilder* builder);
+
+/**
+ * The values of an edge column for each edge, as last built.
+ *
+ * @param builder
+ * @param column
+ * @return
+ */
+const double* BoltGraphBuilder_edge_column(const struct BoltGraphBuilder* builder, int column);
+
+
+#endif // SEABOLT_GRAPH
@@ -24,22 +24,275 @@
 #ifndef SEABOLT_MEM
 #define SEABOLT_MEM
 
-#include "stdio.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 void* memcpy_r(void* dest, const void* src, size_t n);
 
 #ifdef _WIN32
     // Windows endianness is always LE (I think)
-    #define memcpy_be(target, src, n) memcpy_r(target, src, n)
+    #define SEABOLT_LITTLE_ENDIAN 1
 #else
     #include "endian.h"
     #if __BYTE_ORDER == __BIG_ENDIAN
-        #define memcpy_be(target, src, n) memcpy(target, src, n)
+        #define SEABOLT_LITTLE_ENDIAN 0
     #else
-        #define memcpy_be(target, src, n) memcpy_r(target, src, n)
+        #define SEABOLT_LITTLE_ENDIAN 1
     #endif
 #endif
 
+#if defined(_MSC_VER)
+    #include <stdlib.h>
+    #define bswap_uint16(x) _byteswap_ushort(x)
+    #define bswap_uint32(x) _byteswap_ulong(x)
+    #define bswap_uint64(x) _byteswap_uint64(x)
+#elif defined(__GNUC__) || defined(__clang__)
+    #define bswap_uint16(x) __builtin_bswap16(x)
+    #define bswap_uint32(x) __builtin_bswap32(x)
+    #define bswap_uint64(x) __builtin_bswap64(x)
+#else
+    #define bswap_uint16(x) ((uint16_t)((((uint16_t)(x)) << 8) | (((uint16_t)(x)) >> 8)))
+    #define bswap_uint32(x) ((((uint32_t)(bswap_uint16((uint16_t)(x)))) << 16) | \
+                             ((uint32_t)(bswap_uint16((uint16_t)((x) >> 16)))))
+    #define bswap_uint64(x) ((((uint64_t)(bswap_uint32((uint32_t)(x)))) << 32) | \
+                             ((uint64_t)(bswap_uint32((uint32_t)((x) >> 32)))))
+#endif
+
+#if SEABOLT_LITTLE_ENDIAN
+    #define to_be_uint16(x) bswap_uint16(x)
+    #define to_be_uint32(x) bswap_uint32(x)
+    #define to_be_uint64(x) bswap_uint64(x)
+#else
+    #define to_be_uint16(x) (x)
+    #define to_be_uint32(x) (x)
+    #define to_be_uint64(x) (x)
+#endif
+
+/**
+ * Copy a 2-byte value, converting between host and big-endian order.
+ *
+ * @param dest
+ * @param src
+ */
+static inline void memcpy_be16(void* dest, const void* src)
+{
+    uint16_t x;
+    memcpy(&x, src, sizeof(x));
+    x = to_be_uint16(x);
+    memcpy(dest, &x, sizeof(x));
+}
+
+/**
+ * Copy a 4-byte value, converting between host and big-endian order.
+ *
+ * @param dest
+ * @param src
+ */
+static inline void memcpy_be32(void* dest, const void* src)
+{
+    uint32_t x;
+    memcpy(&x, src, sizeof(x));
+    x = to_be_uint32(x);
+    memcpy(dest, &x, sizeof(x));
+}
+
+/**
+ * Copy an 8-byte value, converting between host and big-endian order.
+ *
+ * @param dest
+ * @param src
+ */
+static inline void memcpy_be64(void* dest, const void* src)
+{
+    uint64_t x;
+    memcpy(&x, src, sizeof(x));
+    x = to_be_uint64(x);
+    memcpy(dest, &x, sizeof(x));
+}
+
+/**
+ * Copy `n` bytes, converting between host and big-endian order.
+ *
+ * Fixed-width sizes are routed to the byte-swap primitives above;
+ * anything else falls back to a byte-by-byte reversal.
+ *
+ * @param dest
+ * @param src
+ * @param n
+ * @return
+ */
+static inline void* memcpy_be(void* dest, const void* src, size_t n)
+{
+#if SEABOLT_LITTLE_ENDIAN
+    switch (n)
+    {
+        case 1:
+            memcpy(dest, src, 1);
+            return dest;
+        case 2:
+            memcpy_be16(dest, src);
+            return dest;
+        case 4:
+            memcpy_be32(dest, src);
+            return dest;
+        case 8:
+            memcpy_be64(dest, src);
+            return dest;
+        default:
+            return memcpy_r(dest, src, n);
+    }
+#else
+    return memcpy(dest, src, n);
+#endif
+}
+
+/**
+ * Copy an array of `n` 2-byte values, converting each between host
+ * and big-endian order.
+ *
+ * On x86 hosts, an SSSE3 or AVX2 kernel is selected at runtime where
+ * the CPU supports it.
+ *
+ * @param dest
+ * @param src
+ * @param n number of elements (not bytes)
+ */
+void memcpy_be16_array(void* dest, const void* src, size_t n);
+
+/**
+ * Copy an array of `n` 4-byte values, converting each between host
+ * and big-endian order.
+ *
+ * @param dest
+ * @param src
+ * @param n number of elements (not bytes)
+ */
+void memcpy_be32_array(void* dest, const void* src, size_t n);
+
+/**
+ * Copy an array of `n` 8-byte values, converting each between host
+ * and big-endian order.
+ *
+ * @param dest
+ * @param src
+ * @param n number of elements (not bytes)
+ */
+void memcpy_be64_array(void* dest, const void* src, size_t n);
+
+
+/**
+ * Running totals for the memory handled by an allocator.
+ */
+struct BoltAllocatorStats
+{
+    /// Number of bytes currently allocated
+    size_t current_allocation;
+    /// Highest number of bytes allocated at any one time
+    size_t peak_allocation;
+    /// Count of allocation, reallocation and deallocation calls
+    long long allocation_events;
+};
+
+/**
+ * A pluggable memory allocator.
+ *
+ * Every block is returned to the allocator with the same size with
+ * which it was requested, so implementations need not track block
+ * sizes themselves. The `context` pointer is passed through untouched
+ * to each function.
+ */
+struct BoltAllocator
+{
+    /// Descriptive name, for reporting
+    const char* name;
+    void* (*allocate)(void* context, size_t size);
+    void* (*reallocate)(void* context, void* ptr, size_t old_size, size_t new_size);
+    void (*deallocate)(void* context, void* ptr, size_t size);
+    /// Allocator-specific state
+    void* context;
+    /// Usage statistics, maintained by the library
+    struct BoltAllocatorStats stats;
+};
+
+/**
+ * Obtain the built-in allocator, backed by `malloc`, `realloc` and `free`.
+ *
+ * @return
+ */
+struct BoltAllocator* BoltMem_system_allocator();
+
+/**
+ * Install the allocator used for all subsequent library allocations
+ * not otherwise tied to a specific allocator.
+ *
+ * This should be called once at startup, before any connections or
+ * values are created, since existing blocks are always returned to
+ * whichever allocator is installed at the time they are released.
+ *
+ * @param allocator the allocator to install, or NULL for the system allocator
+ */
+void BoltMem_set_allocator(struct BoltAllocator* allocator);
+
+/**
+ * Obtain the currently installed allocator.
+ *
+ * @return
+ */
+struct BoltAllocator* BoltMem_allocator();
+
+/**
+ * Create an allocator that serves blocks of up to `block_size` bytes
+ * from slabs of `blocks_per_slab` blocks, recycling freed blocks via a
+ * free list. Larger requests are passed on to the system allocator.
+ *
+ * This is well suited to the many small, fixed-size blocks used for
+ * `BoltValue` instances. A slab allocator is not thread-safe, so it
+ * should either be installed globally in a single-threaded program or
+ * be dedicated to a single connection.
+ *
+ * @param block_size
+ * @param blocks_per_slab
+ * @return
+ */
+struct BoltAllocator* BoltMem_create_slab_allocator(size_t block_size, size_t blocks_per_slab);
+
+/**
+ * Destroy a slab allocator, releasing all of its slabs.
+ *
+ * @param allocator
+ */
+void BoltMem_destroy_slab_allocator(struct BoltAllocator* allocator);
+
+/**
+ * Allocate memory from a specific allocator.
+ *
+ * @param allocator the allocator to use, or NULL for the installed allocator
+ * @param new_size
+ * @return
+ */
+void* BoltAllocator_allocate(struct BoltAllocator* allocator, size_t new_size);
+
+/**
+ * Reallocate memory from a specific allocator.
+ *
+ * @param allocator the allocator to use, or NULL for the installed allocator
+ * @param ptr
+ * @param old_size
+ * @param new_size
+ * @return
+ */
+void* BoltAllocator_reallocate(struct BoltAllocator* allocator, void* ptr, size_t old_size, size_t new_size);
+
+/**
+ * Deallocate memory from a specific allocator.
+ *
+ * @param allocator the allocator to use, or NULL for the installed allocator
+ * @param ptr
+ * @param old_size
+ * @return
+ */
+void* BoltAllocator_deallocate(struct BoltAllocator* allocator, void* ptr, size_t old_size);
 
 /**
  * Allocate memory.
@@ -81,7 +334,7 @@ void* BoltMem_deallocate(void* ptr, size_t old_size);
 void* BoltMem_adjust(void* ptr, size_t old_size, size_t new_size);
 
 /**
- * Retrieve the amount of memory currently allocated.
+ * Retrieve the amount of memory currently allocated, across all allocators.
  *
  * @return
  */
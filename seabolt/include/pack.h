@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_PACK
+#define SEABOLT_PACK
+
+#include <stddef.h>
+#include <stdint.h>
+#include "connect.h"
+#include "values.h"
+
+
+/// Maximum nesting of containers within a request written by a `BoltPackWriter`
+#define BOLT_PACK_MAX_DEPTH 32
+
+struct BoltPackFrame
+{
+    /// Number of items (keys and values) the container holds
+    int32_t size;
+    /// Number of items written so far
+    int32_t count;
+    int is_map;
+};
+
+/**
+ * A writer that encodes request parameters straight into the transmit
+ * buffer of a connection, with no `BoltValue` tree in between.
+ *
+ * The writer holds no storage of its own, so it can live on the stack.
+ * A request is started with `BoltPackWriter_begin_run_request`, which
+ * opens the parameter map. Keys and values are then written in turn,
+ * with `BoltPackWriter_begin_map` and `BoltPackWriter_begin_list`
+ * opening nested containers and `BoltPackWriter_end` closing each one
+ * (the parameter map included) once all of its items are written.
+ *
+ * Container sizes are given up front, as in PackStream itself. Writing
+ * more or fewer items than that, or a map key that is not a string, is
+ * an error. On any error, the partly written request is taken back off
+ * the transmit buffer and every further call returns -1 until a new
+ * request is started.
+ */
+struct BoltPackWriter
+{
+    struct BoltConnection* connection;
+    /// Offset of the request within the protocol transmit buffer
+    int start;
+    int depth;
+    int failed;
+    struct BoltPackFrame frames[BOLT_PACK_MAX_DEPTH];
+};
+
+
+/**
+ * Start writing a RUN request.
+ *
+ * @param writer
+ * @param connection
+ * @param statement
+ * @param size
+ * @param n_parameters the number of parameters to be written
+ * @return 0 on success, -1 if not supported by the protocol version
+ */
+int BoltPackWriter_begin_run_request(struct BoltPackWriter* writer, struct BoltConnection* connection,
+                                     const char* statement, size_t size, int32_t n_parameters);
+
+/**
+ * Open a map, to be followed by `size` keys each with its value.
+ *
+ * @param writer
+ * @param size
+ * @return 0 on success, -1 on error
+ */
+int BoltPackWriter_begin_map(struct BoltPackWriter* writer, int32_t size);
+
+/**
+ * Open a list, to be followed by `size` values.
+ *
+ * @param writer
+ * @param size
+ * @return 0 on success, -1 on error
+ */
+int BoltPackWriter_begin_list(struct BoltPackWriter* writer, int32_t size);
+
+/**
+ * Close the innermost open container.
+ *
+ * @param writer
+ * @return 0 on success or, on closing the parameter map, the ID of the
+ *         request now queued to be sent; -1 on error
+ */
+int BoltPackWriter_end(struct BoltPackWriter* writer);
+
+int BoltPackWriter_write_null(struct BoltPackWriter* writer);
+
+int BoltPackWriter_write_boolean(struct BoltPackWriter* writer, int x);
+
+int BoltPackWriter_write_int(struct BoltPackWriter* writer, int64_t x);
+
+int BoltPackWriter_write_float(struct BoltPackWriter* writer, double x);
+
+int BoltPackWriter_write_string(struct BoltPackWriter* writer, const char* string, size_t size);
+
+/**
+ * Write a null-terminated string.
+ *
+ * @param writer
+ * @param string
+ * @return 0 on success, -1 on error
+ */
+int BoltPackWriter_write_cstring(struct BoltPackWriter* writer, const char* string);
+
+int BoltPackWriter_write_bytes(struct BoltPackWriter* writer, const char* data, size_t size);
+
+/**
+ * Write a whole value, for anything with no writer function of its own.
+ *
+ * @param writer
+ * @param value
+ * @return 0 on success, -1 on error (including values that cannot be sent)
+ */
+int BoltPackWriter_write_value(struct BoltPackWriter* writer, struct BoltValue* value);
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+
+/**
+ * Write a value of any native type (or a null-terminated string, or a
+ * `BoltValue`) with the matching writer function. Unsigned 64-bit
+ * integers are left out, as they do not all fit a PackStream Integer.
+ */
+#define BoltPackWriter_write(writer, x) _Generic((x),                   \
+        _Bool: BoltPackWriter_write_boolean,                            \
+        char: BoltPackWriter_write_int,                                 \
+        signed char: BoltPackWriter_write_int,                          \
+        unsigned char: BoltPackWriter_write_int,                        \
+        short: BoltPackWriter_write_int,                                \
+        unsigned short: BoltPackWriter_write_int,                       \
+        int: BoltPackWriter_write_int,                                  \
+        unsigned int: BoltPackWriter_write_int,                         \
+        long: BoltPackWriter_write_int,                                 \
+        long long: BoltPackWriter_write_int,                            \
+        float: BoltPackWriter_write_float,                              \
+        double: BoltPackWriter_write_float,                             \
+        char*: BoltPackWriter_write_cstring,                            \
+        const char*: BoltPackWriter_write_cstring,                      \
+        struct BoltValue*: BoltPackWriter_write_value)((writer), (x))
+
+/**
+ * Write a map entry: a null-terminated string key and a value of any
+ * type accepted by `BoltPackWriter_write`.
+ */
+#define BoltPackWriter_write_entry(writer, key, x)                      \
+        (BoltPackWriter_write_cstring((writer), (key)) == -1 ? -1 : BoltPackWriter_write((writer), (x)))
+
+#endif
+
+
+#endif // SEABOLT_PACK
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_PACKSTREAM
+#define SEABOLT_PACKSTREAM
+
+#include <stddef.h>
+#include <stdint.h>
+#include "events.h"
+#include "values.h"
+
+
+struct BoltBuffer;
+
+/**
+ * A PackStream encoder that writes to a buffer of its own or to one
+ * given to it, with no connection involved. Values are encoded exactly
+ * as they would be within a request, so packed data can be prepared
+ * ahead of time, stored and later unpacked or sent as it is.
+ */
+struct BoltPacker;
+
+/**
+ * A PackStream decoder that reads from a buffer or a span of memory,
+ * with no connection involved. Values are unpacked into storage of
+ * their own, independent of the data they were unpacked from.
+ */
+struct BoltUnpacker;
+
+
+/**
+ * Create a packer.
+ *
+ * @param buffer the buffer to write to, or NULL for the packer to use
+ *               one of its own
+ * @return
+ */
+struct BoltPacker* BoltPacker_create(struct BoltBuffer* buffer);
+
+void BoltPacker_destroy(struct BoltPacker* packer);
+
+/**
+ * Obtain the data packed so far (and not yet read from the buffer).
+ *
+ * @param packer
+ * @param size set to the size of the data
+ * @return
+ */
+const char* BoltPacker_data(const struct BoltPacker* packer, int32_t* size);
+
+/**
+ * Discard all data in the buffer.
+ *
+ * @param packer
+ */
+void BoltPacker_reset(struct BoltPacker* packer);
+
+/**
+ * Pack a value.
+ *
+ * @param packer
+ * @param value
+ * @return 0 on success, -1 if the value (or any value nested within
+ *         it) cannot be packed
+ */
+int BoltPacker_pack(struct BoltPacker* packer, struct BoltValue* value);
+
+int BoltPacker_pack_null(struct BoltPacker* packer);
+
+int BoltPacker_pack_boolean(struct BoltPacker* packer, int x);
+
+int BoltPacker_pack_integer(struct BoltPacker* packer, int64_t x);
+
+int BoltPacker_pack_float(struct BoltPacker* packer, double x);
+
+int BoltPacker_pack_string(struct BoltPacker* packer, const char* string, int32_t size);
+
+int BoltPacker_pack_bytes(struct BoltPacker* packer, const char* data, int32_t size);
+
+/**
+ * Pack the header of a list, to be followed by `size` values.
+ *
+ * @param packer
+ * @param size
+ * @return
+ */
+int BoltPacker_pack_list_header(struct BoltPacker* packer, int32_t size);
+
+/**
+ * Pack the header of a map, to be followed by `size` pairs of string
+ * key and value.
+ *
+ * @param packer
+ * @param size
+ * @return
+ */
+int BoltPacker_pack_map_header(struct BoltPacker* packer, int32_t size);
+
+/**
+ * Create an unpacker that reads from a buffer.
+ *
+ * @param buffer
+ * @return
+ */
+struct BoltUnpacker* BoltUnpacker_create(struct BoltBuffer* buffer);
+
+/**
+ * Create an unpacker that reads from a span of memory, which must
+ * outlive it and is never written to.
+ *
+ * @param data
+ * @param size
+ * @return
+ */
+struct BoltUnpacker* BoltUnpacker_create_span(const char* data, int32_t size);
+
+void BoltUnpacker_destroy(struct BoltUnpacker* unpacker);
+
+/**
+ * The number of bytes left to unpack.
+ *
+ * @param unpacker
+ * @return
+ */
+int32_t BoltUnpacker_remaining(const struct BoltUnpacker* unpacker);
+
+/**
+ * Unpack the next value. The packed value is checked in full before it
+ * is unpacked, so nothing is read if it is malformed or truncated.
+ *
+ * @param unpacker
+ * @param value
+ * @return 1 if a value was unpacked, 0 if nothing is left, -1 if the
+ *         next value is malformed or truncated
+ */
+int BoltUnpacker_unpack(struct BoltUnpacker* unpacker, struct BoltValue* value);
+
+/**
+ * Unpack the next value as a sequence of events delivered to a handler
+ * (see `struct BoltEventHandler`).
+ *
+ * @param unpacker
+ * @param handler
+ * @param context
+ * @return 1 if a value was unpacked, 0 if nothing is left, -1 if the
+ *         next value is malformed or truncated or the handler stopped
+ *         decoding (the unpacker is then left where it was)
+ */
+int BoltUnpacker_unpack_events(struct BoltUnpacker* unpacker, const struct BoltEventHandler* handler,
+                               void* context);
+
+
+#endif // SEABOLT_PACKSTREAM
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_TAPE
+#define SEABOLT_TAPE
+
+#include <stdint.h>
+#include "connect.h"
+#include "events.h"
+#include "values.h"
+
+
+/// Maximum nesting of containers within a record decoded onto a tape
+#define BOLT_TAPE_MAX_DEPTH 64
+
+/**
+ * A single value on a tape.
+ *
+ * Lists, dictionaries and structures are followed directly by their
+ * contents (for a dictionary, each key then its value) and record the
+ * index of the token following those contents, so that any value can
+ * be skipped in one step. Strings and byte arrays record the offset of
+ * their data in the string arena of the tape.
+ */
+struct BoltTapeToken
+{
+    int8_t type;
+    uint8_t flags;              // reserved
+    int16_t code;
+    /// Number of entries (for containers) or bytes (for strings and byte arrays)
+    int32_t size;
+    union
+    {
+        int64_t as_int64;
+        double as_double;
+        /// Offset of string or byte array data within the string arena
+        int64_t as_offset;
+        /// Index of the next sibling of a container
+        int64_t as_next;
+    } data;
+};
+
+/**
+ * A flat decode target for received records: a "tape" of fixed-size
+ * tokens plus a single arena for string data.
+ *
+ * Each record appended is held as a list token followed by its fields,
+ * immediately after the previous record. Decoding allocates only when
+ * either array needs to grow, and `BoltTape_reset` empties the tape
+ * while keeping its capacity, so a tape reused for batch after batch
+ * soon stops allocating at all.
+ *
+ * Supported types are null, bit, Int64, Float64, UTF-8 strings, byte
+ * arrays, lists, UTF-8 dictionaries and structures.
+ */
+struct BoltTape
+{
+    struct BoltTapeToken* tokens;
+    int32_t n_tokens;
+    int32_t token_capacity;
+    char* strings;
+    int32_t strings_size;
+    int32_t strings_capacity;
+    int32_t n_records;
+    /// Open containers, while a record is being appended
+    int32_t depth;
+    int32_t stack[BOLT_TAPE_MAX_DEPTH];
+};
+
+
+struct BoltTape* BoltTape_create();
+
+void BoltTape_destroy(struct BoltTape* tape);
+
+/**
+ * Remove every record from a tape, keeping its capacity for reuse.
+ *
+ * @param tape
+ */
+void BoltTape_reset(struct BoltTape* tape);
+
+/**
+ * Fetch the next value from the current result stream, appending a
+ * record to the tape rather than decoding it into the fetched value.
+ *
+ * This otherwise behaves exactly as `BoltConnection_fetch_events_b`.
+ * Should the record fail to decode, the tape is left as it was.
+ *
+ * @param tape
+ * @param connection
+ * @param request_id
+ * @return 1 if a record is appended, 0 if summary metadata is received,
+ *         -1 on error
+ */
+int BoltTape_fetch_b(struct BoltTape* tape, struct BoltConnection* connection, int request_id);
+
+/**
+ * The event handler that appends records to a tape, with the tape as
+ * its context.
+ *
+ * @return
+ */
+const struct BoltEventHandler* BoltTape_handler();
+
+/**
+ * Return the index of the value following a given value and everything
+ * within it.
+ *
+ * The first value within a container (if any) is at the index following
+ * the container itself. The first record on a tape is at index 0, each
+ * subsequent record following the previous one.
+ *
+ * @param tape
+ * @param index
+ * @return
+ */
+int32_t BoltTape_next(const struct BoltTape* tape, int32_t index);
+
+enum BoltType BoltTape_type(const struct BoltTape* tape, int32_t index);
+
+/**
+ * Return the number of entries in a container, or the number of bytes
+ * in a string or byte array.
+ *
+ * @param tape
+ * @param index
+ * @return
+ */
+int32_t BoltTape_size(const struct BoltTape* tape, int32_t index);
+
+int16_t BoltTape_code(const struct BoltTape* tape, int32_t index);
+
+char BoltTape_bit(const struct BoltTape* tape, int32_t index);
+
+int64_t BoltTape_int64(const struct BoltTape* tape, int32_t index);
+
+double BoltTape_float64(const struct BoltTape* tape, int32_t index);
+
+/**
+ * Return the data of a string or byte array, which remains valid until
+ * the tape is next appended to or reset.
+ *
+ * @param tape
+ * @param index
+ * @return
+ */
+const char* BoltTape_data(const struct BoltTape* tape, int32_t index);
+
+
+#endif // SEABOLT_TAPE
@@ -130,9 +130,47 @@ struct array_t
     union data_t data;
 };
 
+/// Storage is owned by a `BoltArena` and is released when that arena
+/// is reset, never by the value itself
+#define BOLT_VALUE_ARENA 0x01
+/// Storage is immutable and shared with other values through an intern
+/// table, which owns it; the hash of the string is held alongside the
+/// pointer in the value itself
+#define BOLT_VALUE_INTERNED 0x02
+/// Storage is a read-only view into a connection receive buffer and
+/// becomes invalid on the next fetch (see `BoltValue_materialise`)
+#define BOLT_VALUE_VIEW 0x04
+/// Storage is read-only caller memory, borrowed rather than copied
+/// (see `BoltValue_to_BorrowedByteArray`)
+#define BOLT_VALUE_BORROWED 0x20
+/// Storage is a read-only file mapping, owned by the value and unmapped
+/// when it is reset (see `BoltValue_to_MappedByteArray`)
+#define BOLT_VALUE_MAPPED 0x40
+/// Any of the flags that indicate storage not owned by the value
+#define BOLT_VALUE_UNOWNED (BOLT_VALUE_ARENA | BOLT_VALUE_INTERNED | BOLT_VALUE_VIEW | BOLT_VALUE_BORROWED)
+/// Any of the flags that indicate external storage, even for data
+/// small enough to be held inline
+#define BOLT_VALUE_EXTERNAL (BOLT_VALUE_INTERNED | BOLT_VALUE_VIEW | BOLT_VALUE_BORROWED | BOLT_VALUE_MAPPED)
+/// Any of the flags that indicate storage sent straight from where it
+/// lies, rather than copied into each request
+#define BOLT_VALUE_GATHERED (BOLT_VALUE_BORROWED | BOLT_VALUE_MAPPED)
+/// A container drawn from an arena that it owns outright, held alongside
+/// the pointer to its storage and destroyed when the value is reset (see
+/// `BoltConnection_take_fetched`); no other value combines these flags
+#define BOLT_VALUE_ARENA_OWNER (BOLT_VALUE_ARENA | BOLT_VALUE_MAPPED)
+/// A dictionary with a key index attached (see `BoltDictionary8_value_by_key`)
+#define BOLT_VALUE_INDEXED 0x08
+/// A byte array holding the encoding of another value, which is sent
+/// verbatim in its place (see `BoltValue_freeze`)
+#define BOLT_VALUE_FROZEN 0x10
+/// A frozen value whose encoding holds structures that only Bolt v2
+/// onwards has, such as points, so that it is never sent over Bolt v1
+#define BOLT_VALUE_FROZEN_V2 0x80
+
 struct BoltValue
 {
-    int16_t type;
+    int8_t type;
+    uint8_t flags;              // storage ownership flags
     int16_t code;
     int32_t size;               // logical size
     size_t data_size;           // physical size
@@ -149,6 +187,7 @@ struct BoltValue
         int64_t as_int64[2];
         float as_float[4];
         double as_double[2];
+        void* as_ptr[2];
         union data_t extended;
     } data;
 };
@@ -168,6 +207,21 @@ void _set_type(struct BoltValue* value, enum BoltType type, int size);
 void _format(struct BoltValue* value, enum BoltType type, int size, const void* data, size_t data_size);
 
 
+/**
+ * Ensure that a value has external storage for at least `size` units,
+ * keeping any spare capacity it already has unless that is large and
+ * mostly unused.
+ *
+ * Storage that must grow does so by at least half again. Storage of
+ * more than 512 bytes is cut down to exactly `size` units once under a
+ * quarter of it is in use; anything else is left as it is.
+ *
+ * @param value
+ * @param unit_size
+ * @param size
+ */
+void _reserve(struct BoltValue* value, size_t unit_size, int32_t size);
+
 /**
  * Resize a value that contains multiple sub-values.
  *
@@ -177,6 +231,13 @@ void _format(struct BoltValue* value, enum BoltType type, int size, const void*
  */
 void _resize(struct BoltValue* value, int32_t size, int multiplier);
 
+/**
+ * Discard the key index of a dictionary, if it has one.
+ *
+ * @param value
+ */
+void _invalidate_index(struct BoltValue* value);
+
 
 /**
  * Create a new BoltValue instance.
@@ -208,6 +269,39 @@ void BoltValue_to_BitArray(struct BoltValue* value, char* array, int32_t size);
 
 void BoltValue_to_ByteArray(struct BoltValue* value, char* array, int32_t size);
 
+/**
+ * Reformat a BoltValue instance to refer to a byte array in caller
+ * memory, without copying it.
+ *
+ * The value is flagged `BOLT_VALUE_BORROWED`. Large borrowed data is
+ * sent by scatter-gather, straight from caller memory, so the caller
+ * must keep it valid and unchanged until the value is reset and any
+ * request it was loaded into has been sent.
+ *
+ * @param value
+ * @param array
+ * @param size
+ */
+void BoltValue_to_BorrowedByteArray(struct BoltValue* value, const char* array, int32_t size);
+
+/**
+ * Reformat a BoltValue instance to hold a byte array mapped read-only
+ * from a region of a file, without reading it.
+ *
+ * The value is flagged `BOLT_VALUE_MAPPED` and owns the mapping, which
+ * is sent by scatter-gather as for a borrowed byte array and unmapped
+ * when the value is reset. The file must not be truncated meanwhile.
+ * The file descriptor may be closed as soon as this returns.
+ *
+ * @param value
+ * @param fd file descriptor open for reading
+ * @param offset position of the region in the file (need not be aligned)
+ * @param size size of the region
+ * @return 0 on success, -1 if the region could not be mapped (in which
+ *         case the value is left unchanged)
+ */
+int BoltValue_to_MappedByteArray(struct BoltValue* value, int fd, int64_t offset, int32_t size);
+
 void BoltValue_to_Char16(struct BoltValue* value, uint16_t x);
 
 void BoltValue_to_Char32(struct BoltValue* value, uint32_t x);
@@ -218,6 +312,16 @@ void BoltValue_to_Char32Array(struct BoltValue* value, uint32_t* array, int32_t
 
 void BoltValue_to_String8(struct BoltValue* value, const char* string, int32_t size);
 
+/**
+ * Reformat a BoltValue instance to refer to a UTF-8 string in caller
+ * memory, without copying it (see `BoltValue_to_BorrowedByteArray`).
+ *
+ * @param value
+ * @param string
+ * @param size
+ */
+void BoltValue_to_BorrowedString8(struct BoltValue* value, const char* string, int32_t size);
+
 void BoltValue_to_String16(struct BoltValue* value, uint16_t* string, int32_t size);
 
 void BoltValue_to_String8Array(struct BoltValue* value, int32_t size);
@@ -278,17 +382,53 @@ void BoltValue_to_Float32QuadArray(struct BoltValue* value, int32_t size);
 
 void BoltValue_to_Float64(struct BoltValue* value, double x);
 
-void BoltValue_to_Float64Pair(struct BoltValue* value, double x, double y);
+/**
+ * Reformat a BoltValue instance to hold a 2D point, which is sent as a
+ * Point2D structure (from Bolt v2).
+ *
+ * @param value
+ * @param srid spatial reference system identifier (see `BoltPoint_srid`)
+ * @param x
+ * @param y
+ */
+void BoltValue_to_Float64Pair(struct BoltValue* value, int64_t srid, double x, double y);
 
-void BoltValue_to_Float64Triple(struct BoltValue* value, double x, double y, double z);
+/**
+ * Reformat a BoltValue instance to hold a 3D point, which is sent as a
+ * Point3D structure (from Bolt v2).
+ *
+ * @param value
+ * @param srid spatial reference system identifier (see `BoltPoint_srid`)
+ * @param x
+ * @param y
+ * @param z
+ */
+void BoltValue_to_Float64Triple(struct BoltValue* value, int64_t srid, double x, double y, double z);
 
 void BoltValue_to_Float64Quad(struct BoltValue* value, double x, double y, double z, double a);
 
 void BoltValue_to_Float64Array(struct BoltValue* value, double* array, int32_t size);
 
-void BoltValue_to_Float64PairArray(struct BoltValue* value, int32_t size);
+/**
+ * Reformat a BoltValue instance to hold an array of 2D points, all with
+ * the same SRID, which is sent as a list of Point2D structures. The
+ * points are initially all zero (see `BoltFloat64PairArray_set`).
+ *
+ * @param value
+ * @param srid
+ * @param size the number of points
+ */
+void BoltValue_to_Float64PairArray(struct BoltValue* value, int64_t srid, int32_t size);
 
-void BoltValue_to_Float64TripleArray(struct BoltValue* value, int32_t size);
+/**
+ * Reformat a BoltValue instance to hold an array of 3D points, all with
+ * the same SRID, which is sent as a list of Point3D structures.
+ *
+ * @param value
+ * @param srid
+ * @param size the number of points
+ */
+void BoltValue_to_Float64TripleArray(struct BoltValue* value, int64_t srid, int32_t size);
 
 void BoltValue_to_Float64QuadArray(struct BoltValue* value, int32_t size);
 
@@ -309,6 +449,68 @@ enum BoltType BoltValue_type(const struct BoltValue* value);
  */
 void BoltValue_destroy(struct BoltValue* value);
 
+/**
+ * Copy a string or byte array into storage owned by another value.
+ *
+ * This is chiefly of use for views (values flagged `BOLT_VALUE_VIEW`),
+ * whose data lives in a connection receive buffer and would otherwise
+ * be lost on the next fetch, and for borrowed values. The target may be
+ * the value itself, as long as that value is not nested within a
+ * fetched value.
+ *
+ * @param value the string or byte array to copy
+ * @param target the value in which to store the copy
+ * @return 0 on success, -1 if the value is not a string or byte array
+ */
+int BoltValue_materialise(struct BoltValue* value, struct BoltValue* target);
+
+/**
+ * Make a deep copy of a value.
+ *
+ * The copy owns all of its storage, so views, interned strings and
+ * values nested within a fetched value are all copied by content.
+ *
+ * @param value the value to copy
+ * @param target the value in which to store the copy
+ */
+void BoltValue_copy(const struct BoltValue* value, struct BoltValue* target);
+
+/**
+ * Move the contents of one value into another, leaving the first as null.
+ *
+ * Storage is handed over without copying where the value owns all of
+ * it, arena included for one taken with `BoltConnection_take_fetched`.
+ * Otherwise (for example, for a fetched value held in an arena)
+ * a deep copy is made, as for `BoltValue_copy`.
+ *
+ * @param value the value to move from
+ * @param target the value to move into
+ */
+void BoltValue_move(struct BoltValue* value, struct BoltValue* target);
+
+/**
+ * Exchange the contents of two values.
+ *
+ * @param a
+ * @param b
+ */
+void BoltValue_swap(struct BoltValue* a, struct BoltValue* b);
+
+/**
+ * Replace a value with its PackStream encoding, for a parameter that is
+ * sent over and over again unchanged.
+ *
+ * The value becomes a `BOLT_BYTE_ARRAY` flagged `BOLT_VALUE_FROZEN`,
+ * which is copied verbatim into each request rather than encoded again.
+ * Setting the value to anything else thaws it. A frozen value holding
+ * points cannot be sent over Bolt v1.
+ *
+ * @param value
+ * @return 0 on success, -1 if the value cannot be encoded (in which case
+ *         it is left unchanged)
+ */
+int BoltValue_freeze(struct BoltValue* value);
+
 int BoltValue_write(struct BoltValue * value, FILE * file, int32_t protocol_version);
 
 
@@ -355,6 +557,26 @@ uint32_t BoltChar32Array_get(const struct BoltValue* value, int32_t index);
 
 char* BoltString8_get(struct BoltValue* value);
 
+/**
+ * Return the hash of a UTF-8 string value.
+ *
+ * Interned strings carry a precomputed hash; for any other string,
+ * the hash is computed on demand.
+ *
+ * @param value
+ * @return
+ */
+uint32_t BoltString8_hash(const struct BoltValue* value);
+
+/**
+ * Compute the hash of a UTF-8 string (32-bit FNV-1a).
+ *
+ * @param string
+ * @param size
+ * @return
+ */
+uint32_t BoltString8_hash_of(const char* string, int32_t size);
+
 uint16_t* BoltString16_get(struct BoltValue* value);
 
 char* BoltString8Array_get(struct BoltValue* value, int32_t index);
@@ -386,6 +608,22 @@ struct BoltValue* BoltDictionary16_with_key(struct BoltValue* value, int32_t ind
 
 struct BoltValue* BoltDictionary8_value(struct BoltValue* value, int32_t index);
 
+/**
+ * Look up a dictionary value by key.
+ *
+ * Small dictionaries are searched linearly. Larger ones have a hash
+ * index built on first lookup, which is rebuilt on the next lookup after
+ * the dictionary is resized or reformatted or any key is set through
+ * `BoltDictionary8_set_key`. Keys should only be modified that way, as
+ * changes made to key values directly go unseen by the index.
+ *
+ * @param value
+ * @param key
+ * @param key_size
+ * @return the value for the first entry with a matching key, or NULL if none
+ */
+struct BoltValue* BoltDictionary8_value_by_key(struct BoltValue* value, const char* key, size_t key_size);
+
 struct BoltValue* BoltDictionary16_value(struct BoltValue* value, int32_t index);
 
 int BoltDictionary8_write(struct BoltValue * value, FILE * file, int32_t protocol_version);
@@ -509,6 +747,50 @@ double BoltFloat64_get(const struct BoltValue* value);
 
 double BoltFloat64Array_get(const struct BoltValue* value, int32_t index);
 
+/**
+ * Return the spatial reference system identifier of a point, or array
+ * of points, which is held in external storage ahead of the
+ * coordinates. Neo4j knows 7203 and 9157 (cartesian 2D and 3D) and
+ * 4326 and 4979 (WGS-84 2D and 3D).
+ *
+ * @param value a `BOLT_FLOAT64_PAIR`, `BOLT_FLOAT64_TRIPLE` or array of either
+ * @return the SRID
+ */
+int64_t BoltPoint_srid(const struct BoltValue* value);
+
+/**
+ * Return the coordinates of a point, or of all points in an array in
+ * turn, two or three to each point.
+ *
+ * @param value a `BOLT_FLOAT64_PAIR`, `BOLT_FLOAT64_TRIPLE` or array of either
+ * @return pointer to the first coordinate
+ */
+const double* BoltPoint_coordinates(const struct BoltValue* value);
+
+double BoltFloat64Pair_get_first(const struct BoltValue* value);
+
+double BoltFloat64Pair_get_second(const struct BoltValue* value);
+
+double BoltFloat64Triple_get_first(const struct BoltValue* value);
+
+double BoltFloat64Triple_get_second(const struct BoltValue* value);
+
+double BoltFloat64Triple_get_third(const struct BoltValue* value);
+
+double BoltFloat64PairArray_get_first(const struct BoltValue* value, int32_t index);
+
+double BoltFloat64PairArray_get_second(const struct BoltValue* value, int32_t index);
+
+void BoltFloat64PairArray_set(struct BoltValue* value, int32_t index, double x, double y);
+
+double BoltFloat64TripleArray_get_first(const struct BoltValue* value, int32_t index);
+
+double BoltFloat64TripleArray_get_second(const struct BoltValue* value, int32_t index);
+
+double BoltFloat64TripleArray_get_third(const struct BoltValue* value, int32_t index);
+
+void BoltFloat64TripleArray_set(struct BoltValue* value, int32_t index, double x, double y, double z);
+
 int BoltFloat32_write(struct BoltValue * value, FILE * file);
 
 int BoltFloat32Array_write(struct BoltValue * value, FILE * file);
@@ -517,6 +799,14 @@ int BoltFloat64_write(struct BoltValue * value, FILE * file);
 
 int BoltFloat64Array_write(struct BoltValue * value, FILE * file);
 
+int BoltFloat64Pair_write(struct BoltValue * value, FILE * file);
+
+int BoltFloat64Triple_write(struct BoltValue * value, FILE * file);
+
+int BoltFloat64PairArray_write(struct BoltValue * value, FILE * file);
+
+int BoltFloat64TripleArray_write(struct BoltValue * value, FILE * file);
+
 
 int16_t BoltStructure_code(const struct BoltValue* value);
 
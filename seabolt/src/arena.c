@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <memory.h>
+#include "arena.h"
+#include "mem.h"
+
+
+#define ARENA_ALIGNMENT 16
+
+/// Merged chunks are kept up to this size, beyond which the arena drops
+/// back to its initial chunk size rather than hold on to a large block
+#define MAX_RETAINED_SIZE (1024 * 1024)
+/// A chunk larger than the initial size is also given back once this
+/// many consecutive rounds have used under a quarter of it
+#define SHRINK_ROUNDS 16
+#define SHRINK_FACTOR 4
+
+#define align_up(n) (((n) + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+
+struct BoltArenaChunk
+{
+    struct BoltArenaChunk* next;
+    size_t size;
+    size_t used;
+};
+
+#define chunk_data(chunk) ((char*)(chunk) + align_up(sizeof(struct BoltArenaChunk)))
+
+
+static struct BoltArenaChunk* _create_chunk(struct BoltAllocator* allocator, size_t size)
+{
+    struct BoltArenaChunk* chunk = BoltAllocator_allocate(allocator, align_up(sizeof(struct BoltArenaChunk)) + size);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+static void _destroy_chunks(struct BoltAllocator* allocator, struct BoltArenaChunk* chunk)
+{
+    while (chunk != NULL)
+    {
+        struct BoltArenaChunk* next = chunk->next;
+        BoltAllocator_deallocate(allocator, chunk, align_up(sizeof(struct BoltArenaChunk)) + chunk->size);
+        chunk = next;
+    }
+}
+
+struct BoltArena* BoltArena_create(struct BoltAllocator* allocator, size_t chunk_size)
+{
+    if (allocator == NULL) allocator = BoltMem_allocator();
+    struct BoltArena* arena = BoltAllocator_allocate(allocator, sizeof(struct BoltArena));
+    arena->allocator = allocator;
+    arena->chunk_size = align_up(chunk_size);
+    arena->first = _create_chunk(allocator, arena->chunk_size);
+    arena->current = arena->first;
+    arena->capacity = arena->chunk_size;
+    arena->idle_rounds = 0;
+    return arena;
+}
+
+void BoltArena_destroy(struct BoltArena* arena)
+{
+    struct BoltAllocator* allocator = arena->allocator;
+    _destroy_chunks(allocator, arena->first);
+    BoltAllocator_deallocate(allocator, arena, sizeof(struct BoltArena));
+}
+
+void* BoltArena_allocate(struct BoltArena* arena, size_t size)
+{
+    size = align_up(size);
+    struct BoltArenaChunk* chunk = arena->current;
+    while (chunk->size - chunk->used < size)
+    {
+        if (chunk->next == NULL)
+        {
+            size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+            chunk->next = _create_chunk(arena->allocator, chunk_size);
+            arena->capacity += chunk_size;
+        }
+        chunk = chunk->next;
+        arena->current = chunk;
+    }
+    void* p = chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+/**
+ * Replace all chunks of an arena with a single one of the given size.
+ */
+static void _replace_chunks(struct BoltArena* arena, size_t size)
+{
+    _destroy_chunks(arena->allocator, arena->first);
+    arena->first = _create_chunk(arena->allocator, size);
+    arena->capacity = size;
+    arena->idle_rounds = 0;
+}
+
+void BoltArena_reset(struct BoltArena* arena)
+{
+    if (arena->current != arena->first)
+    {
+        _replace_chunks(arena, arena->capacity > MAX_RETAINED_SIZE ? arena->chunk_size : arena->capacity);
+    }
+    else if (arena->first->size > arena->chunk_size && arena->first->used < arena->first->size / SHRINK_FACTOR)
+    {
+        arena->idle_rounds += 1;
+        if (arena->idle_rounds == SHRINK_ROUNDS)
+        {
+            _replace_chunks(arena, arena->chunk_size);
+        }
+    }
+    else
+    {
+        arena->idle_rounds = 0;
+    }
+    arena->first->used = 0;
+    arena->current = arena->first;
+}
+
+static void* _allocate_values(struct BoltArena* arena, struct BoltValue* value, size_t n)
+{
+    size_t data_size = sizeof_n(struct BoltValue, n);
+    BoltValue_to_Null(value);
+    value->data.extended.as_ptr = data_size == 0 ? NULL : BoltArena_allocate(arena, data_size);
+    value->data_size = data_size;
+    if (data_size > 0)
+    {
+        memset(value->data.extended.as_char, 0, data_size);
+    }
+    value->flags |= BOLT_VALUE_ARENA;
+    return value->data.extended.as_ptr;
+}
+
+void BoltArena_to_String8(struct BoltArena* arena, struct BoltValue* value, const char* string, int32_t size)
+{
+    if (arena == NULL || size <= sizeof(value->data) / sizeof(char))
+    {
+        BoltValue_to_String8(value, string, size);
+        return;
+    }
+    BoltValue_to_Null(value);
+    value->data.extended.as_ptr = BoltArena_allocate(arena, (size_t)(size));
+    value->data_size = (size_t)(size);
+    if (string != NULL)
+    {
+        memcpy(value->data.extended.as_char, string, (size_t)(size));
+    }
+    value->flags |= BOLT_VALUE_ARENA;
+    _set_type(value, BOLT_STRING8, size);
+}
+
+void BoltArena_to_ByteArray(struct BoltArena* arena, struct BoltValue* value, const char* array, int32_t size)
+{
+    if (arena == NULL || size <= sizeof(value->data) / sizeof(char))
+    {
+        BoltValue_to_ByteArray(value, (char*)(array), size);
+        return;
+    }
+    BoltValue_to_Null(value);
+    value->data.extended.as_ptr = BoltArena_allocate(arena, (size_t)(size));
+    value->data_size = (size_t)(size);
+    if (array != NULL)
+    {
+        memcpy(value->data.extended.as_char, array, (size_t)(size));
+    }
+    value->flags |= BOLT_VALUE_ARENA;
+    _set_type(value, BOLT_BYTE_ARRAY, size);
+}
+
+/**
+ * Reformat a value to hold a point of `n` coordinates drawn from an
+ * arena, with the SRID ahead of them as for any other point.
+ */
+static void _to_point(struct BoltArena* arena, struct BoltValue* value, enum BoltType type, int64_t srid,
+                      const double* coordinates, int n)
+{
+    BoltValue_to_Null(value);
+    size_t data_size = sizeof(int64_t) + sizeof_n(double, n);
+    value->data.extended.as_ptr = BoltArena_allocate(arena, data_size);
+    value->data_size = data_size;
+    value->data.extended.as_int64[0] = srid;
+    memcpy(value->data.extended.as_double + 1, coordinates, sizeof_n(double, n));
+    value->flags |= BOLT_VALUE_ARENA;
+    _set_type(value, type, 1);
+}
+
+void BoltArena_to_Float64Pair(struct BoltArena* arena, struct BoltValue* value, int64_t srid, double x, double y)
+{
+    if (arena == NULL)
+    {
+        BoltValue_to_Float64Pair(value, srid, x, y);
+        return;
+    }
+    double xy[2] = {x, y};
+    _to_point(arena, value, BOLT_FLOAT64_PAIR, srid, xy, 2);
+}
+
+void BoltArena_to_Float64Triple(struct BoltArena* arena, struct BoltValue* value, int64_t srid,
+                                double x, double y, double z)
+{
+    if (arena == NULL)
+    {
+        BoltValue_to_Float64Triple(value, srid, x, y, z);
+        return;
+    }
+    double xyz[3] = {x, y, z};
+    _to_point(arena, value, BOLT_FLOAT64_TRIPLE, srid, xyz, 3);
+}
+
+void BoltArena_to_List(struct BoltArena* arena, struct BoltValue* value, int32_t size)
+{
+    if (arena == NULL)
+    {
+        BoltValue_to_List(value, size);
+        return;
+    }
+    _allocate_values(arena, value, (size_t)(size));
+    _set_type(value, BOLT_LIST, size);
+}
+
+void BoltArena_to_Dictionary8(struct BoltArena* arena, struct BoltValue* value, int32_t size)
+{
+    if (arena == NULL)
+    {
+        BoltValue_to_Dictionary8(value, size);
+        return;
+    }
+    _allocate_values(arena, value, 2 * (size_t)(size));
+    // Keep hold of the arena so that a key index can be drawn from it later
+    value->data.as_ptr[1] = arena;
+    _set_type(value, BOLT_DICTIONARY8, size);
+}
+
+void BoltArena_to_Structure(struct BoltArena* arena, struct BoltValue* value, int16_t code, int32_t size)
+{
+    if (arena == NULL)
+    {
+        BoltValue_to_Structure(value, code, size);
+        return;
+    }
+    _allocate_values(arena, value, (size_t)(size));
+    _set_type(value, BOLT_STRUCTURE, size);
+    value->code = code;
+}
+
+void BoltArena_to_Summary(struct BoltArena* arena, struct BoltValue* value, int16_t code, int32_t size)
+{
+    if (arena == NULL)
+    {
+        BoltValue_to_Summary(value, code, size);
+        return;
+    }
+    _allocate_values(arena, value, (size_t)(size));
+    _set_type(value, BOLT_SUMMARY, size);
+    value->code = code;
+}
+
+/**
+ * Determine whether a block of storage was drawn from an arena.
+ */
+static int _contains(struct BoltArena* arena, const void* p)
+{
+    for (struct BoltArenaChunk* chunk = arena->first; chunk != NULL; chunk = chunk->next)
+    {
+        if ((const char*)(p) >= chunk_data(chunk) && (const char*)(p) < chunk_data(chunk) + chunk->used)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Determine whether a value refers to storage outside an arena, such as
+ * an interned string, a view or an entity shared between records.
+ */
+static int _is_foreign(struct BoltArena* arena, const struct BoltValue* value)
+{
+    if (value->flags & (BOLT_VALUE_INTERNED | BOLT_VALUE_VIEW))
+    {
+        return 1;
+    }
+    return (value->flags & BOLT_VALUE_ARENA) && !_contains(arena, value->data.extended.as_ptr);
+}
+
+/**
+ * Copy into an arena any storage that a value, or anything nested
+ * within it, refers to outside of that arena.
+ */
+static void _claim(struct BoltArena* arena, struct BoltValue* value)
+{
+    enum BoltType type = BoltValue_type(value);
+    int32_t n;
+    switch (type)
+    {
+        case BOLT_LIST:
+        case BOLT_STRUCTURE:
+        case BOLT_SUMMARY:
+            n = value->size;
+            break;
+        case BOLT_DICTIONARY8:
+            n = 2 * value->size;
+            break;
+        case BOLT_STRING8:
+            if (_is_foreign(arena, value))
+            {
+                BoltArena_to_String8(arena, value, BoltString8_get(value), value->size);
+            }
+            return;
+        case BOLT_BYTE_ARRAY:
+            if (_is_foreign(arena, value))
+            {
+                BoltArena_to_ByteArray(arena, value, BoltByteArray_get_all(value), value->size);
+            }
+            return;
+        case BOLT_FLOAT64_PAIR:
+        case BOLT_FLOAT64_TRIPLE:
+            if (_is_foreign(arena, value))
+            {
+                _to_point(arena, value, type, value->data.extended.as_int64[0], value->data.extended.as_double + 1,
+                          type == BOLT_FLOAT64_PAIR ? 2 : 3);
+            }
+            return;
+        default:
+            return;
+    }
+    if (n > 0 && _is_foreign(arena, value))
+    {
+        size_t data_size = sizeof_n(struct BoltValue, n);
+        void* data = BoltArena_allocate(arena, data_size);
+        memcpy(data, value->data.extended.as_ptr, data_size);
+        value->data.extended.as_ptr = data;
+        if (type == BOLT_DICTIONARY8)
+        {
+            // Any index belongs with the original, so start afresh
+            value->flags &= ~BOLT_VALUE_INDEXED;
+            value->data.as_ptr[1] = arena;
+        }
+    }
+    for (int32_t i = 0; i < n; i++)
+    {
+        _claim(arena, &value->data.extended.as_value[i]);
+    }
+}
+
+int BoltArena_adopt(struct BoltArena* arena, struct BoltValue* value)
+{
+    enum BoltType type = BoltValue_type(value);
+    if ((type != BOLT_LIST && type != BOLT_STRUCTURE && type != BOLT_SUMMARY) || value->size == 0 ||
+        (value->flags & BOLT_VALUE_ARENA_OWNER) != BOLT_VALUE_ARENA || _is_foreign(arena, value))
+    {
+        return -1;
+    }
+    _claim(arena, value);
+    value->data.as_ptr[1] = arena;
+    value->flags |= BOLT_VALUE_ARENA_OWNER;
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_ARENA
+#define SEABOLT_ARENA
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mem.h>
+#include <values.h>
+
+
+struct BoltArenaChunk;
+
+/**
+ * A bump allocator for short-lived value storage.
+ *
+ * Allocations are carved sequentially out of one or more chunks and are
+ * never freed individually. Instead, the whole arena is reset in one go,
+ * after which its chunks are reused for the next round of allocations.
+ */
+struct BoltArena
+{
+    /// Allocator from which chunks are drawn
+    struct BoltAllocator* allocator;
+    /// First chunk in the chain
+    struct BoltArenaChunk* first;
+    /// Chunk currently being allocated from
+    struct BoltArenaChunk* current;
+    /// Minimum size of each new chunk
+    size_t chunk_size;
+    /// Total capacity of all chunks
+    size_t capacity;
+    /// Consecutive resets after which a large first chunk was mostly unused
+    int idle_rounds;
+};
+
+
+/**
+ * Create an arena.
+ *
+ * @param allocator the allocator from which to draw chunks, or NULL for the installed allocator
+ * @param chunk_size minimum size of each chunk
+ * @return
+ */
+struct BoltArena* BoltArena_create(struct BoltAllocator* allocator, size_t chunk_size);
+
+void BoltArena_destroy(struct BoltArena* arena);
+
+/**
+ * Allocate storage from an arena.
+ *
+ * The returned block is aligned for any value type and remains valid
+ * until the next call to `BoltArena_reset`.
+ *
+ * @param arena
+ * @param size
+ * @return
+ */
+void* BoltArena_allocate(struct BoltArena* arena, size_t size);
+
+/**
+ * Release all storage allocated from an arena.
+ *
+ * If the previous round of allocations overflowed into further chunks,
+ * these are merged into a single chunk large enough to hold them all,
+ * so that a steady workload settles into a single chunk and allocates
+ * nothing further. So that a single large round does not pin its memory
+ * for good, the arena instead drops back to one chunk of the initial
+ * size where the merged chunk would exceed 1 MiB, or where a chunk above
+ * the initial size has had under a quarter of it used for 16 rounds
+ * running.
+ *
+ * @param arena
+ */
+void BoltArena_reset(struct BoltArena* arena);
+
+/**
+ * Hand an arena over to a list, structure or summary drawn from it.
+ *
+ * Anything the value refers to outside of the arena, such as interned
+ * strings, views and shared entities, is first copied in. The arena is
+ * then destroyed when the value is reset or destroyed, and must not be
+ * used or destroyed otherwise.
+ *
+ * @param arena
+ * @param value
+ * @return 0 on success, -1 if the value is not a container drawn from the arena
+ */
+int BoltArena_adopt(struct BoltArena* arena, struct BoltValue* value);
+
+
+// The following functions mirror their `BoltValue_to_*` counterparts
+// but draw any external storage from the given arena. Nested values
+// created this way should be treated as read-only: their storage is
+// forgotten, not freed, when the enclosing value is recycled. If
+// `arena` is NULL, the regular heap-backed function is used instead.
+
+void BoltArena_to_String8(struct BoltArena* arena, struct BoltValue* value, const char* string, int32_t size);
+
+void BoltArena_to_ByteArray(struct BoltArena* arena, struct BoltValue* value, const char* array, int32_t size);
+
+void BoltArena_to_Float64Pair(struct BoltArena* arena, struct BoltValue* value, int64_t srid, double x, double y);
+
+void BoltArena_to_Float64Triple(struct BoltArena* arena, struct BoltValue* value, int64_t srid,
+                                double x, double y, double z);
+
+void BoltArena_to_List(struct BoltArena* arena, struct BoltValue* value, int32_t size);
+
+void BoltArena_to_Dictionary8(struct BoltArena* arena, struct BoltValue* value, int32_t size);
+
+void BoltArena_to_Structure(struct BoltArena* arena, struct BoltValue* value, int16_t code, int32_t size);
+
+void BoltArena_to_Summary(struct BoltArena* arena, struct BoltValue* value, int16_t code, int32_t size);
+
+
+#endif // SEABOLT_ARENA
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <memory.h>
+#include "binding.h"
+#include "events.h"
+#include "mem.h"
+#include "protocol/v1.h"
+
+
+struct BoltRowBinding
+{
+    int32_t n_fields;
+    struct BoltFieldBinding fields[BOLT_BINDING_MAX_FIELDS];
+    size_t row_size;
+    size_t null_offset;
+    /// Binding index for each record field, or -1 where the field is not bound
+    int32_t* slots;
+    int32_t n_slots;
+
+    /// Row being written
+    char* row;
+    /// Depth within the record, where 1 is that of the record fields
+    int32_t depth;
+    /// Index of the next record field
+    int32_t field;
+    int32_t record_size;
+    uint64_t nulls;
+};
+
+
+static size_t _type_size(enum BoltType type)
+{
+    switch (type)
+    {
+        case BOLT_BIT:
+        case BOLT_INT8:
+            return 1;
+        case BOLT_INT16:
+            return 2;
+        case BOLT_INT32:
+        case BOLT_FLOAT32:
+            return 4;
+        case BOLT_INT64:
+        case BOLT_FLOAT64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static int _is_valid(const struct BoltFieldBinding* field, size_t row_size)
+{
+    if (field->field < 0 || field->size > row_size || field->offset > row_size - field->size) return 0;
+    if (field->type == BOLT_STRING8) return field->size >= 1;
+    size_t size = _type_size(field->type);
+    return size != 0 && field->size == size;
+}
+
+struct BoltRowBinding* BoltRowBinding_create(const struct BoltFieldBinding* fields, int32_t n_fields,
+                                             size_t row_size, size_t null_offset)
+{
+    if (n_fields < 0 || n_fields > BOLT_BINDING_MAX_FIELDS) return NULL;
+    if (null_offset != BOLT_BINDING_NO_NULL_MASK &&
+        (row_size < sizeof(uint64_t) || null_offset > row_size - sizeof(uint64_t))) return NULL;
+    int32_t n_slots = 0;
+    for (int32_t i = 0; i < n_fields; i++)
+    {
+        if (!_is_valid(&fields[i], row_size)) return NULL;
+        if (fields[i].field >= n_slots) n_slots = fields[i].field + 1;
+    }
+    int32_t* slots = BoltMem_allocate(sizeof_n(int32_t, n_slots));
+    for (int32_t i = 0; i < n_slots; i++)
+    {
+        slots[i] = -1;
+    }
+    for (int32_t i = 0; i < n_fields; i++)
+    {
+        if (slots[fields[i].field] != -1)
+        {
+            // Each record field can only be bound once
+            BoltMem_deallocate(slots, sizeof_n(int32_t, n_slots));
+            return NULL;
+        }
+        slots[fields[i].field] = i;
+    }
+    struct BoltRowBinding* binding = BoltMem_allocate(sizeof(struct BoltRowBinding));
+    binding->n_fields = n_fields;
+    memcpy(binding->fields, fields, sizeof_n(struct BoltFieldBinding, n_fields));
+    binding->row_size = row_size;
+    binding->null_offset = null_offset;
+    binding->slots = slots;
+    binding->n_slots = n_slots;
+    binding->row = NULL;
+    binding->depth = 0;
+    return binding;
+}
+
+void BoltRowBinding_destroy(struct BoltRowBinding* binding)
+{
+    BoltMem_deallocate(binding->slots, sizeof_n(int32_t, binding->n_slots));
+    BoltMem_deallocate(binding, sizeof(struct BoltRowBinding));
+}
+
+/**
+ * Move on to the next value at the depth of the record fields, if that
+ * is where decoding is.
+ *
+ * @return the binding index of the field, or -1 if the value is nested
+ *         or its field is not bound
+ */
+static int32_t _next_field(struct BoltRowBinding* binding)
+{
+    if (binding->depth != 1) return -1;
+    int32_t field = binding->field;
+    binding->field += 1;
+    return field < binding->n_slots ? binding->slots[field] : -1;
+}
+
+static void _write(struct BoltRowBinding* binding, int32_t index, const void* data, size_t size)
+{
+    memcpy(&binding->row[binding->fields[index].offset], data, size);
+}
+
+static void _write_null(struct BoltRowBinding* binding, int32_t index)
+{
+    memset(&binding->row[binding->fields[index].offset], 0, binding->fields[index].size);
+    binding->nulls |= (uint64_t)(1) << index;
+}
+
+static int _write_int(struct BoltRowBinding* binding, int32_t index, int64_t x)
+{
+    switch (binding->fields[index].type)
+    {
+        case BOLT_INT8:
+        {
+            if (x < INT8_MIN || x > INT8_MAX) return -1;
+            int8_t y = (int8_t)(x);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        case BOLT_INT16:
+        {
+            if (x < INT16_MIN || x > INT16_MAX) return -1;
+            int16_t y = (int16_t)(x);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        case BOLT_INT32:
+        {
+            if (x < INT32_MIN || x > INT32_MAX) return -1;
+            int32_t y = (int32_t)(x);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        case BOLT_INT64:
+        {
+            _write(binding, index, &x, sizeof(x));
+            return 0;
+        }
+        case BOLT_FLOAT32:
+        {
+            float y = (float)(x);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        case BOLT_FLOAT64:
+        {
+            double y = (double)(x);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+static int _on_null(void* context)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    int32_t index = _next_field(binding);
+    if (index != -1)
+    {
+        _write_null(binding, index);
+    }
+    return 0;
+}
+
+static int _on_boolean(void* context, int x)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    int32_t index = _next_field(binding);
+    if (index == -1) return 0;
+    switch (binding->fields[index].type)
+    {
+        case BOLT_BIT:
+        {
+            char y = (char)(x != 0);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        case BOLT_FLOAT32:
+        case BOLT_FLOAT64:
+            return -1;
+        default:
+            return _write_int(binding, index, x != 0);
+    }
+}
+
+static int _on_int(void* context, int64_t x)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    int32_t index = _next_field(binding);
+    return index == -1 ? 0 : _write_int(binding, index, x);
+}
+
+static int _on_float(void* context, double x)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    int32_t index = _next_field(binding);
+    if (index == -1) return 0;
+    switch (binding->fields[index].type)
+    {
+        case BOLT_FLOAT32:
+        {
+            float y = (float)(x);
+            _write(binding, index, &y, sizeof(y));
+            return 0;
+        }
+        case BOLT_FLOAT64:
+        {
+            _write(binding, index, &x, sizeof(x));
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+static int _on_string(void* context, const char* string, int32_t size)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    int32_t index = _next_field(binding);
+    if (index == -1) return 0;
+    const struct BoltFieldBinding* field = &binding->fields[index];
+    if (field->type != BOLT_STRING8 || (size_t)(size) >= field->size) return -1;
+    char* member = &binding->row[field->offset];
+    memcpy(member, string, (size_t)(size));
+    member[size] = '\0';
+    return 0;
+}
+
+static int _on_bytes(void* context, const char* data, int32_t size)
+{
+    return _next_field((struct BoltRowBinding*)(context)) == -1 ? 0 : -1;
+}
+
+/**
+ * Step into a container, which is only allowed for fields that are not
+ * bound (or values nested within them).
+ */
+static int _on_container_begin(void* context, int32_t size)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    if (_next_field(binding) != -1) return -1;
+    binding->depth += 1;
+    return 0;
+}
+
+static int _on_list_begin(void* context, int32_t size)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    if (binding->depth == 0)
+    {
+        binding->depth = 1;
+        binding->field = 0;
+        binding->record_size = size;
+        binding->nulls = 0;
+        return 0;
+    }
+    return _on_container_begin(context, size);
+}
+
+static int _on_struct_begin(void* context, int16_t code, int32_t size)
+{
+    return _on_container_begin(context, size);
+}
+
+static int _on_end(void* context)
+{
+    struct BoltRowBinding* binding = (struct BoltRowBinding*)(context);
+    binding->depth -= 1;
+    if (binding->depth == 0)
+    {
+        for (int32_t i = 0; i < binding->n_fields; i++)
+        {
+            if (binding->fields[i].field >= binding->record_size)
+            {
+                _write_null(binding, i);
+            }
+        }
+        if (binding->null_offset != BOLT_BINDING_NO_NULL_MASK)
+        {
+            memcpy(&binding->row[binding->null_offset], &binding->nulls, sizeof(uint64_t));
+        }
+    }
+    return 0;
+}
+
+static const struct BoltEventHandler BINDING_HANDLER = {
+        _on_null, _on_boolean, _on_int, _on_float, _on_string, _on_bytes,
+        _on_list_begin, _on_container_begin, _on_struct_begin, _on_end,
+};
+
+int BoltRowBinding_unload(struct BoltRowBinding* binding, struct BoltConnection* connection, void* row)
+{
+    binding->row = (char*)(row);
+    binding->depth = 0;
+    return BoltProtocolV1_unload_events(connection, &BINDING_HANDLER, binding);
+}
+
+int BoltRowBinding_fetch_b(struct BoltRowBinding* binding, struct BoltConnection* connection, int request_id,
+                           void* row)
+{
+    binding->row = (char*)(row);
+    binding->depth = 0;
+    return BoltConnection_fetch_events_b(connection, request_id, &BINDING_HANDLER, binding);
+}
+
+int32_t BoltRowBinding_fetch_batch_b(struct BoltRowBinding* binding, struct BoltConnection* connection,
+                                     int request_id, void* rows, int32_t n_rows)
+{
+    int32_t n = 0;
+    while (n < n_rows)
+    {
+        int status = BoltRowBinding_fetch_b(binding, connection, request_id, (char*)(rows) + n * binding->row_size);
+        if (status == -1) return -1;
+        if (status == 0) break;
+        n += 1;
+    }
+    return n;
+}
@@ -24,11 +24,13 @@
 #include <mem.h>
 
 
-struct BoltBuffer* BoltBuffer_create(size_t size)
+struct BoltBuffer* BoltBuffer_create(struct BoltAllocator* allocator, size_t size)
 {
-    struct BoltBuffer* buffer = BoltMem_allocate(sizeof(struct BoltBuffer));
+    if (allocator == NULL) allocator = BoltMem_allocator();
+    struct BoltBuffer* buffer = BoltAllocator_allocate(allocator, sizeof(struct BoltBuffer));
+    buffer->allocator = allocator;
     buffer->size = size;
-    buffer->data = BoltMem_allocate(buffer->size);
+    buffer->data = BoltAllocator_allocate(allocator, buffer->size);
     buffer->extent = 0;
     buffer->cursor = 0;
     return buffer;
@@ -36,8 +38,9 @@ struct BoltBuffer* BoltBuffer_create(size_t size)
 
 void BoltBuffer_destroy(struct BoltBuffer* buffer)
 {
-    buffer->data = BoltMem_deallocate(buffer->data, buffer->size);
-    BoltMem_deallocate(buffer, sizeof(struct BoltBuffer));
+    struct BoltAllocator* allocator = buffer->allocator;
+    buffer->data = BoltAllocator_deallocate(allocator, buffer->data, buffer->size);
+    BoltAllocator_deallocate(allocator, buffer, sizeof(struct BoltBuffer));
 }
 
 void BoltBuffer_compact(struct BoltBuffer* buffer)
@@ -47,7 +50,7 @@ void BoltBuffer_compact(struct BoltBuffer* buffer)
         int available = buffer->extent - buffer->cursor;
         if (available > 0)
         {
-            memcpy(&buffer->data[0], &buffer->data[buffer->cursor], (size_t)(available));
+            memmove(&buffer->data[0], &buffer->data[buffer->cursor], (size_t)(available));
         }
         buffer->cursor = 0;
         buffer->extent = available;
@@ -66,7 +69,7 @@ char* BoltBuffer_load_target(struct BoltBuffer* buffer, int size)
     if (size > available)
     {
         size_t new_size = buffer->size + (size - available);
-        buffer->data = BoltMem_reallocate(buffer->data, buffer->size, new_size);
+        buffer->data = BoltAllocator_reallocate(buffer->allocator, buffer->data, buffer->size, new_size);
         buffer->size = new_size;
     }
     int extent = buffer->extent;
@@ -95,37 +98,37 @@ void BoltBuffer_load_uint8(struct BoltBuffer* buffer, uint8_t x)
 void BoltBuffer_load_uint16_be(struct BoltBuffer* buffer, uint16_t x)
 {
     char* target = BoltBuffer_load_target(buffer, sizeof(x));
-    memcpy_be(&target[0], &x, sizeof(x));
+    memcpy_be16(&target[0], &x);
 }
 
 void BoltBuffer_load_int16_be(struct BoltBuffer* buffer, int16_t x)
 {
     char* target = BoltBuffer_load_target(buffer, sizeof(x));
-    memcpy_be(&target[0], &x, sizeof(x));
+    memcpy_be16(&target[0], &x);
 }
 
 void BoltBuffer_load_int32_be(struct BoltBuffer* buffer, int32_t x)
 {
     char* target = BoltBuffer_load_target(buffer, sizeof(x));
-    memcpy_be(&target[0], &x, sizeof(x));
+    memcpy_be32(&target[0], &x);
 }
 
 void BoltBuffer_load_int64_be(struct BoltBuffer* buffer, int64_t x)
 {
     char* target = BoltBuffer_load_target(buffer, sizeof(x));
-    memcpy_be(&target[0], &x, sizeof(x));
+    memcpy_be64(&target[0], &x);
 }
 
 void BoltBuffer_load_float_be(struct BoltBuffer* buffer, float x)
 {
     char* target = BoltBuffer_load_target(buffer, (int)((sizeof(x))));
-    memcpy_be(&target[0], &x, sizeof(x));
+    memcpy_be32(&target[0], &x);
 }
 
 void BoltBuffer_load_double_be(struct BoltBuffer* buffer, double x)
 {
     char* target = BoltBuffer_load_target(buffer, (int)((sizeof(x))));
-    memcpy_be(&target[0], &x, sizeof(x));
+    memcpy_be64(&target[0], &x);
 }
 
 int BoltBuffer_unloadable(struct BoltBuffer* buffer)
@@ -178,7 +181,7 @@ int BoltBuffer_unload_uint8(struct BoltBuffer* buffer, uint8_t* x)
 int BoltBuffer_unload_uint16_be(struct BoltBuffer* buffer, uint16_t* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    memcpy_be16(x, &buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
@@ -186,7 +189,7 @@ int BoltBuffer_unload_uint16_be(struct BoltBuffer* buffer, uint16_t* x)
 int BoltBuffer_unload_int8(struct BoltBuffer* buffer, int8_t* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    *x = (int8_t)(buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
@@ -194,7 +197,7 @@ int BoltBuffer_unload_int8(struct BoltBuffer* buffer, int8_t* x)
 int BoltBuffer_unload_int16_be(struct BoltBuffer* buffer, int16_t* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    memcpy_be16(x, &buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
@@ -202,7 +205,7 @@ int BoltBuffer_unload_int16_be(struct BoltBuffer* buffer, int16_t* x)
 int BoltBuffer_unload_int32_be(struct BoltBuffer* buffer, int32_t* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    memcpy_be32(x, &buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
@@ -210,7 +213,7 @@ int BoltBuffer_unload_int32_be(struct BoltBuffer* buffer, int32_t* x)
 int BoltBuffer_unload_int64_be(struct BoltBuffer* buffer, int64_t* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    memcpy_be64(x, &buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
@@ -218,7 +221,7 @@ int BoltBuffer_unload_int64_be(struct BoltBuffer* buffer, int64_t* x)
 int BoltBuffer_unload_float_be(struct BoltBuffer* buffer, float* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    memcpy_be32(x, &buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
@@ -226,7 +229,7 @@ int BoltBuffer_unload_float_be(struct BoltBuffer* buffer, float* x)
 int BoltBuffer_unload_double_be(struct BoltBuffer* buffer, double* x)
 {
     if (BoltBuffer_unloadable(buffer) < sizeof(*x)) return -1;
-    memcpy_be(x, &buffer->data[buffer->cursor], sizeof(*x));
+    memcpy_be64(x, &buffer->data[buffer->cursor]);
     buffer->cursor += sizeof(*x);
     return 0;
 }
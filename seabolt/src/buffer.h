@@ -26,10 +26,12 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <mem.h>
 
 
 struct BoltBuffer
 {
+    struct BoltAllocator* allocator;
     size_t size;
     int extent;
     int cursor;
@@ -37,7 +39,14 @@ struct BoltBuffer
 };
 
 
-struct BoltBuffer* BoltBuffer_create(size_t size);
+/**
+ * Create a buffer.
+ *
+ * @param allocator the allocator from which to draw buffer storage, or NULL for the installed allocator
+ * @param size initial capacity
+ * @return
+ */
+struct BoltBuffer* BoltBuffer_create(struct BoltAllocator* allocator, size_t size);
 
 void BoltBuffer_destroy(struct BoltBuffer* buffer);
 
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <memory.h>
+#include "bulk.h"
+#include "buffer.h"
+#include "mem.h"
+#include "protocol/v1.h"
+
+
+/// Space reserved ahead of the encoded rows of a batch, enough for the
+/// largest list header
+#define ROWS_HEADER_SIZE 5
+
+/// Requests making up each batch: BEGIN, RUN, DISCARD_ALL and COMMIT
+#define BATCH_REQUESTS 4
+
+
+struct BoltBulkBatch
+{
+    /// The last request ID of each part of the batch
+    int request_ids[BATCH_REQUESTS];
+    int32_t n_rows;
+};
+
+/**
+ * A connection that batches are sent over, with a ring of the batches
+ * awaiting acknowledgement on it (oldest first).
+ */
+struct BoltBulkShard
+{
+    struct BoltConnection* connection;
+    /// The statement, prepared for this connection
+    struct BoltPreparedStatement* prepared;
+    struct BoltBulkBatch* batches;
+    int32_t first;
+    int32_t n_in_flight;
+};
+
+struct BoltBulkWriter
+{
+    struct BoltBulkShard* shards;
+    int n_shards;
+    int next_shard;
+    int32_t max_in_flight;
+
+    int32_t n_fields;
+    /// Field keys, each encoded and held as a byte array
+    struct BoltValue* keys;
+    /// Field values of the current row
+    struct BoltValue* row;
+
+    /// Encoded rows of the current batch, after `ROWS_HEADER_SIZE`
+    /// reserved bytes
+    struct BoltBuffer* rows;
+    int32_t n_rows;
+    int32_t max_rows;
+    int32_t max_bytes;
+    /// Bare connection encoding into `rows`
+    struct BoltConnection encoder;
+    struct BoltProtocolV1State encoder_state;
+
+    int64_t rows_written;
+    int failed;
+};
+
+
+void _reset_batch(struct BoltBulkWriter* writer)
+{
+    writer->rows->cursor = 0;
+    writer->rows->extent = 0;
+    BoltBuffer_load_target(writer->rows, ROWS_HEADER_SIZE);
+    writer->n_rows = 0;
+}
+
+struct BoltBulkBatch* _allocate_batches(int32_t n)
+{
+    return BoltMem_allocate(n * sizeof(struct BoltBulkBatch));
+}
+
+struct BoltBulkWriter* BoltBulkWriter_create(struct BoltConnection** connections, int n_connections,
+                                             const char* statement, size_t size, int32_t n_fields)
+{
+    if (n_connections < 1 || n_fields < 0 || size > INT32_MAX)
+    {
+        return NULL;
+    }
+    // Rows are encoded once, for the oldest version of any connection
+    int32_t protocol_version = 2;
+    for (int i = 0; i < n_connections; i++)
+    {
+        if ((connections[i]->protocol_version < 1 || connections[i]->protocol_version > 2))
+        {
+            return NULL;
+        }
+        if (connections[i]->protocol_version < protocol_version)
+        {
+            protocol_version = connections[i]->protocol_version;
+        }
+    }
+    // Prepare the statement for each connection first, so that nothing
+    // else is left to clean up should any of them fail.
+    struct BoltBulkShard* shards = BoltMem_allocate(n_connections * sizeof(struct BoltBulkShard));
+    for (int i = 0; i < n_connections; i++)
+    {
+        shards[i].prepared = BoltConnection_prepare(connections[i], statement, size, 1);
+        if (shards[i].prepared == NULL)
+        {
+            for (int j = 0; j < i; j++)
+            {
+                BoltPreparedStatement_destroy(shards[j].prepared);
+            }
+            BoltMem_deallocate(shards, n_connections * sizeof(struct BoltBulkShard));
+            return NULL;
+        }
+        BoltPreparedStatement_set_parameter_key(shards[i].prepared, 0, "rows", 4);
+    }
+    struct BoltBulkWriter* writer = BoltMem_allocate(sizeof(struct BoltBulkWriter));
+    writer->n_shards = n_connections;
+    writer->next_shard = 0;
+    writer->max_in_flight = BOLT_BULK_DEFAULT_MAX_IN_FLIGHT;
+    writer->shards = shards;
+    for (int i = 0; i < n_connections; i++)
+    {
+        writer->shards[i].connection = connections[i];
+        writer->shards[i].batches = _allocate_batches(writer->max_in_flight);
+        writer->shards[i].first = 0;
+        writer->shards[i].n_in_flight = 0;
+    }
+    writer->n_fields = n_fields;
+    writer->keys = BoltValue_create();
+    BoltValue_to_List(writer->keys, n_fields);
+    writer->row = BoltValue_create();
+    BoltValue_to_List(writer->row, n_fields);
+    writer->rows = BoltBuffer_create(NULL, 4096);
+    writer->max_rows = BOLT_BULK_DEFAULT_MAX_ROWS;
+    writer->max_bytes = BOLT_BULK_DEFAULT_MAX_BYTES;
+    BoltProtocolV1_init_encoder(&writer->encoder, &writer->encoder_state, writer->rows, protocol_version);
+    _reset_batch(writer);
+    writer->rows_written = 0;
+    writer->failed = 0;
+    return writer;
+}
+
+void BoltBulkWriter_destroy(struct BoltBulkWriter* writer)
+{
+    BoltBuffer_destroy(writer->rows);
+    BoltValue_destroy(writer->row);
+    BoltValue_destroy(writer->keys);
+    for (int i = 0; i < writer->n_shards; i++)
+    {
+        BoltPreparedStatement_destroy(writer->shards[i].prepared);
+        BoltMem_deallocate(writer->shards[i].batches, writer->max_in_flight * sizeof(struct BoltBulkBatch));
+    }
+    BoltMem_deallocate(writer->shards, writer->n_shards * sizeof(struct BoltBulkShard));
+    BoltMem_deallocate(writer, sizeof(struct BoltBulkWriter));
+}
+
+int BoltBulkWriter_set_field_key(struct BoltBulkWriter* writer, int32_t index, const char* key, size_t key_size)
+{
+    if (index < 0 || index >= writer->n_fields || key_size > INT32_MAX)
+    {
+        return -1;
+    }
+    // Encode the key at the end of the current batch, then take it back off.
+    int extent = writer->rows->extent;
+    try(BoltProtocolV1_load_string(&writer->encoder, key, (int32_t)(key_size)));
+    BoltValue_to_ByteArray(BoltList_value(writer->keys, index), &writer->rows->data[extent],
+                           writer->rows->extent - extent);
+    writer->rows->extent = extent;
+    return 0;
+}
+
+int BoltBulkWriter_set_batch_limits(struct BoltBulkWriter* writer, int32_t max_rows, int32_t max_bytes)
+{
+    // Leave room for a row or so beyond the byte limit, as a batch is
+    // only sent once it has gone over.
+    if (max_rows < 1 || max_bytes < 1 || max_bytes > INT32_MAX / 2)
+    {
+        return -1;
+    }
+    writer->max_rows = max_rows;
+    writer->max_bytes = max_bytes;
+    return 0;
+}
+
+int BoltBulkWriter_set_max_in_flight(struct BoltBulkWriter* writer, int32_t n)
+{
+    if (n < 1 || n > INT32_MAX / (int32_t)(sizeof(struct BoltBulkBatch)))
+    {
+        return -1;
+    }
+    for (int i = 0; i < writer->n_shards; i++)
+    {
+        if (writer->shards[i].n_in_flight > 0)
+        {
+            return -1;
+        }
+    }
+    for (int i = 0; i < writer->n_shards; i++)
+    {
+        BoltMem_deallocate(writer->shards[i].batches, writer->max_in_flight * sizeof(struct BoltBulkBatch));
+        writer->shards[i].batches = _allocate_batches(n);
+        writer->shards[i].first = 0;
+    }
+    writer->max_in_flight = n;
+    return 0;
+}
+
+struct BoltValue* BoltBulkWriter_field_value(struct BoltBulkWriter* writer, int32_t field)
+{
+    if (field < 0 || field >= writer->n_fields)
+    {
+        return NULL;
+    }
+    return BoltList_value(writer->row, field);
+}
+
+int BoltBulkWriter_set_null(struct BoltBulkWriter* writer, int32_t field)
+{
+    struct BoltValue* value = BoltBulkWriter_field_value(writer, field);
+    if (value == NULL)
+    {
+        return -1;
+    }
+    BoltValue_to_Null(value);
+    return 0;
+}
+
+int BoltBulkWriter_set_boolean(struct BoltBulkWriter* writer, int32_t field, int x)
+{
+    struct BoltValue* value = BoltBulkWriter_field_value(writer, field);
+    if (value == NULL)
+    {
+        return -1;
+    }
+    BoltValue_to_Bit(value, (char)(x != 0));
+    return 0;
+}
+
+int BoltBulkWriter_set_integer(struct BoltBulkWriter* writer, int32_t field, int64_t x)
+{
+    struct BoltValue* value = BoltBulkWriter_field_value(writer, field);
+    if (value == NULL)
+    {
+        return -1;
+    }
+    BoltValue_to_Int64(value, x);
+    return 0;
+}
+
+int BoltBulkWriter_set_float(struct BoltBulkWriter* writer, int32_t field, double x)
+{
+    struct BoltValue* value = BoltBulkWriter_field_value(writer, field);
+    if (value == NULL)
+    {
+        return -1;
+    }
+    BoltValue_to_Float64(value, x);
+    return 0;
+}
+
+int BoltBulkWriter_set_string(struct BoltBulkWriter* writer, int32_t field, const char* string, size_t size)
+{
+    struct BoltValue* value = BoltBulkWriter_field_value(writer, field);
+    if (value == NULL || size > INT32_MAX)
+    {
+        return -1;
+    }
+    BoltValue_to_String8(value, string, (int32_t)(size));
+    return 0;
+}
+
+/**
+ * Wait for the oldest batch in flight on a connection to be acknowledged.
+ *
+ * Each part of the batch is checked in turn, since once one fails the
+ * server ignores the rest.
+ *
+ * @param writer
+ * @param shard
+ * @return 0 if the batch was committed, -1 otherwise
+ */
+int _acknowledge_b(struct BoltBulkWriter* writer, struct BoltBulkShard* shard)
+{
+    struct BoltBulkBatch* batch = &shard->batches[shard->first];
+    for (int i = 0; i < BATCH_REQUESTS; i++)
+    {
+        if (BoltConnection_fetch_summary_b(shard->connection, batch->request_ids[i]) == -1 ||
+            BoltSummary_code(BoltConnection_fetched(shard->connection)) != 0x70)
+        {
+            BoltLog_error("bolt: Batch of %d rows failed", batch->n_rows);
+            writer->failed = 1;
+            return -1;
+        }
+    }
+    shard->first = (shard->first + 1) % writer->max_in_flight;
+    shard->n_in_flight -= 1;
+    writer->rows_written += batch->n_rows;
+    return 0;
+}
+
+int BoltBulkWriter_append_b(struct BoltBulkWriter* writer)
+{
+    if (writer->failed)
+    {
+        return -1;
+    }
+    int extent = writer->rows->extent;
+    int status = BoltProtocolV1_load_map_header(&writer->encoder, writer->n_fields);
+    for (int32_t i = 0; i < writer->n_fields && status == 0; i++)
+    {
+        struct BoltValue* key = BoltList_value(writer->keys, i);
+        if (BoltValue_type(key) != BOLT_BYTE_ARRAY)
+        {
+            status = -1;
+            break;
+        }
+        BoltBuffer_load(writer->rows, BoltByteArray_get_all(key), key->size);
+        status = BoltProtocolV1_load(&writer->encoder, BoltList_value(writer->row, i));
+    }
+    for (int32_t i = 0; i < writer->n_fields; i++)
+    {
+        BoltValue_to_Null(BoltList_value(writer->row, i));
+    }
+    if (status == -1)
+    {
+        writer->rows->extent = extent;
+        return -1;
+    }
+    writer->n_rows += 1;
+    if (writer->n_rows >= writer->max_rows || writer->rows->extent - ROWS_HEADER_SIZE >= writer->max_bytes)
+    {
+        return BoltBulkWriter_flush_b(writer);
+    }
+    return 0;
+}
+
+int BoltBulkWriter_flush_b(struct BoltBulkWriter* writer)
+{
+    if (writer->failed)
+    {
+        return -1;
+    }
+    if (writer->n_rows == 0)
+    {
+        return 0;
+    }
+    struct BoltBulkShard* shard = &writer->shards[writer->next_shard];
+    writer->next_shard = (writer->next_shard + 1) % writer->n_shards;
+    if (shard->n_in_flight == writer->max_in_flight)
+    {
+        try(_acknowledge_b(writer, shard));
+    }
+    // Encode the list header at the end of the rows, then move it into
+    // the reserved space right in front of them.
+    struct BoltBuffer* rows = writer->rows;
+    int extent = rows->extent;
+    BoltProtocolV1_load_list_header(&writer->encoder, writer->n_rows);
+    int start = ROWS_HEADER_SIZE - (rows->extent - extent);
+    memcpy(&rows->data[start], &rows->data[extent], (size_t)(rows->extent - extent));
+    rows->extent = extent;
+    // The rows go out verbatim, straight from where they were encoded,
+    // so they must be left untouched until the batch has been sent.
+    struct BoltValue* parameter = BoltPreparedStatement_parameter_value(shard->prepared, 0);
+    BoltValue_to_BorrowedByteArray(parameter, &rows->data[start], extent - start);
+    parameter->flags |= BOLT_VALUE_FROZEN;
+
+    struct BoltConnection* connection = shard->connection;
+    struct BoltBulkBatch* batch = &shard->batches[(shard->first + shard->n_in_flight) % writer->max_in_flight];
+    batch->n_rows = writer->n_rows;
+    batch->request_ids[0] = BoltConnection_load_begin_request(connection);
+    batch->request_ids[1] = BoltConnection_load_prepared_run_request(connection, shard->prepared);
+    batch->request_ids[2] = BoltConnection_load_discard_request(connection, -1);
+    batch->request_ids[3] = BoltConnection_load_commit_request(connection);
+    int sent = BoltConnection_send_b(connection);
+    _reset_batch(writer);
+    if (sent == -1)
+    {
+        BoltLog_error("bolt: Batch of %d rows could not be sent", batch->n_rows);
+        writer->failed = 1;
+        return -1;
+    }
+    shard->n_in_flight += 1;
+    return 0;
+}
+
+int BoltBulkWriter_finish_b(struct BoltBulkWriter* writer)
+{
+    try(BoltBulkWriter_flush_b(writer));
+    for (int i = 0; i < writer->n_shards; i++)
+    {
+        while (writer->shards[i].n_in_flight > 0)
+        {
+            try(_acknowledge_b(writer, &writer->shards[i]));
+        }
+    }
+    return 0;
+}
+
+int64_t BoltBulkWriter_rows_written(struct BoltBulkWriter* writer)
+{
+    return writer->rows_written;
+}
@@ -22,8 +22,11 @@
 #include <openssl/ssl.h>
 #include <connect.h>
 #include "protocol/v1.h"
+#include "arena.h"
 #include "buffer.h"
+#include "reader.h"
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <connect.h>
@@ -34,6 +37,8 @@
 
 #define INITIAL_TX_BUFFER_SIZE 8192
 #define INITIAL_RX_BUFFER_SIZE 8192
+/// Most places gathered into a single send
+#define MAX_TRANSMIT_VECTORS 64
 
 #define char_to_uint16be(array) ((uint8_t)(header[0]) << 8) | (uint8_t)(header[1]);
 
@@ -42,6 +47,7 @@
 #define SHUTDOWN(socket, how) shutdown(socket, how)
 #define TRANSMIT(socket, data, size, flags) (int)(send(socket, data, (size_t)(size), flags))
 #define TRANSMIT_S(socket, data, size, flags) SSL_write(socket, data, size)
+#define TRANSMIT_V(socket, message, flags) sendmsg(socket, message, flags)
 #define RECEIVE(socket, buffer, size, flags) (int)(recv(socket, buffer, (size_t)(size), flags))
 #define RECEIVE_S(socket, buffer, size, flags) SSL_read(socket, buffer, size)
 
@@ -57,9 +63,12 @@ void _copy_ipv4_socket_address(char* target, struct sockaddr_in* source)
     memcpy(&target[12], &source->sin_addr.s_addr, 4);
 }
 
-struct BoltConnection* _create(enum BoltTransport transport)
+struct BoltConnection* _create(enum BoltTransport transport, struct BoltAllocator* allocator)
 {
-    struct BoltConnection* connection = BoltMem_allocate(sizeof(struct BoltConnection));
+    if (allocator == NULL) allocator = BoltMem_allocator();
+    struct BoltConnection* connection = BoltAllocator_allocate(allocator, sizeof(struct BoltConnection));
+
+    connection->allocator = allocator;
 
     connection->transport = transport;
 
@@ -70,12 +79,14 @@ struct BoltConnection* _create(enum BoltTransport transport)
     connection->protocol_version = 0;
     connection->protocol_state = NULL;
 
-    connection->tx_buffer = BoltBuffer_create(INITIAL_TX_BUFFER_SIZE);
-    connection->rx_buffer = BoltBuffer_create(INITIAL_RX_BUFFER_SIZE);
+    connection->tx_buffer = BoltBuffer_create(allocator, INITIAL_TX_BUFFER_SIZE);
+    connection->rx_buffer = BoltBuffer_create(allocator, INITIAL_RX_BUFFER_SIZE);
 
     connection->status = BOLT_DISCONNECTED;
     connection->error = BOLT_NO_ERROR;
 
+    connection->reader = NULL;
+
     return connection;
 }
 
@@ -259,6 +270,7 @@ void _destroy(struct BoltConnection* connection)
     switch(connection->protocol_version)
     {
         case 1:
+        case 2:
             BoltProtocolV1_destroy_state(connection->protocol_state);
             break;
         default:
@@ -266,7 +278,7 @@ void _destroy(struct BoltConnection* connection)
     }
     BoltBuffer_destroy(connection->rx_buffer);
     BoltBuffer_destroy(connection->tx_buffer);
-    BoltMem_deallocate(connection, sizeof(struct BoltConnection));
+    BoltAllocator_deallocate(connection->allocator, connection, sizeof(struct BoltConnection));
 }
 
 int _transmit_b(struct BoltConnection* connection, const char* data, int size)
@@ -284,12 +296,12 @@ int _transmit_b(struct BoltConnection* connection, const char* data, int size)
         {
             case BOLT_INSECURE_SOCKET:
             {
-                sent = TRANSMIT(connection->socket, data, size, 0);
+                sent = TRANSMIT(connection->socket, data + total_sent, remaining, 0);
                 break;
             }
             case BOLT_SECURE_SOCKET:
             {
-                sent = TRANSMIT_S(connection->ssl, data, size, 0);
+                sent = TRANSMIT_S(connection->ssl, data + total_sent, remaining, 0);
                 break;
             }
         }
@@ -325,7 +337,8 @@ int _transmit_b(struct BoltConnection* connection, const char* data, int size)
  * @param buffer
  * @param min_size
  * @param max_size
- * @return
+ * @return the number of bytes received, or -1 if fewer than min_size
+ *         bytes could be received
  */
 int _receive_b(struct BoltConnection* connection, char* buffer, int min_size, int max_size)
 {
@@ -356,7 +369,7 @@ int _receive_b(struct BoltConnection* connection, char* buffer, int min_size, in
         {
             BoltLog_info("bolt: Detected end of transmission");
             _set_status(connection, BOLT_DISCONNECTED, BOLT_END_OF_TRANSMISSION);
-            break;
+            return -1;
         }
         else
         {
@@ -424,7 +437,10 @@ int _handshake_b(struct BoltConnection* connection, int32_t _1, int32_t _2, int3
     switch(connection->protocol_version)
     {
         case 1:
-            connection->protocol_state = BoltProtocolV1_create_state();
+        case 2:
+            // Bolt v2 only adds structures to v1 (of which points are
+            // supported here), so both are served by the same code
+            connection->protocol_state = BoltProtocolV1_create_state(connection->allocator);
             return 0;
         default:
             _close_b(connection);
@@ -549,7 +565,13 @@ void BoltAddress_write(struct BoltAddress * address, FILE * file)
 
 struct BoltConnection* BoltConnection_open_b(enum BoltTransport transport, struct BoltAddress* address)
 {
-    struct BoltConnection* connection = _create(transport);
+    return BoltConnection_open_with_allocator_b(transport, address, NULL);
+}
+
+struct BoltConnection* BoltConnection_open_with_allocator_b(enum BoltTransport transport, struct BoltAddress* address,
+                                                            struct BoltAllocator* allocator)
+{
+    struct BoltConnection* connection = _create(transport, allocator);
     if (address->n_resolved_hosts > 0)
     {
         for (size_t i = 0; i < address->n_resolved_hosts; i++)
@@ -578,12 +600,12 @@ struct BoltConnection* BoltConnection_open_b(enum BoltTransport transport, struc
                     int secured = _secure_b(connection);
                     if (secured == 0)
                     {
-                        _handshake_b(connection, 1, 0, 0, 0);
+                        _handshake_b(connection, 2, 1, 0, 0);
                     }
                 }
                 else
                 {
-                    _handshake_b(connection, 1, 0, 0, 0);
+                    _handshake_b(connection, 2, 1, 0, 0);
                 }
                 break;
             }
@@ -598,6 +620,11 @@ struct BoltConnection* BoltConnection_open_b(enum BoltTransport transport, struc
 
 void BoltConnection_close_b(struct BoltConnection* connection)
 {
+    if (connection->reader != NULL)
+    {
+        BoltReader_stop(connection->reader);
+        connection->reader = NULL;
+    }
     if (connection->status != BOLT_DISCONNECTED)
     {
         _close_b(connection);
@@ -605,16 +632,115 @@ void BoltConnection_close_b(struct BoltConnection* connection)
     _destroy(connection);
 }
 
+/**
+ * Transmit a run of data held in separate places, as if contiguous.
+ *
+ * @param connection
+ * @param vectors the places, which are adjusted to reflect progress
+ * @param n the number of places
+ * @return 0 on success, -1 on error
+ */
+int _transmit_vectors_b(struct BoltConnection* connection, struct iovec* vectors, int n)
+{
+    if (connection->transport == BOLT_SECURE_SOCKET)
+    {
+        // Data is copied into TLS records regardless, so there is
+        // nothing to gain from gathering it
+        for (int i = 0; i < n; i++)
+        {
+            try(_transmit_b(connection, vectors[i].iov_base, (int)(vectors[i].iov_len)));
+        }
+        return 0;
+    }
+    while (n > 0)
+    {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = vectors;
+        message.msg_iovlen = (size_t)(n);
+        ssize_t sent = TRANSMIT_V(connection->socket, &message, 0);
+        if (sent < 0)
+        {
+            _set_status(connection, BOLT_DEFUNCT, errno);
+            BoltLog_error("bolt: Socket error %d on transmit", connection->error);
+            return -1;
+        }
+        while (n > 0 && (size_t)(sent) >= vectors->iov_len)
+        {
+            sent -= vectors->iov_len;
+            vectors += 1;
+            n -= 1;
+        }
+        if (n > 0)
+        {
+            vectors->iov_base = (char*)(vectors->iov_base) + sent;
+            vectors->iov_len -= (size_t)(sent);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Transmit the connection buffer, gathering in the borrowed data queued
+ * between its bytes as it goes.
+ *
+ * @param connection
+ * @param queued
+ * @return 0 on success, -1 on error
+ */
+int _transmit_gathered_b(struct BoltConnection* connection, struct _gather_list* queued)
+{
+    struct BoltBuffer* buffer = connection->tx_buffer;
+    struct iovec vectors[MAX_TRANSMIT_VECTORS];
+    int32_t next = 0;
+    int64_t total_size = 0;
+    while (buffer->cursor < buffer->extent || next < queued->size)
+    {
+        int n = 0;
+        while (n < MAX_TRANSMIT_VECTORS && (buffer->cursor < buffer->extent || next < queued->size))
+        {
+            if (next < queued->size && queued->segments[next].offset == buffer->cursor)
+            {
+                vectors[n].iov_base = (void*)(queued->segments[next].data);
+                vectors[n].iov_len = (size_t)(queued->segments[next].size);
+                next += 1;
+            }
+            else
+            {
+                // The cursor is moved by hand, since unloading
+                // everything would reset it and so the offsets
+                int limit = next < queued->size ? queued->segments[next].offset : buffer->extent;
+                vectors[n].iov_base = &buffer->data[buffer->cursor];
+                vectors[n].iov_len = (size_t)(limit - buffer->cursor);
+                buffer->cursor = limit;
+            }
+            total_size += (int64_t)(vectors[n].iov_len);
+            n += 1;
+        }
+        try(_transmit_vectors_b(connection, &vectors[0], n));
+    }
+    BoltLog_info("bolt: Sent %lld bytes in %d pieces", (long long)(total_size), queued->size);
+    return 0;
+}
+
 int BoltConnection_send_b(struct BoltConnection * connection)
 {
-    int size = BoltBuffer_unloadable(connection->tx_buffer);
-    int transmitted = _transmit_b(connection, BoltBuffer_unload_target(connection->tx_buffer, size), size);
-    if (transmitted == -1)
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state != NULL && state->queued.size > 0)
     {
-        return -1;
+        try(_transmit_gathered_b(connection, &state->queued));
+        state->queued.size = 0;
+    }
+    else
+    {
+        int size = BoltBuffer_unloadable(connection->tx_buffer);
+        int transmitted = _transmit_b(connection, BoltBuffer_unload_target(connection->tx_buffer, size), size);
+        if (transmitted == -1)
+        {
+            return -1;
+        }
     }
     BoltBuffer_compact(connection->tx_buffer);
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     if (state == NULL)
     {
         return 0;
@@ -623,45 +749,116 @@ int BoltConnection_send_b(struct BoltConnection * connection)
     return state->next_request_id - 1;
 }
 
+int _fetch_message_b(struct BoltConnection* connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    char header[2];
+    int fetched = _fetch_b(connection, &header[0], 2);
+    if (fetched == -1)
+    {
+        BoltLog_error("Could not fetch chunk header");
+        return -1;
+    }
+    uint16_t chunk_size = char_to_uint16be(header);
+    BoltBuffer_compact(state->rx_buffer);
+    if (state->stream_sink != NULL)
+    {
+        BoltProtocolV1_begin_stream(connection);
+    }
+    while (chunk_size != 0)
+    {
+        if (state->stream_sink != NULL)
+        {
+            // received into scratch space, so that large values can
+            // be passed on to the sink rather than kept
+            fetched = _fetch_b(connection, state->stream_chunk, chunk_size);
+            if (fetched != -1)
+            {
+                BoltProtocolV1_stream_chunk(connection, state->stream_chunk, chunk_size);
+            }
+        }
+        else
+        {
+            fetched = _fetch_b(connection, BoltBuffer_load_target(state->rx_buffer, chunk_size), chunk_size);
+        }
+        if (fetched == -1)
+        {
+            BoltLog_error("Could not fetch chunk data");
+            return -1;
+        }
+        fetched = _fetch_b(connection, &header[0], 2);
+        if (fetched == -1)
+        {
+            BoltLog_error("Could not fetch chunk header");
+            return -1;
+        }
+        chunk_size = char_to_uint16be(header);
+    }
+    if (state->stream_sink != NULL)
+    {
+        return BoltProtocolV1_end_stream(connection);
+    }
+    return 0;
+}
+
+/**
+ * Act on the summary received for the request awaited.
+ *
+ * @param connection
+ * @param summary
+ * @param response_id
+ * @param records the number of records received up to the summary
+ * @return the number of records, or -1 if the request failed
+ */
+int _summarise(struct BoltConnection* connection, struct BoltValue* summary, int response_id, int records)
+{
+    int16_t code = BoltSummary_code(summary);
+    switch (code)
+    {
+        case 0x70:  // SUCCESS
+            BoltLog_info("bolt: Request #%d succeeded", response_id);
+            _set_status(connection, BOLT_READY, BOLT_NO_ERROR);
+            return records;
+        case 0x7E:  // IGNORED
+            BoltLog_info("bolt: Request #%d ignored", response_id);
+            return records;
+        case 0x7F:  // FAILURE
+            BoltLog_error("bolt: Request %d failed", response_id);
+            _set_status(connection, BOLT_FAILED, BOLT_UNKNOWN_ERROR);   // TODO more specific error
+            return -1;
+        default:
+            BoltLog_error("bolt: Protocol violation (received summary code %d)", code);
+            _set_status(connection, BOLT_DEFUNCT, BOLT_PROTOCOL_VIOLATION);
+            return -1;
+    }
+}
+
 int BoltConnection_fetch_b(struct BoltConnection * connection, int request_id)
 {
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
             int records = 0;
             struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+            struct BoltValue* fetched = NULL;
             int response_id;
             do
             {
-                char header[2];
-                int fetched = _fetch_b(connection, &header[0], 2);
-                if (fetched == -1)
+                if (connection->reader != NULL)
                 {
-                    BoltLog_error("Could not fetch chunk header");
-                    return -1;
+                    // already received and decoded by the reader thread
+                    try(BoltReader_next_b(connection->reader, &fetched));
                 }
-                uint16_t chunk_size = char_to_uint16be(header);
-                BoltBuffer_compact(state->rx_buffer);
-                while (chunk_size != 0)
+                else
                 {
-                    fetched = _fetch_b(connection, BoltBuffer_load_target(state->rx_buffer, chunk_size), chunk_size);
-                    if (fetched == -1)
-                    {
-                        BoltLog_error("Could not fetch chunk data");
-                        return -1;
-                    }
-                    fetched = _fetch_b(connection, &header[0], 2);
-                    if (fetched == -1)
-                    {
-                        BoltLog_error("Could not fetch chunk header");
-                        return -1;
-                    }
-                    chunk_size = char_to_uint16be(header);
+                    try(_fetch_message_b(connection));
+                    BoltProtocolV1_unload(connection);
+                    fetched = state->fetched;
                 }
                 response_id = state->response_counter;
-                BoltProtocolV1_unload(connection);
-                if (BoltValue_type(state->fetched) == BOLT_SUMMARY)
+                if (BoltValue_type(fetched) == BOLT_SUMMARY)
                 {
                     state->response_counter += 1;
                 }
@@ -670,27 +867,9 @@ int BoltConnection_fetch_b(struct BoltConnection * connection, int request_id)
                     records += 1;
                 }
             } while (response_id != request_id);
-            if (BoltValue_type(state->fetched) == BOLT_SUMMARY)
+            if (BoltValue_type(fetched) == BOLT_SUMMARY)
             {
-                int16_t code = BoltSummary_code(state->fetched);
-                switch (code)
-                {
-                    case 0x70:  // SUCCESS
-                        BoltLog_info("bolt: Request #%d succeeded", response_id);
-                        _set_status(connection, BOLT_READY, BOLT_NO_ERROR);
-                        return records;
-                    case 0x7E:  // IGNORED
-                        BoltLog_info("bolt: Request #%d ignored", response_id);
-                        return records;
-                    case 0x7F:  // FAILURE
-                        BoltLog_error("bolt: Request %d failed", response_id);
-                        _set_status(connection, BOLT_FAILED, BOLT_UNKNOWN_ERROR);   // TODO more specific error
-                        return -1;
-                    default:
-                        BoltLog_error("bolt: Protocol violation (received summary code %d)", code);
-                        _set_status(connection, BOLT_DEFUNCT, BOLT_PROTOCOL_VIOLATION);
-                        return -1;
-                }
+                return _summarise(connection, fetched, response_id, records);
             }
             return records;
         }
@@ -702,6 +881,52 @@ int BoltConnection_fetch_b(struct BoltConnection * connection, int request_id)
     }
 }
 
+int BoltConnection_fetch_events_b(struct BoltConnection * connection, int request_id,
+                                  const struct BoltEventHandler * handler, void * context)
+{
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+        {
+            if (connection->reader != NULL)
+            {
+                return -1;
+            }
+            int records = 0;
+            struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+            int response_id;
+            do
+            {
+                try(_fetch_message_b(connection));
+                response_id = state->response_counter;
+                if (response_id == request_id)
+                {
+                    int delivered = BoltProtocolV1_unload_events(connection, handler, context);
+                    if (delivered != 0)
+                    {
+                        return delivered == -1 ? -1 : records + 1;
+                    }
+                }
+                // Anything else, including records for earlier requests,
+                // is unloaded and dealt with as usual.
+                BoltProtocolV1_unload(connection);
+                if (BoltValue_type(state->fetched) == BOLT_SUMMARY)
+                {
+                    state->response_counter += 1;
+                }
+                else
+                {
+                    records += 1;
+                }
+            } while (response_id != request_id);
+            return _summarise(connection, state->fetched, response_id, records);
+        }
+        default:
+            return -1;
+    }
+}
+
 int BoltConnection_fetch_summary_b(struct BoltConnection * connection, int request_id)
 {
     int records = 0;
@@ -724,7 +949,12 @@ struct BoltValue* BoltConnection_fetched(struct BoltConnection * connection)
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
+            if (connection->reader != NULL)
+            {
+                return BoltReader_fetched(connection->reader);
+            }
             struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
             return state->fetched;
         }
@@ -733,12 +963,38 @@ struct BoltValue* BoltConnection_fetched(struct BoltConnection * connection)
     }
 }
 
+struct BoltValue* BoltConnection_take_fetched(struct BoltConnection * connection)
+{
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+        {
+            struct BoltValue* taken = BoltValue_create();
+            struct BoltValue* fetched = BoltConnection_fetched(connection);
+            struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+            struct BoltArena* arena = state->fetched_arena;
+            if (connection->reader == NULL && arena != NULL && BoltArena_adopt(arena, fetched) == 0)
+            {
+                // The fetched value now owns the arena, so the next fetch
+                // needs one of its own
+                state->fetched_arena = BoltArena_create(arena->allocator, arena->chunk_size);
+            }
+            BoltValue_move(fetched, taken);
+            return taken;
+        }
+        default:
+            return NULL;
+    }
+}
+
 int BoltConnection_init_b(struct BoltConnection* connection, const char* user_agent, const char* user, const char* password)
 {
     BoltLog_info("bolt: Initialising connection for user '%s'", user);
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
             struct BoltValue* init = BoltValue_create();
             BoltProtocolV1_compile_INIT(init, user_agent, user, password);
@@ -770,6 +1026,82 @@ int BoltConnection_init_b(struct BoltConnection* connection, const char* user_ag
     }
 }
 
+int BoltConnection_start_reader(struct BoltConnection * connection, int queue_size, int n_decoders)
+{
+    if (connection->reader != NULL || connection->transport != BOLT_INSECURE_SOCKET)
+    {
+        return -1;
+    }
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+        {
+            connection->reader = BoltReader_start(connection, queue_size, n_decoders);
+            return connection->reader == NULL ? -1 : 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+int BoltConnection_set_view_threshold(struct BoltConnection * connection, int32_t size)
+{
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+        {
+            if (connection->reader != NULL)
+            {
+                return -1;
+            }
+            struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+            state->view_threshold = size < 0 ? -1 : size;
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+int BoltConnection_set_entity_sharing(struct BoltConnection * connection, int enabled)
+{
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+        {
+            if (connection->reader != NULL)
+            {
+                return -1;
+            }
+            return BoltProtocolV1_set_entity_sharing(connection, enabled);
+        }
+        default:
+            return -1;
+    }
+}
+
+int BoltConnection_set_stream_sink(struct BoltConnection * connection, int32_t threshold,
+                                   const struct BoltStreamSink * sink, void * context)
+{
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+        {
+            if (connection->reader != NULL)
+            {
+                return -1;
+            }
+            return BoltProtocolV1_set_stream_sink(connection, threshold, sink, context);
+        }
+        default:
+            return -1;
+    }
+}
+
 int BoltConnection_set_cypher_template(struct BoltConnection * connection, const char * statement, size_t size)
 {
     if (size <= INT32_MAX)
@@ -805,6 +1137,7 @@ int BoltConnection_load_begin_request(struct BoltConnection * connection)
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
             struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
             BoltProtocolV1_load(connection, state->begin.request);
@@ -820,6 +1153,7 @@ int BoltConnection_load_commit_request(struct BoltConnection * connection)
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
             struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
             BoltProtocolV1_load(connection, state->commit.request);
@@ -835,6 +1169,7 @@ int BoltConnection_load_rollback_request(struct BoltConnection * connection)
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
             struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
             BoltProtocolV1_load(connection, state->rollback.request);
@@ -850,6 +1185,7 @@ int BoltConnection_load_run_request(struct BoltConnection * connection)
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
         {
             struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
             return BoltProtocolV1_load(connection, state->run.request);
@@ -859,11 +1195,50 @@ int BoltConnection_load_run_request(struct BoltConnection * connection)
     }
 }
 
+struct BoltPreparedStatement* BoltConnection_prepare(struct BoltConnection * connection, const char * statement,
+                                                     size_t size, int32_t n_parameters)
+{
+    if (connection == NULL || statement == NULL || connection->protocol_state == NULL ||
+        connection->status == BOLT_DEFUNCT)
+    {
+        return NULL;
+    }
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+            if (size <= INT32_MAX)
+            {
+                return BoltProtocolV1_prepare(connection, statement, (int32_t)(size), n_parameters);
+            }
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+int BoltConnection_load_prepared_run_request(struct BoltConnection * connection, struct BoltPreparedStatement * prepared)
+{
+    if (prepared == NULL)
+    {
+        return -1;
+    }
+    switch (connection->protocol_version)
+    {
+        case 1:
+        case 2:
+            return BoltProtocolV1_load_prepared(connection, prepared);
+        default:
+            return -1;
+    }
+}
+
 int BoltConnection_load_discard_request(struct BoltConnection * connection, int32_t n)
 {
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
             if (n >= 0)
             {
                 return -1;
@@ -883,6 +1258,7 @@ int BoltConnection_load_pull_request(struct BoltConnection * connection, int32_t
     switch (connection->protocol_version)
     {
         case 1:
+        case 2:
             if (n >= 0)
             {
                 return -1;
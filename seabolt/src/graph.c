@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <math.h>
+#include <memory.h>
+#include "graph.h"
+#include "idmap.h"
+#include "mem.h"
+
+
+#define INITIAL_CAPACITY 64
+
+
+struct BoltGraphColumn
+{
+    char* key;
+    int32_t key_size;
+    /// Value for each vertex or edge, in the order first seen
+    double* values;
+    /// Value for each edge, as last built
+    double* built_values;
+};
+
+struct BoltGraphBuilder
+{
+    struct BoltTape* tape;
+    struct BoltPathView* path;
+
+    struct BoltIdMap* vertex_map;
+    int32_t n_vertices;
+    int32_t vertex_capacity;
+    int64_t* vertex_ids;
+    /// Whether each vertex has been seen as a node, or only as the end of an edge
+    char* described;
+    int n_vertex_columns;
+    struct BoltGraphColumn vertex_columns[BOLT_GRAPH_MAX_COLUMNS];
+
+    struct BoltIdMap* edge_map;
+    int32_t n_edges;
+    int32_t edge_capacity;
+    int64_t* edge_ids;
+    int32_t* sources;
+    int32_t* targets;
+    int n_edge_columns;
+    struct BoltGraphColumn edge_columns[BOLT_GRAPH_MAX_COLUMNS];
+
+    int32_t n_built_vertices;
+    int32_t n_built_edges;
+    int32_t* built_offsets;
+    int32_t* built_targets;
+    int64_t* built_edge_ids;
+};
+
+
+struct BoltGraphBuilder* BoltGraphBuilder_create()
+{
+    struct BoltGraphBuilder* builder = BoltMem_allocate(sizeof(struct BoltGraphBuilder));
+    memset(builder, 0, sizeof(struct BoltGraphBuilder));
+    builder->tape = BoltTape_create();
+    builder->path = BoltPathView_create();
+    builder->vertex_map = BoltIdMap_create(NULL);
+    builder->edge_map = BoltIdMap_create(NULL);
+    return builder;
+}
+
+static void _release_built(struct BoltGraphBuilder* builder)
+{
+    BoltMem_deallocate(builder->built_offsets, sizeof_n(int32_t, builder->n_built_vertices + 1));
+    BoltMem_deallocate(builder->built_targets, sizeof_n(int32_t, builder->n_built_edges));
+    BoltMem_deallocate(builder->built_edge_ids, sizeof_n(int64_t, builder->n_built_edges));
+    for (int i = 0; i < builder->n_edge_columns; i++)
+    {
+        struct BoltGraphColumn* column = &builder->edge_columns[i];
+        BoltMem_deallocate(column->built_values, sizeof_n(double, builder->n_built_edges));
+        column->built_values = NULL;
+    }
+    builder->built_offsets = NULL;
+    builder->built_targets = NULL;
+    builder->built_edge_ids = NULL;
+    builder->n_built_vertices = 0;
+    builder->n_built_edges = 0;
+}
+
+static void _destroy_columns(struct BoltGraphColumn* columns, int n_columns, int32_t capacity)
+{
+    for (int i = 0; i < n_columns; i++)
+    {
+        BoltMem_deallocate(columns[i].key, (size_t)(columns[i].key_size));
+        BoltMem_deallocate(columns[i].values, sizeof_n(double, capacity));
+    }
+}
+
+void BoltGraphBuilder_destroy(struct BoltGraphBuilder* builder)
+{
+    _release_built(builder);
+    _destroy_columns(builder->edge_columns, builder->n_edge_columns, builder->edge_capacity);
+    _destroy_columns(builder->vertex_columns, builder->n_vertex_columns, builder->vertex_capacity);
+    BoltMem_deallocate(builder->targets, sizeof_n(int32_t, builder->edge_capacity));
+    BoltMem_deallocate(builder->sources, sizeof_n(int32_t, builder->edge_capacity));
+    BoltMem_deallocate(builder->edge_ids, sizeof_n(int64_t, builder->edge_capacity));
+    BoltMem_deallocate(builder->described, (size_t)(builder->vertex_capacity));
+    BoltMem_deallocate(builder->vertex_ids, sizeof_n(int64_t, builder->vertex_capacity));
+    BoltIdMap_destroy(builder->edge_map);
+    BoltIdMap_destroy(builder->vertex_map);
+    BoltPathView_destroy(builder->path);
+    BoltTape_destroy(builder->tape);
+    BoltMem_deallocate(builder, sizeof(struct BoltGraphBuilder));
+}
+
+static int _add_column(struct BoltGraphBuilder* builder, struct BoltGraphColumn* columns, int* n_columns,
+                       int32_t capacity, const char* key, int32_t key_size)
+{
+    if (builder->n_vertices > 0 || builder->n_edges > 0 || *n_columns == BOLT_GRAPH_MAX_COLUMNS || key_size < 0) return -1;
+    struct BoltGraphColumn* column = &columns[*n_columns];
+    column->key = BoltMem_allocate((size_t)(key_size));
+    memcpy(column->key, key, (size_t)(key_size));
+    column->key_size = key_size;
+    column->values = BoltMem_allocate(sizeof_n(double, capacity));
+    column->built_values = NULL;
+    *n_columns += 1;
+    return *n_columns - 1;
+}
+
+int BoltGraphBuilder_add_vertex_column(struct BoltGraphBuilder* builder, const char* key, int32_t key_size)
+{
+    return _add_column(builder, builder->vertex_columns, &builder->n_vertex_columns, builder->vertex_capacity,
+                       key, key_size);
+}
+
+int BoltGraphBuilder_add_edge_column(struct BoltGraphBuilder* builder, const char* key, int32_t key_size)
+{
+    return _add_column(builder, builder->edge_columns, &builder->n_edge_columns, builder->edge_capacity,
+                       key, key_size);
+}
+
+static void* _grow_array(void* array, int32_t capacity, int32_t new_capacity, size_t unit)
+{
+    return BoltMem_reallocate(array, (size_t)(capacity) * unit, (size_t)(new_capacity) * unit);
+}
+
+/**
+ * Read a numeric property from a dictionary on a tape.
+ */
+static double _property(const struct BoltTape* tape, int32_t dictionary, const struct BoltGraphColumn* column)
+{
+    int32_t entry = dictionary + 1;
+    for (int32_t i = 0; i < BoltTape_size(tape, dictionary); i++)
+    {
+        int32_t value = entry + 1;
+        if (BoltTape_size(tape, entry) == column->key_size &&
+            memcmp(BoltTape_data(tape, entry), column->key, (size_t)(column->key_size)) == 0)
+        {
+            switch (BoltTape_type(tape, value))
+            {
+                case BOLT_INT64:
+                    return (double)(BoltTape_int64(tape, value));
+                case BOLT_FLOAT64:
+                    return BoltTape_float64(tape, value);
+                default:
+                    return NAN;
+            }
+        }
+        entry = BoltTape_next(tape, value);
+    }
+    return NAN;
+}
+
+static int32_t _add_vertex(struct BoltGraphBuilder* builder, int64_t id)
+{
+    int32_t vertex = BoltIdMap_add(builder->vertex_map, id, builder->n_vertices);
+    if (vertex < builder->n_vertices) return vertex;
+    if (builder->n_vertices == builder->vertex_capacity)
+    {
+        int32_t capacity = builder->vertex_capacity == 0 ? INITIAL_CAPACITY : 2 * builder->vertex_capacity;
+        builder->vertex_ids = _grow_array(builder->vertex_ids, builder->vertex_capacity, capacity, sizeof(int64_t));
+        builder->described = _grow_array(builder->described, builder->vertex_capacity, capacity, 1);
+        for (int i = 0; i < builder->n_vertex_columns; i++)
+        {
+            struct BoltGraphColumn* column = &builder->vertex_columns[i];
+            column->values = _grow_array(column->values, builder->vertex_capacity, capacity, sizeof(double));
+        }
+        builder->vertex_capacity = capacity;
+    }
+    builder->vertex_ids[vertex] = id;
+    builder->described[vertex] = 0;
+    for (int i = 0; i < builder->n_vertex_columns; i++)
+    {
+        builder->vertex_columns[i].values[vertex] = NAN;
+    }
+    builder->n_vertices += 1;
+    return vertex;
+}
+
+static void _add_node(struct BoltGraphBuilder* builder, const struct BoltTape* tape, const struct BoltNodeView* node)
+{
+    int32_t vertex = _add_vertex(builder, node->id);
+    if (builder->described[vertex]) return;
+    builder->described[vertex] = 1;
+    for (int i = 0; i < builder->n_vertex_columns; i++)
+    {
+        struct BoltGraphColumn* column = &builder->vertex_columns[i];
+        column->values[vertex] = _property(tape, node->properties, column);
+    }
+}
+
+static void _add_relationship(struct BoltGraphBuilder* builder, const struct BoltTape* tape,
+                              const struct BoltRelationshipView* relationship)
+{
+    int32_t edge = BoltIdMap_add(builder->edge_map, relationship->id, builder->n_edges);
+    if (edge < builder->n_edges) return;
+    if (builder->n_edges == builder->edge_capacity)
+    {
+        int32_t capacity = builder->edge_capacity == 0 ? INITIAL_CAPACITY : 2 * builder->edge_capacity;
+        builder->edge_ids = _grow_array(builder->edge_ids, builder->edge_capacity, capacity, sizeof(int64_t));
+        builder->sources = _grow_array(builder->sources, builder->edge_capacity, capacity, sizeof(int32_t));
+        builder->targets = _grow_array(builder->targets, builder->edge_capacity, capacity, sizeof(int32_t));
+        for (int i = 0; i < builder->n_edge_columns; i++)
+        {
+            struct BoltGraphColumn* column = &builder->edge_columns[i];
+            column->values = _grow_array(column->values, builder->edge_capacity, capacity, sizeof(double));
+        }
+        builder->edge_capacity = capacity;
+    }
+    builder->edge_ids[edge] = relationship->id;
+    builder->sources[edge] = _add_vertex(builder, relationship->start_id);
+    builder->targets[edge] = _add_vertex(builder, relationship->end_id);
+    for (int i = 0; i < builder->n_edge_columns; i++)
+    {
+        struct BoltGraphColumn* column = &builder->edge_columns[i];
+        column->values[edge] = _property(tape, relationship->properties, column);
+    }
+    builder->n_edges += 1;
+}
+
+int BoltGraphBuilder_add(struct BoltGraphBuilder* builder, const struct BoltTape* tape, int32_t index)
+{
+    int32_t end = BoltTape_next(tape, index);
+    for (int32_t i = index; i < end;)
+    {
+        if (BoltTape_type(tape, i) != BOLT_STRUCTURE)
+        {
+            // Step into lists and dictionaries, or over anything else
+            i += 1;
+            continue;
+        }
+        switch (BoltTape_code(tape, i))
+        {
+            case 'N':
+            {
+                struct BoltNodeView node;
+                try(BoltTape_node(tape, i, &node));
+                _add_node(builder, tape, &node);
+                break;
+            }
+            case 'R':
+            {
+                struct BoltRelationshipView relationship;
+                try(BoltTape_relationship(tape, i, &relationship));
+                _add_relationship(builder, tape, &relationship);
+                break;
+            }
+            case 'P':
+            {
+                struct BoltPathView* path = builder->path;
+                try(BoltTape_path(tape, i, path));
+                for (int32_t j = 0; j < path->n_nodes; j++)
+                {
+                    _add_node(builder, tape, &path->nodes[j]);
+                }
+                for (int32_t j = 0; j < path->n_relationships; j++)
+                {
+                    // A relationship never crossed by the path has no known start or end
+                    if (path->relationships[j].start_id == -1) continue;
+                    _add_relationship(builder, tape, &path->relationships[j]);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        i = BoltTape_next(tape, i);
+    }
+    return 0;
+}
+
+int BoltGraphBuilder_fetch_b(struct BoltGraphBuilder* builder, struct BoltConnection* connection, int request_id)
+{
+    BoltTape_reset(builder->tape);
+    int status = BoltTape_fetch_b(builder->tape, connection, request_id);
+    if (status == 1)
+    {
+        try(BoltGraphBuilder_add(builder, builder->tape, 0));
+    }
+    return status;
+}
+
+void BoltGraphBuilder_build(struct BoltGraphBuilder* builder)
+{
+    _release_built(builder);
+    int32_t n_vertices = builder->n_vertices;
+    int32_t n_edges = builder->n_edges;
+    int32_t* offsets = BoltMem_allocate(sizeof_n(int32_t, n_vertices + 1));
+    memset(offsets, 0, sizeof_n(int32_t, n_vertices + 1));
+    for (int32_t i = 0; i < n_edges; i++)
+    {
+        offsets[builder->sources[i] + 1] += 1;
+    }
+    for (int32_t v = 0; v < n_vertices; v++)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+    builder->built_offsets = offsets;
+    builder->built_targets = BoltMem_allocate(sizeof_n(int32_t, n_edges));
+    builder->built_edge_ids = BoltMem_allocate(sizeof_n(int64_t, n_edges));
+    for (int i = 0; i < builder->n_edge_columns; i++)
+    {
+        builder->edge_columns[i].built_values = BoltMem_allocate(sizeof_n(double, n_edges));
+    }
+    builder->n_built_vertices = n_vertices;
+    builder->n_built_edges = n_edges;
+    // Place each edge after those of the same vertex placed before it,
+    // using the offsets as cursors and restoring them afterwards
+    for (int32_t i = 0; i < n_edges; i++)
+    {
+        int32_t position = offsets[builder->sources[i]];
+        offsets[builder->sources[i]] += 1;
+        builder->built_targets[position] = builder->targets[i];
+        builder->built_edge_ids[position] = builder->edge_ids[i];
+        for (int c = 0; c < builder->n_edge_columns; c++)
+        {
+            struct BoltGraphColumn* column = &builder->edge_columns[c];
+            column->built_values[position] = column->values[i];
+        }
+    }
+    for (int32_t v = n_vertices; v > 0; v--)
+    {
+        offsets[v] = offsets[v - 1];
+    }
+    offsets[0] = 0;
+}
+
+int32_t BoltGraphBuilder_vertex_count(const struct BoltGraphBuilder* builder)
+{
+    return builder->n_vertices;
+}
+
+int32_t BoltGraphBuilder_edge_count(const struct BoltGraphBuilder* builder)
+{
+    return builder->n_edges;
+}
+
+int32_t BoltGraphBuilder_vertex(const struct BoltGraphBuilder* builder, int64_t id)
+{
+    return BoltIdMap_get(builder->vertex_map, id);
+}
+
+const int64_t* BoltGraphBuilder_vertex_ids(const struct BoltGraphBuilder* builder)
+{
+    return builder->vertex_ids;
+}
+
+const double* BoltGraphBuilder_vertex_column(const struct BoltGraphBuilder* builder, int column)
+{
+    if (column < 0 || column >= builder->n_vertex_columns) return NULL;
+    return builder->vertex_columns[column].values;
+}
+
+const int32_t* BoltGraphBuilder_offsets(const struct BoltGraphBuilder* builder)
+{
+    return builder->built_offsets;
+}
+
+const int32_t* BoltGraphBuilder_targets(const struct BoltGraphBuilder* builder)
+{
+    return builder->built_targets;
+}
+
+const int64_t* BoltGraphBuilder_edge_ids(const struct BoltGraphBuilder* builder)
+{
+    return builder->built_edge_ids;
+}
+
+const double* BoltGraphBuilder_edge_column(const struct BoltGraphBuilder* builder, int column)
+{
+    if (column < 0 || column >= builder->n_edge_columns) return NULL;
+    return builder->edge_columns[column].built_values;
+}
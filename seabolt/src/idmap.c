@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <memory.h>
+#include "idmap.h"
+#include "mem.h"
+#include "values.h"
+
+
+#define INITIAL_CAPACITY 64
+
+
+struct BoltIdEntry
+{
+    int64_t id;
+    /// Index of the entity plus one, or zero for an empty slot
+    int32_t slot;
+};
+
+
+static struct BoltIdEntry* _create_entries(struct BoltAllocator* allocator, size_t capacity)
+{
+    size_t size = sizeof_n(struct BoltIdEntry, capacity);
+    struct BoltIdEntry* entries = BoltAllocator_allocate(allocator, size);
+    memset(entries, 0, size);
+    return entries;
+}
+
+static size_t _hash(int64_t id)
+{
+    return (size_t)(((uint64_t)(id) * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static struct BoltIdEntry* _find(struct BoltIdEntry* entries, size_t capacity, int64_t id)
+{
+    size_t mask = capacity - 1;
+    for (size_t i = _hash(id) & mask; ; i = (i + 1) & mask)
+    {
+        struct BoltIdEntry* entry = &entries[i];
+        if (entry->slot == 0 || entry->id == id)
+        {
+            return entry;
+        }
+    }
+}
+
+static void _grow(struct BoltIdMap* map)
+{
+    size_t capacity = 2 * map->capacity;
+    struct BoltIdEntry* entries = _create_entries(map->allocator, capacity);
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        struct BoltIdEntry* entry = &map->entries[i];
+        if (entry->slot != 0)
+        {
+            *_find(entries, capacity, entry->id) = *entry;
+        }
+    }
+    BoltAllocator_deallocate(map->allocator, map->entries, sizeof_n(struct BoltIdEntry, map->capacity));
+    map->entries = entries;
+    map->capacity = capacity;
+}
+
+struct BoltIdMap* BoltIdMap_create(struct BoltAllocator* allocator)
+{
+    if (allocator == NULL) allocator = BoltMem_allocator();
+    struct BoltIdMap* map = BoltAllocator_allocate(allocator, sizeof(struct BoltIdMap));
+    map->allocator = allocator;
+    map->capacity = INITIAL_CAPACITY;
+    map->entries = _create_entries(allocator, map->capacity);
+    map->count = 0;
+    return map;
+}
+
+void BoltIdMap_destroy(struct BoltIdMap* map)
+{
+    if (map == NULL) return;
+    struct BoltAllocator* allocator = map->allocator;
+    BoltAllocator_deallocate(allocator, map->entries, sizeof_n(struct BoltIdEntry, map->capacity));
+    BoltAllocator_deallocate(allocator, map, sizeof(struct BoltIdMap));
+}
+
+void BoltIdMap_clear(struct BoltIdMap* map)
+{
+    memset(map->entries, 0, sizeof_n(struct BoltIdEntry, map->capacity));
+    map->count = 0;
+}
+
+int32_t BoltIdMap_get(const struct BoltIdMap* map, int64_t id)
+{
+    return _find(map->entries, map->capacity, id)->slot - 1;
+}
+
+int32_t BoltIdMap_add(struct BoltIdMap* map, int64_t id, int32_t index)
+{
+    struct BoltIdEntry* entry = _find(map->entries, map->capacity, id);
+    if (entry->slot != 0) return entry->slot - 1;
+    // Keep the load factor at or below one half
+    if (2 * (map->count + 1) > map->capacity)
+    {
+        _grow(map);
+        entry = _find(map->entries, map->capacity, id);
+    }
+    entry->id = id;
+    entry->slot = index + 1;
+    map->count += 1;
+    return index;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_IDMAP
+#define SEABOLT_IDMAP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mem.h>
+
+
+struct BoltIdEntry;
+
+/**
+ * A map from graph entity id to a dense index, such as the position of
+ * the entity within an array of entities seen so far.
+ */
+struct BoltIdMap
+{
+    /// Allocator used for the index
+    struct BoltAllocator* allocator;
+    /// Open addressing index, of which `capacity` is always a power of two
+    struct BoltIdEntry* entries;
+    size_t capacity;
+    size_t count;
+};
+
+
+/**
+ * Create an id map.
+ *
+ * @param allocator the allocator to use, or NULL for the installed allocator
+ * @return
+ */
+struct BoltIdMap* BoltIdMap_create(struct BoltAllocator* allocator);
+
+void BoltIdMap_destroy(struct BoltIdMap* map);
+
+/**
+ * Remove every entry, keeping the capacity of the map.
+ *
+ * @param map
+ */
+void BoltIdMap_clear(struct BoltIdMap* map);
+
+/**
+ * Look up an id.
+ *
+ * @param map
+ * @param id
+ * @return the index of the id, or -1 if not present
+ */
+int32_t BoltIdMap_get(const struct BoltIdMap* map, int64_t id);
+
+/**
+ * Look up an id, adding it with the given index if not already present.
+ *
+ * @param map
+ * @param id
+ * @param index the index to add (zero or more)
+ * @return the index of the id, which is `index` if it was added
+ */
+int32_t BoltIdMap_add(struct BoltIdMap* map, int64_t id, int32_t index);
+
+
+#endif // SEABOLT_IDMAP
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <memory.h>
+#include "arena.h"
+#include "intern.h"
+#include "mem.h"
+
+
+#define INITIAL_CAPACITY 64
+#define INTERN_MAX_SIZE 255
+#define INTERN_MAX_COUNT 4096
+#define STORAGE_CHUNK_SIZE 4096
+
+
+struct BoltInternEntry
+{
+    uint32_t hash;
+    int32_t size;
+    const char* string;
+};
+
+
+static struct BoltInternEntry* _create_entries(struct BoltAllocator* allocator, size_t capacity)
+{
+    size_t size = sizeof_n(struct BoltInternEntry, capacity);
+    struct BoltInternEntry* entries = BoltAllocator_allocate(allocator, size);
+    memset(entries, 0, size);
+    return entries;
+}
+
+static struct BoltInternEntry* _find(struct BoltInternEntry* entries, size_t capacity, const char* string, int32_t size, uint32_t hash)
+{
+    size_t mask = capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        struct BoltInternEntry* entry = &entries[i];
+        if (entry->string == NULL ||
+            (entry->hash == hash && entry->size == size && memcmp(entry->string, string, (size_t)(size)) == 0))
+        {
+            return entry;
+        }
+    }
+}
+
+static void _grow(struct BoltInternTable* table)
+{
+    size_t capacity = 2 * table->capacity;
+    struct BoltInternEntry* entries = _create_entries(table->allocator, capacity);
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        struct BoltInternEntry* entry = &table->entries[i];
+        if (entry->string != NULL)
+        {
+            *_find(entries, capacity, entry->string, entry->size, entry->hash) = *entry;
+        }
+    }
+    BoltAllocator_deallocate(table->allocator, table->entries, sizeof_n(struct BoltInternEntry, table->capacity));
+    table->entries = entries;
+    table->capacity = capacity;
+}
+
+struct BoltInternTable* BoltInternTable_create(struct BoltAllocator* allocator)
+{
+    if (allocator == NULL) allocator = BoltMem_allocator();
+    struct BoltInternTable* table = BoltAllocator_allocate(allocator, sizeof(struct BoltInternTable));
+    table->allocator = allocator;
+    table->storage = BoltArena_create(allocator, STORAGE_CHUNK_SIZE);
+    table->capacity = INITIAL_CAPACITY;
+    table->entries = _create_entries(allocator, table->capacity);
+    table->count = 0;
+    return table;
+}
+
+void BoltInternTable_destroy(struct BoltInternTable* table)
+{
+    if (table == NULL) return;
+    struct BoltAllocator* allocator = table->allocator;
+    BoltAllocator_deallocate(allocator, table->entries, sizeof_n(struct BoltInternEntry, table->capacity));
+    BoltArena_destroy(table->storage);
+    BoltAllocator_deallocate(allocator, table, sizeof(struct BoltInternTable));
+}
+
+const char* BoltInternTable_intern(struct BoltInternTable* table, const char* string, int32_t size, uint32_t hash)
+{
+    if (size < 0 || size > INTERN_MAX_SIZE) return NULL;
+    struct BoltInternEntry* entry = _find(table->entries, table->capacity, string, size, hash);
+    if (entry->string != NULL) return entry->string;
+    if (table->count == INTERN_MAX_COUNT) return NULL;
+    // Keep the load factor at or below one half
+    if (2 * (table->count + 1) > table->capacity)
+    {
+        _grow(table);
+        entry = _find(table->entries, table->capacity, string, size, hash);
+    }
+    char* storage = BoltArena_allocate(table->storage, (size_t)(size) + 1);
+    memcpy(storage, string, (size_t)(size));
+    storage[size] = '\0';
+    entry->hash = hash;
+    entry->size = size;
+    entry->string = storage;
+    table->count += 1;
+    return storage;
+}
+
+int BoltInternTable_to_String8(struct BoltInternTable* table, struct BoltValue* value, const char* string, int32_t size)
+{
+    if (table == NULL) return -1;
+    uint32_t hash = BoltString8_hash_of(string, size);
+    const char* interned = BoltInternTable_intern(table, string, size, hash);
+    if (interned == NULL) return -1;
+    BoltValue_to_Null(value);
+    value->data.extended.as_ptr = (void*)(interned);
+    value->data.as_uint32[2] = hash;
+    value->data_size = 0;
+    value->flags |= BOLT_VALUE_INTERNED;
+    _set_type(value, BOLT_STRING8, size);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_INTERN
+#define SEABOLT_INTERN
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mem.h>
+#include <values.h>
+
+
+struct BoltInternEntry;
+
+/**
+ * A table of immutable strings, shared between all values that refer
+ * to them.
+ *
+ * Received data tends to repeat the same handful of dictionary keys and
+ * node labels over and over again. Interning these means each distinct
+ * string is stored (and hashed) once per connection, and subsequent
+ * occurrences cost neither a copy nor an allocation.
+ *
+ * Interned storage is never released until the table is destroyed, so
+ * the table stops accepting new strings once it is full.
+ */
+struct BoltInternTable
+{
+    /// Allocator used for the index and string storage
+    struct BoltAllocator* allocator;
+    /// Storage for the interned strings themselves
+    struct BoltArena* storage;
+    /// Open addressing index, of which `capacity` is always a power of two
+    struct BoltInternEntry* entries;
+    size_t capacity;
+    size_t count;
+};
+
+
+/**
+ * Create an intern table.
+ *
+ * @param allocator the allocator to use, or NULL for the installed allocator
+ * @return
+ */
+struct BoltInternTable* BoltInternTable_create(struct BoltAllocator* allocator);
+
+void BoltInternTable_destroy(struct BoltInternTable* table);
+
+/**
+ * Look up a string, adding it to the table if not already present.
+ *
+ * @param table
+ * @param string
+ * @param size
+ * @param hash the hash of the string, as returned by `BoltString8_hash_of`
+ * @return shared storage for the string, or NULL if it cannot be interned
+ */
+const char* BoltInternTable_intern(struct BoltInternTable* table, const char* string, int32_t size, uint32_t hash);
+
+/**
+ * Set a value to an interned UTF-8 string.
+ *
+ * The value refers to the shared storage and carries a copy of the
+ * string hash. It must be treated as read-only and must not outlive
+ * the table.
+ *
+ * @param table the intern table, or NULL
+ * @param value
+ * @param string
+ * @param size
+ * @return 0 on success, -1 if the string could not be interned (in
+ *         which case the value is left unchanged)
+ */
+int BoltInternTable_to_String8(struct BoltInternTable* table, struct BoltValue* value, const char* string, int32_t size);
+
+
+#endif // SEABOLT_INTERN
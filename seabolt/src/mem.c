@@ -21,9 +21,15 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <malloc.h>
+#include <pthread.h>
 
 #include "mem.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEABOLT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
 
 void* memcpy_r(void* dest, const void* src, size_t n)
 {
@@ -37,6 +43,181 @@ void* memcpy_r(void* dest, const void* src, size_t n)
 }
 
 
+#if SEABOLT_LITTLE_ENDIAN
+
+static void _swap16_scalar(char* dest, const char* src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy_be16(&dest[2 * i], &src[2 * i]);
+    }
+}
+
+static void _swap32_scalar(char* dest, const char* src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy_be32(&dest[4 * i], &src[4 * i]);
+    }
+}
+
+static void _swap64_scalar(char* dest, const char* src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy_be64(&dest[8 * i], &src[8 * i]);
+    }
+}
+
+#ifdef SEABOLT_X86_KERNELS
+
+// Shuffle masks reversing the bytes of each 2, 4 or 8-byte lane. The
+// AVX2 shuffle operates on each 128-bit half independently, so the same
+// 16-byte pattern is repeated for the upper half.
+#define SWAP16_MASK 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+#define SWAP32_MASK 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define SWAP64_MASK 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+
+__attribute__((target("ssse3")))
+static size_t _swap_ssse3(char* dest, const char* src, size_t size, __m128i mask)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(&src[i]));
+        _mm_storeu_si128((__m128i*)(&dest[i]), _mm_shuffle_epi8(x, mask));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t _swap_avx2(char* dest, const char* src, size_t size, __m256i mask)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(&src[i]));
+        _mm256_storeu_si256((__m256i*)(&dest[i]), _mm256_shuffle_epi8(x, mask));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static void _swap16_ssse3(char* dest, const char* src, size_t n)
+{
+    size_t done = _swap_ssse3(dest, src, 2 * n, _mm_setr_epi8(SWAP16_MASK));
+    _swap16_scalar(&dest[done], &src[done], n - done / 2);
+}
+
+__attribute__((target("ssse3")))
+static void _swap32_ssse3(char* dest, const char* src, size_t n)
+{
+    size_t done = _swap_ssse3(dest, src, 4 * n, _mm_setr_epi8(SWAP32_MASK));
+    _swap32_scalar(&dest[done], &src[done], n - done / 4);
+}
+
+__attribute__((target("ssse3")))
+static void _swap64_ssse3(char* dest, const char* src, size_t n)
+{
+    size_t done = _swap_ssse3(dest, src, 8 * n, _mm_setr_epi8(SWAP64_MASK));
+    _swap64_scalar(&dest[done], &src[done], n - done / 8);
+}
+
+__attribute__((target("avx2")))
+static void _swap16_avx2(char* dest, const char* src, size_t n)
+{
+    size_t done = _swap_avx2(dest, src, 2 * n, _mm256_setr_epi8(SWAP16_MASK, SWAP16_MASK));
+    _swap16_ssse3(&dest[done], &src[done], n - done / 2);
+}
+
+__attribute__((target("avx2")))
+static void _swap32_avx2(char* dest, const char* src, size_t n)
+{
+    size_t done = _swap_avx2(dest, src, 4 * n, _mm256_setr_epi8(SWAP32_MASK, SWAP32_MASK));
+    _swap32_ssse3(&dest[done], &src[done], n - done / 4);
+}
+
+__attribute__((target("avx2")))
+static void _swap64_avx2(char* dest, const char* src, size_t n)
+{
+    size_t done = _swap_avx2(dest, src, 8 * n, _mm256_setr_epi8(SWAP64_MASK, SWAP64_MASK));
+    _swap64_ssse3(&dest[done], &src[done], n - done / 8);
+}
+
+#endif
+
+typedef void (*_swap_kernel)(char* dest, const char* src, size_t n);
+
+static _swap_kernel _swap16 = NULL;
+static _swap_kernel _swap32 = NULL;
+static _swap_kernel _swap64 = NULL;
+
+/// Guards the one-off selection of kernels, which may first be needed
+/// on any thread, such as a reader thread or decoder pool worker
+static pthread_once_t _swap_kernels_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Select the widest byte-swap kernels supported by the running CPU.
+ * This is run exactly once, through `pthread_once`, which also makes
+ * the selection visible to every thread that goes on to use it.
+ */
+static void _select_swap_kernels()
+{
+    _swap_kernel swap16 = _swap16_scalar;
+    _swap_kernel swap32 = _swap32_scalar;
+    _swap_kernel swap64 = _swap64_scalar;
+#ifdef SEABOLT_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        swap16 = _swap16_avx2;
+        swap32 = _swap32_avx2;
+        swap64 = _swap64_avx2;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        swap16 = _swap16_ssse3;
+        swap32 = _swap32_ssse3;
+        swap64 = _swap64_ssse3;
+    }
+#endif
+    _swap16 = swap16;
+    _swap32 = swap32;
+    _swap64 = swap64;
+}
+
+#endif
+
+void memcpy_be16_array(void* dest, const void* src, size_t n)
+{
+#if SEABOLT_LITTLE_ENDIAN
+    pthread_once(&_swap_kernels_once, _select_swap_kernels);
+    _swap16((char*)(dest), (const char*)(src), n);
+#else
+    memcpy(dest, src, 2 * n);
+#endif
+}
+
+void memcpy_be32_array(void* dest, const void* src, size_t n)
+{
+#if SEABOLT_LITTLE_ENDIAN
+    pthread_once(&_swap_kernels_once, _select_swap_kernels);
+    _swap32((char*)(dest), (const char*)(src), n);
+#else
+    memcpy(dest, src, 4 * n);
+#endif
+}
+
+void memcpy_be64_array(void* dest, const void* src, size_t n)
+{
+#if SEABOLT_LITTLE_ENDIAN
+    pthread_once(&_swap_kernels_once, _select_swap_kernels);
+    _swap64((char*)(dest), (const char*)(src), n);
+#else
+    memcpy(dest, src, 8 * n);
+#endif
+}
+
 
 
 static size_t __allocation = 0;
@@ -44,35 +225,217 @@ static size_t __peak_allocation = 0;
 static long long __allocation_events = 0;
 
 
-void* BoltMem_allocate(size_t new_size)
+static void* _system_allocate(void* context, size_t size)
 {
-    void* p = malloc(new_size);
-    __allocation += new_size;
-    if (__allocation > __peak_allocation) __peak_allocation = __allocation;
+    return malloc(size);
+}
+
+static void* _system_reallocate(void* context, void* ptr, size_t old_size, size_t new_size)
+{
+    return realloc(ptr, new_size);
+}
+
+static void _system_deallocate(void* context, void* ptr, size_t size)
+{
+    free(ptr);
+}
+
+static struct BoltAllocator __system_allocator = {
+        "system", _system_allocate, _system_reallocate, _system_deallocate, NULL, {0, 0, 0}
+};
+
+static struct BoltAllocator* __allocator = &__system_allocator;
+
+
+struct BoltAllocator* BoltMem_system_allocator()
+{
+    return &__system_allocator;
+}
+
+void BoltMem_set_allocator(struct BoltAllocator* allocator)
+{
+    __allocator = allocator == NULL ? &__system_allocator : allocator;
+}
+
+struct BoltAllocator* BoltMem_allocator()
+{
+    return __allocator;
+}
+
+static void _raise(size_t* peak, size_t allocation)
+{
+    size_t current_peak = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (allocation > current_peak &&
+           !__atomic_compare_exchange_n(peak, &current_peak, allocation, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/**
+ * Update allocation statistics. These are updated atomically, as
+ * allocations may be made from a connection's reader thread as well
+ * as from the calling thread.
+ */
+static void _track(struct BoltAllocator* allocator, size_t old_size, size_t new_size)
+{
+    struct BoltAllocatorStats* stats = &allocator->stats;
+    size_t allocation = __atomic_add_fetch(&stats->current_allocation, new_size - old_size, __ATOMIC_RELAXED);
+    _raise(&stats->peak_allocation, allocation);
+    __atomic_add_fetch(&stats->allocation_events, 1, __ATOMIC_RELAXED);
+    allocation = __atomic_add_fetch(&__allocation, new_size - old_size, __ATOMIC_RELAXED);
+    _raise(&__peak_allocation, allocation);
+    __atomic_add_fetch(&__allocation_events, 1, __ATOMIC_RELAXED);
+}
+
+void* BoltAllocator_allocate(struct BoltAllocator* allocator, size_t new_size)
+{
+    if (allocator == NULL) allocator = __allocator;
+    void* p = allocator->allocate(allocator->context, new_size);
+    _track(allocator, 0, new_size);
 //    BoltLog_info("bolt: (Allocated %ld bytes (balance: %lu))", new_size, __allocation);
-    __allocation_events += 1;
     return p;
 }
 
-void* BoltMem_reallocate(void* ptr, size_t old_size, size_t new_size)
+void* BoltAllocator_reallocate(struct BoltAllocator* allocator, void* ptr, size_t old_size, size_t new_size)
 {
-    void* p = realloc(ptr, new_size);
-    __allocation = __allocation - old_size + new_size;
-    if (__allocation > __peak_allocation) __peak_allocation = __allocation;
+    if (allocator == NULL) allocator = __allocator;
+    void* p = allocator->reallocate(allocator->context, ptr, old_size, new_size);
+    _track(allocator, old_size, new_size);
 //    BoltLog_info("bolt: (Reallocated %ld bytes as %ld bytes (balance: %lu))", old_size, new_size, __allocation);
-    __allocation_events += 1;
     return p;
 }
 
-void* BoltMem_deallocate(void* ptr, size_t old_size)
+void* BoltAllocator_deallocate(struct BoltAllocator* allocator, void* ptr, size_t old_size)
 {
-    free(ptr);
-    __allocation -= old_size;
+    if (allocator == NULL) allocator = __allocator;
+    allocator->deallocate(allocator->context, ptr, old_size);
+    _track(allocator, old_size, 0);
 //    BoltLog_info("bolt: (Freed %ld bytes (balance: %lu))", old_size, __allocation);
-    __allocation_events += 1;
     return NULL;
 }
 
+void* BoltMem_allocate(size_t new_size)
+{
+    return BoltAllocator_allocate(__allocator, new_size);
+}
+
+void* BoltMem_reallocate(void* ptr, size_t old_size, size_t new_size)
+{
+    return BoltAllocator_reallocate(__allocator, ptr, old_size, new_size);
+}
+
+void* BoltMem_deallocate(void* ptr, size_t old_size)
+{
+    return BoltAllocator_deallocate(__allocator, ptr, old_size);
+}
+
+
+struct _slab
+{
+    struct _slab* next;
+};
+
+struct _slab_context
+{
+    size_t block_size;
+    size_t blocks_per_slab;
+    /// All slabs allocated so far, each prefixed by a `struct _slab` link
+    struct _slab* slabs;
+    /// Singly-linked list of free blocks, threaded through the blocks themselves
+    void* free_list;
+};
+
+static void* _slab_allocate(void* context, size_t size)
+{
+    struct _slab_context* slab_context = context;
+    if (size > slab_context->block_size)
+    {
+        return malloc(size);
+    }
+    if (slab_context->free_list == NULL)
+    {
+        size_t header_size = (sizeof(struct _slab) + 15) & ~(size_t)(15);
+        struct _slab* slab = malloc(header_size + slab_context->block_size * slab_context->blocks_per_slab);
+        if (slab == NULL)
+        {
+            return NULL;
+        }
+        slab->next = slab_context->slabs;
+        slab_context->slabs = slab;
+        char* blocks = (char*)(slab) + header_size;
+        for (size_t i = 0; i < slab_context->blocks_per_slab; i++)
+        {
+            void* block = &blocks[i * slab_context->block_size];
+            *(void**)(block) = slab_context->free_list;
+            slab_context->free_list = block;
+        }
+    }
+    void* block = slab_context->free_list;
+    slab_context->free_list = *(void**)(block);
+    return block;
+}
+
+static void _slab_deallocate(void* context, void* ptr, size_t size)
+{
+    struct _slab_context* slab_context = context;
+    if (size > slab_context->block_size)
+    {
+        free(ptr);
+        return;
+    }
+    *(void**)(ptr) = slab_context->free_list;
+    slab_context->free_list = ptr;
+}
+
+static void* _slab_reallocate(void* context, void* ptr, size_t old_size, size_t new_size)
+{
+    struct _slab_context* slab_context = context;
+    if (old_size > slab_context->block_size && new_size > slab_context->block_size)
+    {
+        return realloc(ptr, new_size);
+    }
+    if (old_size <= slab_context->block_size && new_size <= slab_context->block_size)
+    {
+        return ptr;
+    }
+    void* p = _slab_allocate(context, new_size);
+    memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    _slab_deallocate(context, ptr, old_size);
+    return p;
+}
+
+struct BoltAllocator* BoltMem_create_slab_allocator(size_t block_size, size_t blocks_per_slab)
+{
+    struct BoltAllocator* allocator = malloc(sizeof(struct BoltAllocator));
+    struct _slab_context* context = malloc(sizeof(struct _slab_context));
+    // every block must be able to hold a free list link and stay aligned
+    block_size = block_size < sizeof(void*) ? sizeof(void*) : block_size;
+    context->block_size = (block_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    context->blocks_per_slab = blocks_per_slab == 0 ? 1 : blocks_per_slab;
+    context->slabs = NULL;
+    context->free_list = NULL;
+    allocator->name = "slab";
+    allocator->allocate = _slab_allocate;
+    allocator->reallocate = _slab_reallocate;
+    allocator->deallocate = _slab_deallocate;
+    allocator->context = context;
+    memset(&allocator->stats, 0, sizeof(allocator->stats));
+    return allocator;
+}
+
+void BoltMem_destroy_slab_allocator(struct BoltAllocator* allocator)
+{
+    struct _slab_context* context = allocator->context;
+    while (context->slabs != NULL)
+    {
+        struct _slab* next = context->slabs->next;
+        free(context->slabs);
+        context->slabs = next;
+    }
+    free(context);
+    free(allocator);
+}
+
 void* BoltMem_adjust(void* ptr, size_t old_size, size_t new_size)
 {
     if (new_size == old_size)
@@ -112,15 +475,15 @@ void* BoltMem_adjust(void* ptr, size_t old_size, size_t new_size)
 
 size_t BoltMem_current_allocation()
 {
-    return __allocation;
+    return __atomic_load_n(&__allocation, __ATOMIC_RELAXED);
 }
 
 size_t BoltMem_peak_allocation()
 {
-    return __peak_allocation;
+    return __atomic_load_n(&__peak_allocation, __ATOMIC_RELAXED);
 }
 
 long long BoltMem_allocation_events()
 {
-    return __allocation_events;
+    return __atomic_load_n(&__allocation_events, __ATOMIC_RELAXED);
 }
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <string.h>
+#include "pack.h"
+#include "buffer.h"
+#include "protocol/v1.h"
+
+
+/**
+ * Take the request being written back off the transmit buffer.
+ *
+ * @param writer
+ * @return -1
+ */
+int _fail(struct BoltPackWriter* writer)
+{
+    if (!writer->failed)
+    {
+        BoltProtocolV1_truncate_request(writer->connection, writer->start);
+        writer->failed = 1;
+        writer->depth = 0;
+    }
+    return -1;
+}
+
+/**
+ * Account for the next item written into the innermost container.
+ *
+ * @param writer
+ * @param is_string whether the item is a string, which map keys must be
+ * @return 0 if the item fits, -1 otherwise
+ */
+int _next_item(struct BoltPackWriter* writer, int is_string)
+{
+    if (writer->failed || writer->depth == 0)
+    {
+        return _fail(writer);
+    }
+    struct BoltPackFrame* frame = &writer->frames[writer->depth - 1];
+    if (frame->count == frame->size || (frame->is_map && frame->count % 2 == 0 && !is_string))
+    {
+        return _fail(writer);
+    }
+    frame->count += 1;
+    return 0;
+}
+
+int _push(struct BoltPackWriter* writer, int32_t size, int is_map)
+{
+    if (writer->depth == BOLT_PACK_MAX_DEPTH || size < 0 || (is_map && size > INT32_MAX / 2))
+    {
+        return _fail(writer);
+    }
+    struct BoltPackFrame* frame = &writer->frames[writer->depth];
+    frame->size = is_map ? 2 * size : size;
+    frame->count = 0;
+    frame->is_map = is_map;
+    writer->depth += 1;
+    return 0;
+}
+
+int BoltPackWriter_begin_run_request(struct BoltPackWriter* writer, struct BoltConnection* connection,
+                                     const char* statement, size_t size, int32_t n_parameters)
+{
+    writer->connection = connection;
+    writer->depth = 0;
+    writer->failed = 1;
+    if (connection->protocol_version < 1 || connection->protocol_version > 2 || size > INT32_MAX || n_parameters < 0)
+    {
+        return -1;
+    }
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    writer->start = state->tx_buffer->extent;
+    writer->failed = 0;
+    try(_push(writer, n_parameters, 1));
+    if (BoltProtocolV1_begin_run(connection, statement, (int32_t)(size), n_parameters) == -1)
+    {
+        return _fail(writer);
+    }
+    return 0;
+}
+
+int BoltPackWriter_begin_map(struct BoltPackWriter* writer, int32_t size)
+{
+    try(_next_item(writer, 0));
+    try(_push(writer, size, 1));
+    if (BoltProtocolV1_load_map_header(writer->connection, size) == -1)
+    {
+        return _fail(writer);
+    }
+    return 0;
+}
+
+int BoltPackWriter_begin_list(struct BoltPackWriter* writer, int32_t size)
+{
+    try(_next_item(writer, 0));
+    try(_push(writer, size, 0));
+    if (BoltProtocolV1_load_list_header(writer->connection, size) == -1)
+    {
+        return _fail(writer);
+    }
+    return 0;
+}
+
+int BoltPackWriter_end(struct BoltPackWriter* writer)
+{
+    if (writer->failed || writer->depth == 0)
+    {
+        return _fail(writer);
+    }
+    struct BoltPackFrame* frame = &writer->frames[writer->depth - 1];
+    if (frame->count != frame->size)
+    {
+        return _fail(writer);
+    }
+    writer->depth -= 1;
+    if (writer->depth == 0)
+    {
+        // The request is complete, so the writer has nothing left to write.
+        writer->failed = 1;
+        return BoltProtocolV1_end_request(writer->connection);
+    }
+    return 0;
+}
+
+int BoltPackWriter_write_null(struct BoltPackWriter* writer)
+{
+    try(_next_item(writer, 0));
+    return BoltProtocolV1_load_null(writer->connection);
+}
+
+int BoltPackWriter_write_boolean(struct BoltPackWriter* writer, int x)
+{
+    try(_next_item(writer, 0));
+    return BoltProtocolV1_load_boolean(writer->connection, x);
+}
+
+int BoltPackWriter_write_int(struct BoltPackWriter* writer, int64_t x)
+{
+    try(_next_item(writer, 0));
+    return BoltProtocolV1_load_integer(writer->connection, x);
+}
+
+int BoltPackWriter_write_float(struct BoltPackWriter* writer, double x)
+{
+    try(_next_item(writer, 0));
+    return BoltProtocolV1_load_float(writer->connection, x);
+}
+
+int BoltPackWriter_write_string(struct BoltPackWriter* writer, const char* string, size_t size)
+{
+    try(_next_item(writer, 1));
+    if (size > INT32_MAX || BoltProtocolV1_load_string(writer->connection, string, (int32_t)(size)) == -1)
+    {
+        return _fail(writer);
+    }
+    return 0;
+}
+
+int BoltPackWriter_write_cstring(struct BoltPackWriter* writer, const char* string)
+{
+    return BoltPackWriter_write_string(writer, string, strlen(string));
+}
+
+int BoltPackWriter_write_bytes(struct BoltPackWriter* writer, const char* data, size_t size)
+{
+    try(_next_item(writer, 0));
+    if (size > INT32_MAX || BoltProtocolV1_load_bytes(writer->connection, data, (int32_t)(size)) == -1)
+    {
+        return _fail(writer);
+    }
+    return 0;
+}
+
+int BoltPackWriter_write_value(struct BoltPackWriter* writer, struct BoltValue* value)
+{
+    try(_next_item(writer, BoltValue_type(value) == BOLT_STRING8));
+    // A request would be queued as a request of its own.
+    if (BoltValue_type(value) == BOLT_REQUEST || BoltProtocolV1_load(writer->connection, value) == -1)
+    {
+        return _fail(writer);
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <memory.h>
+#include "packstream.h"
+#include "buffer.h"
+#include "mem.h"
+#include "protocol/v1.h"
+
+
+#define INITIAL_BUFFER_SIZE 256
+
+
+struct BoltPacker
+{
+    struct BoltConnection encoder;
+    struct BoltProtocolV1State state;
+    /// Whether the buffer was created by the packer, and so is destroyed with it
+    int owns_buffer;
+};
+
+struct BoltUnpacker
+{
+    struct BoltConnection decoder;
+    struct BoltProtocolV1State state;
+    /// Buffer over the span of memory being read, if any
+    struct BoltBuffer span;
+};
+
+
+struct BoltPacker* BoltPacker_create(struct BoltBuffer* buffer)
+{
+    struct BoltPacker* packer = BoltMem_allocate(sizeof(struct BoltPacker));
+    packer->owns_buffer = buffer == NULL;
+    if (buffer == NULL)
+    {
+        buffer = BoltBuffer_create(NULL, INITIAL_BUFFER_SIZE);
+    }
+    BoltProtocolV1_init_encoder(&packer->encoder, &packer->state, buffer, 2);
+    return packer;
+}
+
+void BoltPacker_destroy(struct BoltPacker* packer)
+{
+    if (packer->owns_buffer)
+    {
+        BoltBuffer_destroy(packer->state.tx_buffer);
+    }
+    BoltMem_deallocate(packer, sizeof(struct BoltPacker));
+}
+
+const char* BoltPacker_data(const struct BoltPacker* packer, int32_t* size)
+{
+    struct BoltBuffer* buffer = packer->state.tx_buffer;
+    *size = BoltBuffer_unloadable(buffer);
+    return &buffer->data[buffer->cursor];
+}
+
+void BoltPacker_reset(struct BoltPacker* packer)
+{
+    packer->state.tx_buffer->extent = 0;
+    packer->state.tx_buffer->cursor = 0;
+}
+
+int BoltPacker_pack(struct BoltPacker* packer, struct BoltValue* value)
+{
+    int extent = packer->state.tx_buffer->extent;
+    if (BoltProtocolV1_load(&packer->encoder, value) == -1)
+    {
+        // Leave nothing of a value that could only be partly packed
+        packer->state.tx_buffer->extent = extent;
+        return -1;
+    }
+    return 0;
+}
+
+int BoltPacker_pack_null(struct BoltPacker* packer)
+{
+    return BoltProtocolV1_load_null(&packer->encoder);
+}
+
+int BoltPacker_pack_boolean(struct BoltPacker* packer, int x)
+{
+    return BoltProtocolV1_load_boolean(&packer->encoder, x);
+}
+
+int BoltPacker_pack_integer(struct BoltPacker* packer, int64_t x)
+{
+    return BoltProtocolV1_load_integer(&packer->encoder, x);
+}
+
+int BoltPacker_pack_float(struct BoltPacker* packer, double x)
+{
+    return BoltProtocolV1_load_float(&packer->encoder, x);
+}
+
+int BoltPacker_pack_string(struct BoltPacker* packer, const char* string, int32_t size)
+{
+    return BoltProtocolV1_load_string(&packer->encoder, string, size);
+}
+
+int BoltPacker_pack_bytes(struct BoltPacker* packer, const char* data, int32_t size)
+{
+    return BoltProtocolV1_load_bytes(&packer->encoder, data, size);
+}
+
+int BoltPacker_pack_list_header(struct BoltPacker* packer, int32_t size)
+{
+    return BoltProtocolV1_load_list_header(&packer->encoder, size);
+}
+
+int BoltPacker_pack_map_header(struct BoltPacker* packer, int32_t size)
+{
+    return BoltProtocolV1_load_map_header(&packer->encoder, size);
+}
+
+struct BoltUnpacker* BoltUnpacker_create(struct BoltBuffer* buffer)
+{
+    struct BoltUnpacker* unpacker = BoltMem_allocate(sizeof(struct BoltUnpacker));
+    memset(unpacker, 0, sizeof(struct BoltUnpacker));
+    // Values are unpacked onto the heap, with no interning and no views,
+    // so that they stand alone
+    unpacker->state.rx_buffer = buffer;
+    unpacker->state.view_threshold = -1;
+    unpacker->decoder.protocol_version = 1;
+    unpacker->decoder.protocol_state = &unpacker->state;
+    return unpacker;
+}
+
+struct BoltUnpacker* BoltUnpacker_create_span(const char* data, int32_t size)
+{
+    struct BoltUnpacker* unpacker = BoltUnpacker_create(NULL);
+    struct BoltBuffer* span = &unpacker->span;
+    span->allocator = NULL;
+    span->data = (char*)(data);
+    span->size = size < 0 ? 0 : (size_t)(size);
+    span->extent = size < 0 ? 0 : size;
+    span->cursor = 0;
+    unpacker->state.rx_buffer = span;
+    return unpacker;
+}
+
+void BoltUnpacker_destroy(struct BoltUnpacker* unpacker)
+{
+    BoltMem_deallocate(unpacker, sizeof(struct BoltUnpacker));
+}
+
+int32_t BoltUnpacker_remaining(const struct BoltUnpacker* unpacker)
+{
+    return BoltBuffer_unloadable(unpacker->state.rx_buffer);
+}
+
+static const struct BoltEventHandler SKIP_HANDLER = {NULL};
+
+int BoltUnpacker_unpack(struct BoltUnpacker* unpacker, struct BoltValue* value)
+{
+    struct BoltBuffer* buffer = unpacker->state.rx_buffer;
+    if (BoltBuffer_unloadable(buffer) == 0) return 0;
+    // Skip over the value first, to be sure that it is complete, and
+    // then go back to unpack it
+    int cursor = buffer->cursor;
+    int extent = buffer->extent;
+    int checked = BoltProtocolV1_unload_value_events(buffer, &SKIP_HANDLER, NULL);
+    buffer->cursor = cursor;
+    buffer->extent = extent;
+    try(checked);
+    try(BoltProtocolV1_unload_value(&unpacker->decoder, value));
+    return 1;
+}
+
+int BoltUnpacker_unpack_events(struct BoltUnpacker* unpacker, const struct BoltEventHandler* handler,
+                               void* context)
+{
+    struct BoltBuffer* buffer = unpacker->state.rx_buffer;
+    if (BoltBuffer_unloadable(buffer) == 0) return 0;
+    int cursor = buffer->cursor;
+    int extent = buffer->extent;
+    if (BoltProtocolV1_unload_value_events(buffer, handler, context) == -1)
+    {
+        buffer->cursor = cursor;
+        buffer->extent = extent;
+        return -1;
+    }
+    return 1;
+}
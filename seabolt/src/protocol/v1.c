@@ -21,16 +21,29 @@
 #include <stdlib.h>
 #include <values.h>
 #include <memory.h>
+#include "../arena.h"
 #include "../buffer.h"
+#include "../idmap.h"
+#include "../intern.h"
 #include "v1.h"
+#include "events.h"
 #include "mem.h"
 
 #define RUN 0x10
 #define DISCARD_ALL 0x2F
 #define PULL_ALL 0x3F
 
+#define POINT_2D 'X'
+#define POINT_3D 'Y'
+
 #define INITIAL_TX_BUFFER_SIZE 8192
 #define INITIAL_RX_BUFFER_SIZE 8192
+#define INITIAL_ARENA_SIZE 8192
+#define INITIAL_ENTITY_CAPACITY 64
+#define MAX_CHUNK_SIZE 0xFFFF
+/// Borrowed and mapped data smaller than this is copied as usual, since
+/// gathering it would cost more than the copy saves
+#define MIN_GATHER_SIZE 4096
 
 
 void _create_run_request(struct _run_request* run, int32_t n_parameters)
@@ -42,12 +55,40 @@ void _create_run_request(struct _run_request* run, int32_t n_parameters)
     BoltValue_to_Dictionary8(run->parameters, n_parameters);
 }
 
-struct BoltProtocolV1State* BoltProtocolV1_create_state()
+static struct _entity_map* _create_entities(struct BoltAllocator* allocator)
+{
+    struct _entity_map* entities = BoltAllocator_allocate(allocator, sizeof(struct _entity_map));
+    entities->storage = BoltArena_create(allocator, INITIAL_ARENA_SIZE);
+    entities->nodes = BoltIdMap_create(allocator);
+    entities->relationships = BoltIdMap_create(allocator);
+    entities->unbound_relationships = BoltIdMap_create(allocator);
+    entities->n_values = 0;
+    entities->capacity = INITIAL_ENTITY_CAPACITY;
+    entities->values = BoltAllocator_allocate(allocator, sizeof_n(struct BoltValue*, entities->capacity));
+    return entities;
+}
+
+static void _destroy_entities(struct BoltProtocolV1State* state)
 {
-    struct BoltProtocolV1State* state = BoltMem_allocate(sizeof(struct BoltProtocolV1State));
+    struct _entity_map* entities = state->entities;
+    if (entities == NULL) return;
+    BoltAllocator_deallocate(state->allocator, entities->values, sizeof_n(struct BoltValue*, entities->capacity));
+    BoltIdMap_destroy(entities->unbound_relationships);
+    BoltIdMap_destroy(entities->relationships);
+    BoltIdMap_destroy(entities->nodes);
+    BoltArena_destroy(entities->storage);
+    BoltAllocator_deallocate(state->allocator, entities, sizeof(struct _entity_map));
+    state->entities = NULL;
+}
+
+struct BoltProtocolV1State* BoltProtocolV1_create_state(struct BoltAllocator* allocator)
+{
+    if (allocator == NULL) allocator = BoltMem_allocator();
+    struct BoltProtocolV1State* state = BoltAllocator_allocate(allocator, sizeof(struct BoltProtocolV1State));
+    state->allocator = allocator;
 
-    state->tx_buffer = BoltBuffer_create(INITIAL_TX_BUFFER_SIZE);
-    state->rx_buffer = BoltBuffer_create(INITIAL_RX_BUFFER_SIZE);
+    state->tx_buffer = BoltBuffer_create(allocator, INITIAL_TX_BUFFER_SIZE);
+    state->rx_buffer = BoltBuffer_create(allocator, INITIAL_RX_BUFFER_SIZE);
 
     state->next_request_id = 0;
     state->response_counter = 0;
@@ -67,6 +108,16 @@ struct BoltProtocolV1State* BoltProtocolV1_create_state()
     BoltValue_to_Request(state->pull_request, PULL_ALL, 0);
 
     state->fetched = BoltValue_create();
+    state->fetched_arena = BoltArena_create(allocator, INITIAL_ARENA_SIZE);
+    state->interned_keys = BoltInternTable_create(allocator);
+    state->view_threshold = -1;
+    state->entities = NULL;
+    state->stream_threshold = -1;
+    state->stream_sink = NULL;
+    state->stream_context = NULL;
+    state->stream_chunk = NULL;
+    memset(&state->pending, 0, sizeof(struct _gather_list));
+    memset(&state->queued, 0, sizeof(struct _gather_list));
     return state;
 }
 
@@ -86,8 +137,19 @@ void BoltProtocolV1_destroy_state(struct BoltProtocolV1State* state)
     BoltValue_destroy(state->pull_request);
 
     BoltValue_destroy(state->fetched);
+    BoltArena_destroy(state->fetched_arena);
+    BoltInternTable_destroy(state->interned_keys);
+    _destroy_entities(state);
+    if (state->stream_chunk != NULL)
+    {
+        BoltAllocator_deallocate(state->allocator, state->stream_chunk, MAX_CHUNK_SIZE);
+    }
+    BoltAllocator_deallocate(state->allocator, state->pending.segments,
+                             sizeof_n(struct _gather_segment, state->pending.capacity));
+    BoltAllocator_deallocate(state->allocator, state->queued.segments,
+                             sizeof_n(struct _gather_segment, state->queued.capacity));
 
-    BoltMem_deallocate(state, sizeof(struct BoltProtocolV1State));
+    BoltAllocator_deallocate(state->allocator, state, sizeof(struct BoltProtocolV1State));
 }
 
 struct BoltProtocolV1State* BoltProtocolV1_state(struct BoltConnection* connection)
@@ -187,6 +249,25 @@ int BoltProtocolV1_load_float(struct BoltConnection* connection, double value)
     return 0;
 }
 
+static void _load_bytes_header(struct BoltBuffer* buffer, int32_t size)
+{
+    if (size < 0x100)
+    {
+        BoltBuffer_load_uint8(buffer, 0xCC);
+        BoltBuffer_load_uint8(buffer, (uint8_t)(size));
+    }
+    else if (size < 0x10000)
+    {
+        BoltBuffer_load_uint8(buffer, 0xCD);
+        BoltBuffer_load_uint16_be(buffer, (uint16_t)(size));
+    }
+    else
+    {
+        BoltBuffer_load_uint8(buffer, 0xCE);
+        BoltBuffer_load_int32_be(buffer, size);
+    }
+}
+
 int BoltProtocolV1_load_bytes(struct BoltConnection* connection, const char* string, int32_t size)
 {
     if (size < 0)
@@ -194,61 +275,145 @@ int BoltProtocolV1_load_bytes(struct BoltConnection* connection, const char* str
         return -1;
     }
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    if (size < 0x100)
+    _load_bytes_header(state->tx_buffer, size);
+    BoltBuffer_load(state->tx_buffer, string, size);
+    return 0;
+}
+
+static void _load_string_header(struct BoltBuffer* buffer, int32_t size)
+{
+    if (size < 0x10)
     {
-        BoltBuffer_load_uint8(state->tx_buffer, 0xCC);
-        BoltBuffer_load_uint8(state->tx_buffer, (uint8_t)(size));
-        BoltBuffer_load(state->tx_buffer, string, size);
+        BoltBuffer_load_uint8(buffer, (uint8_t)(0x80 + size));
+    }
+    else if (size < 0x100)
+    {
+        BoltBuffer_load_uint8(buffer, 0xD0);
+        BoltBuffer_load_uint8(buffer, (uint8_t)(size));
     }
     else if (size < 0x10000)
     {
-        BoltBuffer_load_uint8(state->tx_buffer, 0xCD);
-        BoltBuffer_load_uint16_be(state->tx_buffer, (uint16_t)(size));
-        BoltBuffer_load(state->tx_buffer, string, size);
+        BoltBuffer_load_uint8(buffer, 0xD1);
+        BoltBuffer_load_uint16_be(buffer, (uint16_t)(size));
     }
     else
     {
-        BoltBuffer_load_uint8(state->tx_buffer, 0xCE);
-        BoltBuffer_load_int32_be(state->tx_buffer, size);
-        BoltBuffer_load(state->tx_buffer, string, size);
+        BoltBuffer_load_uint8(buffer, 0xD2);
+        BoltBuffer_load_int32_be(buffer, size);
     }
-    return 0;
 }
 
-int BoltProtocolV1_load_string(struct BoltConnection* connection, const char* string, int32_t size)
+int _load_string(struct BoltBuffer* buffer, const char* string, int32_t size)
 {
     if (size < 0)
     {
         return -1;
     }
+    _load_string_header(buffer, size);
+    BoltBuffer_load(buffer, string, size);
+    return 0;
+}
+
+int BoltProtocolV1_load_string(struct BoltConnection* connection, const char* string, int32_t size)
+{
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    if (size < 0x10)
+    return _load_string(state->tx_buffer, string, size);
+}
+
+static void _gather(struct BoltAllocator* allocator, struct _gather_list* list, int32_t offset,
+                    const char* data, int32_t size)
+{
+    if (list->size == list->capacity)
+    {
+        int32_t capacity = list->capacity == 0 ? 8 : 2 * list->capacity;
+        list->segments = BoltAllocator_reallocate(allocator, list->segments,
+                                                  sizeof_n(struct _gather_segment, list->capacity),
+                                                  sizeof_n(struct _gather_segment, capacity));
+        list->capacity = capacity;
+    }
+    struct _gather_segment* segment = &list->segments[list->size];
+    segment->offset = offset;
+    segment->size = size;
+    segment->data = data;
+    list->size += 1;
+}
+
+/**
+ * Load a large borrowed or mapped string or byte array by reference,
+ * leaving its data to be gathered in when the request is sent. Frozen
+ * data is gathered in verbatim, with no header of its own.
+ *
+ * Bare encoders (see BoltProtocolV1_init_encoder) never send, so they
+ * always copy.
+ *
+ * @return 1 if loaded, 0 if the value should be copied instead
+ */
+static int _load_gathered(struct BoltConnection* connection, struct BoltValue* value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (!(value->flags & BOLT_VALUE_GATHERED) || value->size < MIN_GATHER_SIZE || connection->tx_buffer == NULL)
     {
-        BoltBuffer_load_uint8(state->tx_buffer, (uint8_t)(0x80 + size));
-        BoltBuffer_load(state->tx_buffer, string, size);
+        return 0;
     }
-    else if (size < 0x100)
+    if (value->flags & BOLT_VALUE_FROZEN)
     {
-        BoltBuffer_load_uint8(state->tx_buffer, 0xD0);
-        BoltBuffer_load_uint8(state->tx_buffer, (uint8_t)(size));
-        BoltBuffer_load(state->tx_buffer, string, size);
+        // Already encoded
     }
-    else if (size < 0x10000)
+    else if (BoltValue_type(value) == BOLT_STRING8)
     {
-        BoltBuffer_load_uint8(state->tx_buffer, 0xD1);
-        BoltBuffer_load_uint16_be(state->tx_buffer, (uint16_t)(size));
-        BoltBuffer_load(state->tx_buffer, string, size);
+        _load_string_header(state->tx_buffer, value->size);
     }
     else
     {
-        BoltBuffer_load_uint8(state->tx_buffer, 0xD2);
-        BoltBuffer_load_int32_be(state->tx_buffer, size);
-        BoltBuffer_load(state->tx_buffer, string, size);
+        _load_bytes_header(state->tx_buffer, value->size);
+    }
+    _gather(state->allocator, &state->pending, state->tx_buffer->extent, value->data.extended.as_char, value->size);
+    return 1;
+}
+
+void BoltProtocolV1_truncate_request(struct BoltConnection* connection, int extent)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    state->tx_buffer->extent = extent;
+    while (state->pending.size > 0 && state->pending.segments[state->pending.size - 1].offset >= extent)
+    {
+        state->pending.size -= 1;
+    }
+}
+
+/**
+ * Load a run of Floats, byte-swapping them all in one bulk pass.
+ *
+ * The swapped values are first written to the tail of the reserved
+ * space and then spread forward into place, each behind its marker.
+ * Every move is to a lower address than its source, so nothing still
+ * waiting to be moved is overwritten.
+ *
+ * @param connection
+ * @param array
+ * @param size
+ * @return
+ */
+int _load_float_array(struct BoltConnection* connection, const double* array, int32_t size)
+{
+    if (size < 0)
+    {
+        return -1;
+    }
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    const size_t unit_size = 1 + sizeof(double);
+    char* target = BoltBuffer_load_target(state->tx_buffer, (int)(unit_size * size));
+    char* swapped = &target[size];
+    memcpy_be64_array(swapped, array, (size_t)(size));
+    for (int32_t i = 0; i < size; i++)
+    {
+        memmove(&target[unit_size * i + 1], &swapped[sizeof(double) * i], sizeof(double));
+        target[unit_size * i] = (char)(0xC1);
     }
     return 0;
 }
 
-int _load_list_header(struct BoltConnection* connection, int32_t size)
+int BoltProtocolV1_load_list_header(struct BoltConnection* connection, int32_t size)
 {
     if (size < 0)
     {
@@ -277,7 +442,7 @@ int _load_list_header(struct BoltConnection* connection, int32_t size)
     return 0;
 }
 
-int _load_map_header(struct BoltConnection* connection, int32_t size)
+int BoltProtocolV1_load_map_header(struct BoltConnection* connection, int32_t size)
 {
     if (size < 0)
     {
@@ -321,19 +486,65 @@ int _load_structure_header(struct BoltConnection* connection, int16_t code, int8
 /**
  * Copy request data from buffer 1 to buffer 0, also adding chunks.
  *
+ * Requests larger than the biggest chunk (64 KiB less one byte) are
+ * split across as many chunks as needed. Borrowed data referenced by
+ * the request is split across chunks in the same way, but only queued
+ * by reference, to be gathered in when sent.
+ *
  * @param connection
  * @return request ID
  */
 int _enqueue(struct BoltConnection* connection)
 {
-    // TODO: more chunks if size is too big
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    int size = BoltBuffer_unloadable(state->tx_buffer);
+    // A bare encoder (see BoltProtocolV1_init_encoder) has nowhere to send to
+    if (connection->tx_buffer == NULL) return -1;
+    struct _gather_list* pending = &state->pending;
+    int64_t size = BoltBuffer_unloadable(state->tx_buffer);
+    for (int32_t i = 0; i < pending->size; i++)
+    {
+        size += pending->segments[i].size;
+    }
+    int32_t next = 0;
+    int32_t gathered = 0;
     char header[2];
-    header[0] = (char)(size >> 8);
-    header[1] = (char)(size);
-    BoltBuffer_load(connection->tx_buffer, &header[0], sizeof(header));
-    BoltBuffer_load(connection->tx_buffer, BoltBuffer_unload_target(state->tx_buffer, size), size);
+    while (size > 0)
+    {
+        int chunk_size = size < 0xFFFF ? (int)(size) : 0xFFFF;
+        header[0] = (char)(chunk_size >> 8);
+        header[1] = (char)(chunk_size);
+        BoltBuffer_load(connection->tx_buffer, &header[0], sizeof(header));
+        size -= chunk_size;
+        while (chunk_size > 0)
+        {
+            if (next < pending->size && pending->segments[next].offset == state->tx_buffer->cursor)
+            {
+                struct _gather_segment* segment = &pending->segments[next];
+                int n = segment->size - gathered < chunk_size ? segment->size - gathered : chunk_size;
+                _gather(state->allocator, &state->queued, connection->tx_buffer->extent,
+                        segment->data + gathered, n);
+                gathered += n;
+                if (gathered == segment->size)
+                {
+                    next += 1;
+                    gathered = 0;
+                }
+                chunk_size -= n;
+            }
+            else
+            {
+                // Segment offsets hold only as long as the cursor is
+                // moved by hand, since unloading everything resets it
+                struct BoltBuffer* buffer = state->tx_buffer;
+                int limit = next < pending->size ? pending->segments[next].offset : buffer->extent;
+                int n = limit - buffer->cursor < chunk_size ? limit - buffer->cursor : chunk_size;
+                BoltBuffer_load(connection->tx_buffer, &buffer->data[buffer->cursor], n);
+                buffer->cursor += n;
+                chunk_size -= n;
+            }
+        }
+    }
+    pending->size = 0;
     header[0] = (char)(0);
     header[1] = (char)(0);
     BoltBuffer_load(connection->tx_buffer, &header[0], sizeof(header));
@@ -347,6 +558,35 @@ int _enqueue(struct BoltConnection* connection)
     return request_id;
 }
 
+/**
+ * Load a Point2D or Point3D structure, which only Bolt v2 onwards has.
+ *
+ * @param connection
+ * @param srid
+ * @param coordinates
+ * @param dimensions 2 or 3
+ * @return 0 on success, -1 if the protocol version has no points
+ */
+static int _load_point(struct BoltConnection* connection, int64_t srid, const double* coordinates, int dimensions)
+{
+    if (connection->protocol_version < 2)
+    {
+        return -1;
+    }
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state->required_version < 2)
+    {
+        state->required_version = 2;
+    }
+    try(_load_structure_header(connection, dimensions == 2 ? POINT_2D : POINT_3D, (int8_t)(1 + dimensions)));
+    try(BoltProtocolV1_load_integer(connection, srid));
+    for (int i = 0; i < dimensions; i++)
+    {
+        try(BoltProtocolV1_load_float(connection, coordinates[i]));
+    }
+    return 0;
+}
+
 int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* value)
 {
     switch (BoltValue_type(value))
@@ -357,7 +597,7 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
             return BoltProtocolV1_load_boolean(connection, BoltBit_get(value));
         case BOLT_BIT_ARRAY:
         {
-            try(_load_list_header(connection, value->size));
+            try(BoltProtocolV1_load_list_header(connection, value->size));
             for (int32_t i = 0; i < value->size; i++)
             {
                 try(BoltProtocolV1_load_boolean(connection, BoltBitArray_get(value, i)));
@@ -368,6 +608,24 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
             // A Byte is coerced to an Integer (Int64)
             return BoltProtocolV1_load_integer(connection, BoltByte_get(value));
         case BOLT_BYTE_ARRAY:
+            if (value->flags & BOLT_VALUE_FROZEN)
+            {
+                if ((value->flags & BOLT_VALUE_FROZEN_V2) && connection->protocol_version < 2)
+                {
+                    return -1;
+                }
+                if (_load_gathered(connection, value))
+                {
+                    return 0;
+                }
+                struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+                BoltBuffer_load(state->tx_buffer, BoltByteArray_get_all(value), value->size);
+                return 0;
+            }
+            if (_load_gathered(connection, value))
+            {
+                return 0;
+            }
             return BoltProtocolV1_load_bytes(connection, BoltByteArray_get_all(value), value->size);
         case BOLT_CHAR16:
             return -1;
@@ -378,6 +636,10 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
         case BOLT_CHAR32_ARRAY:
             return -1;
         case BOLT_STRING8:
+            if (_load_gathered(connection, value))
+            {
+                return 0;
+            }
             return BoltProtocolV1_load_string(connection, BoltString8_get(value), value->size);
         case BOLT_STRING16:
             return -1;
@@ -387,7 +649,7 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
             return -1;
         case BOLT_DICTIONARY8:
         {
-            try(_load_map_header(connection, value->size));
+            try(BoltProtocolV1_load_map_header(connection, value->size));
             for (int32_t i = 0; i < value->size; i++)
             {
                 struct BoltValue* key = BoltDictionary8_key(value, i);
@@ -453,30 +715,37 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
         case BOLT_FLOAT64:
             return BoltProtocolV1_load_float(connection, BoltFloat64_get(value));
         case BOLT_FLOAT64_PAIR:
-//        {
-//            try(_load_list_header(connection, 2));
-//            try(BoltProtocolV1_load_float(connection, BoltFloat64Pair_get_first(value)));
-//            try(BoltProtocolV1_load_float(connection, BoltFloat64Pair_get_second(value)));
-//            return 0;
-//        }
-            return -1;
+            return _load_point(connection, BoltPoint_srid(value), BoltPoint_coordinates(value), 2);
         case BOLT_FLOAT64_TRIPLE:
-//        {
-//            try(_load_list_header(connection, 3));
-//            try(BoltProtocolV1_load_float(connection, BoltFloat64Triple_get_first(value)));
-//            try(BoltProtocolV1_load_float(connection, BoltFloat64Triple_get_second(value)));
-//            try(BoltProtocolV1_load_float(connection, BoltFloat64Triple_get_third(value)));
-//            return 0;
-//        }
-            return -1;
+            return _load_point(connection, BoltPoint_srid(value), BoltPoint_coordinates(value), 3);
         case BOLT_FLOAT64_QUAD:
             return -1;
         case BOLT_FLOAT64_ARRAY:
-            return -1;
+        {
+            try(BoltProtocolV1_load_list_header(connection, value->size));
+            const double* array = value->size <= sizeof(value->data) / sizeof(double) ?
+                                  value->data.as_double : value->data.extended.as_double;
+            return _load_float_array(connection, array, value->size);
+        }
         case BOLT_FLOAT64_PAIR_ARRAY:
-            return -1;
+        {
+            try(BoltProtocolV1_load_list_header(connection, value->size));
+            const double* array = BoltPoint_coordinates(value);
+            for (int32_t i = 0; i < value->size; i++)
+            {
+                try(_load_point(connection, BoltPoint_srid(value), &array[2 * i], 2));
+            }
+            return 0;
+        }
         case BOLT_FLOAT64_TRIPLE_ARRAY:
-            return -1;
+        {
+            try(BoltProtocolV1_load_list_header(connection, value->size));
+            for (int32_t i = 0; i < value->size; i++)
+            {
+                try(_load_point(connection, BoltPoint_srid(value), &BoltPoint_coordinates(value)[3 * i], 3));
+            }
+            return 0;
+        }
         case BOLT_FLOAT64_QUAD_ARRAY:
             return -1;
         case BOLT_STRUCTURE:
@@ -503,7 +772,7 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
             return -1;
         case BOLT_LIST:
         {
-            try(_load_list_header(connection, value->size));
+            try(BoltProtocolV1_load_list_header(connection, value->size));
             for (int32_t i = 0; i < value->size; i++)
             {
                 try(BoltProtocolV1_load(connection, BoltList_value(value, i)));
@@ -516,6 +785,146 @@ int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* val
     }
 }
 
+int BoltProtocolV1_begin_run(struct BoltConnection* connection, const char* statement, int32_t size,
+                             int32_t n_parameters)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    try(_load_structure_header(connection, 0x10, 2));
+    try(_load_string(state->tx_buffer, statement, size));
+    return BoltProtocolV1_load_map_header(connection, n_parameters);
+}
+
+int BoltProtocolV1_end_request(struct BoltConnection* connection)
+{
+    return _enqueue(connection);
+}
+
+struct BoltPreparedStatement* BoltProtocolV1_prepare(struct BoltConnection* connection, const char* statement,
+                                                     int32_t size, int32_t n_parameters)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (size < 0 || n_parameters < 0)
+    {
+        return NULL;
+    }
+    struct BoltPreparedStatement* prepared = BoltAllocator_allocate(state->allocator,
+                                                                   sizeof(struct BoltPreparedStatement));
+    prepared->allocator = state->allocator;
+    prepared->header = BoltBuffer_create(state->allocator, (size_t)(size) + 16);
+    // RUN {statement} {parameters}
+    // Encode all up to the parameter map header through the transmit
+    // buffer, and move it over into the prepared header without ever
+    // enqueueing it.
+    int extent = state->tx_buffer->extent;
+    _load_structure_header(connection, RUN, 2);
+    BoltProtocolV1_load_string(connection, statement, size);
+    BoltProtocolV1_load_map_header(connection, n_parameters);
+    int header_size = state->tx_buffer->extent - extent;
+    BoltBuffer_load(prepared->header, &state->tx_buffer->data[extent], header_size);
+    state->tx_buffer->extent = extent;
+    prepared->keys = BoltValue_create();
+    BoltValue_to_List(prepared->keys, n_parameters);
+    prepared->values = BoltValue_create();
+    BoltValue_to_List(prepared->values, n_parameters);
+    prepared->buffer = BoltBuffer_create(state->allocator, 64);
+    return prepared;
+}
+
+void BoltPreparedStatement_destroy(struct BoltPreparedStatement* prepared)
+{
+    BoltBuffer_destroy(prepared->buffer);
+    BoltValue_destroy(prepared->values);
+    BoltValue_destroy(prepared->keys);
+    BoltBuffer_destroy(prepared->header);
+    BoltAllocator_deallocate(prepared->allocator, prepared, sizeof(struct BoltPreparedStatement));
+}
+
+int BoltPreparedStatement_set_parameter_key(struct BoltPreparedStatement* prepared, int32_t index,
+                                            const char* key, size_t key_size)
+{
+    if (index < 0 || index >= prepared->keys->size || key_size > INT32_MAX)
+    {
+        return -1;
+    }
+    BoltBuffer_compact(prepared->buffer);
+    try(_load_string(prepared->buffer, key, (int32_t)(key_size)));
+    int size = BoltBuffer_unloadable(prepared->buffer);
+    BoltValue_to_ByteArray(BoltList_value(prepared->keys, index), BoltBuffer_unload_target(prepared->buffer, size), size);
+    return 0;
+}
+
+struct BoltValue* BoltPreparedStatement_parameter_value(struct BoltPreparedStatement* prepared, int32_t index)
+{
+    return BoltList_value(prepared->values, index);
+}
+
+int BoltProtocolV1_load_prepared(struct BoltConnection* connection, struct BoltPreparedStatement* prepared)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    for (int32_t i = 0; i < prepared->keys->size; i++)
+    {
+        if (BoltValue_type(BoltList_value(prepared->keys, i)) != BOLT_BYTE_ARRAY)
+        {
+            return -1;
+        }
+    }
+    int extent = state->tx_buffer->extent;
+    BoltBuffer_load(state->tx_buffer, prepared->header->data, BoltBuffer_unloadable(prepared->header));
+    for (int32_t i = 0; i < prepared->keys->size; i++)
+    {
+        struct BoltValue* key = BoltList_value(prepared->keys, i);
+        BoltBuffer_load(state->tx_buffer, BoltByteArray_get_all(key), key->size);
+        if (BoltProtocolV1_load(connection, BoltList_value(prepared->values, i)) == -1)
+        {
+            // Take back the partly loaded request, leaving nothing behind
+            BoltProtocolV1_truncate_request(connection, extent);
+            return -1;
+        }
+    }
+    return _enqueue(connection);
+}
+
+void BoltProtocolV1_init_encoder(struct BoltConnection* encoder, struct BoltProtocolV1State* state,
+                                 struct BoltBuffer* buffer, int32_t protocol_version)
+{
+    memset(state, 0, sizeof(struct BoltProtocolV1State));
+    state->tx_buffer = buffer;
+    state->required_version = 1;
+    memset(encoder, 0, sizeof(struct BoltConnection));
+    encoder->protocol_version = protocol_version;
+    encoder->protocol_state = state;
+}
+
+int BoltValue_freeze(struct BoltValue* value)
+{
+    if (value->flags & BOLT_VALUE_FROZEN)
+    {
+        return 0;
+    }
+    if (BoltValue_type(value) == BOLT_REQUEST)
+    {
+        return -1;
+    }
+    struct BoltProtocolV1State state;
+    struct BoltConnection connection;
+    // Encode with the latest version served here, so that nothing goes
+    // unencoded, and note where that makes it unfit for older ones
+    BoltProtocolV1_init_encoder(&connection, &state, BoltBuffer_create(NULL, 256), 2);
+    int status = BoltProtocolV1_load(&connection, value);
+    if (status == 0)
+    {
+        int size = BoltBuffer_unloadable(state.tx_buffer);
+        BoltValue_to_ByteArray(value, BoltBuffer_unload_target(state.tx_buffer, size), size);
+        value->flags |= BOLT_VALUE_FROZEN;
+        if (state.required_version >= 2)
+        {
+            value->flags |= BOLT_VALUE_FROZEN_V2;
+        }
+    }
+    BoltBuffer_destroy(state.tx_buffer);
+    return status;
+}
+
 int BoltProtocolV1_compile_INIT(struct BoltValue* value, const char* user_agent, const char* user, const char* password)
 {
     BoltValue_to_Request(value, 0x01, 2);
@@ -540,6 +949,8 @@ int BoltProtocolV1_compile_INIT(struct BoltValue* value, const char* user_agent,
 
 int _unload(struct BoltConnection* connection, struct BoltValue* value);
 
+int _unload_events(struct BoltBuffer* buffer, const struct BoltEventHandler* handler, void* context);
+
 int _unload_null(struct BoltConnection* connection, struct BoltValue* value)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
@@ -576,42 +987,45 @@ int _unload_boolean(struct BoltConnection* connection, struct BoltValue* value)
     return 0;
 }
 
-int _unload_integer(struct BoltConnection* connection, struct BoltValue* value)
+/**
+ * Read an Integer from the bytes following its marker.
+ *
+ * @param buffer
+ * @param marker
+ * @param x
+ * @return 0 on success, -1 if the marker is not an Integer marker
+ */
+int _unload_integer_data(struct BoltBuffer* buffer, uint8_t marker, int64_t* x)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
     if (marker < 0x80)
     {
-        BoltValue_to_Int64(value, marker);
+        *x = marker;
     }
     else if (marker >= 0xF0)
     {
-        BoltValue_to_Int64(value, marker - 0x100);
+        *x = marker - 0x100;
     }
     else if (marker == 0xC8)
     {
-        int8_t x;
-        BoltBuffer_unload_int8(state->rx_buffer, &x);
-        BoltValue_to_Int64(value, x);
+        int8_t x_8;
+        try(BoltBuffer_unload_int8(buffer, &x_8));
+        *x = x_8;
     }
     else if (marker == 0xC9)
     {
-        int16_t x;
-        BoltBuffer_unload_int16_be(state->rx_buffer, &x);
-        BoltValue_to_Int64(value, x);
+        int16_t x_16;
+        try(BoltBuffer_unload_int16_be(buffer, &x_16));
+        *x = x_16;
     }
     else if (marker == 0xCA)
     {
-        int32_t x;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &x);
-        BoltValue_to_Int64(value, x);
+        int32_t x_32;
+        try(BoltBuffer_unload_int32_be(buffer, &x_32));
+        *x = x_32;
     }
     else if (marker == 0xCB)
     {
-        int64_t x;
-        BoltBuffer_unload_int64_be(state->rx_buffer, &x);
-        BoltValue_to_Int64(value, x);
+        try(BoltBuffer_unload_int64_be(buffer, x));
     }
     else
     {
@@ -620,6 +1034,17 @@ int _unload_integer(struct BoltConnection* connection, struct BoltValue* value)
     return 0;
 }
 
+int _unload_integer(struct BoltConnection* connection, struct BoltValue* value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    uint8_t marker;
+    int64_t x;
+    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    try(_unload_integer_data(state->rx_buffer, marker, &x));
+    BoltValue_to_Int64(value, x);
+    return 0;
+}
+
 int _unload_float(struct BoltConnection* connection, struct BoltValue* value)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
@@ -638,86 +1063,350 @@ int _unload_float(struct BoltConnection* connection, struct BoltValue* value)
     return 0;
 }
 
-int _unload_string(struct BoltConnection* connection, struct BoltValue* value)
+/**
+ * Refer to data in the receive buffer rather than copying it.
+ */
+void _to_view(struct BoltValue* value, enum BoltType type, const char* data, int32_t size)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
-    if (marker >= 0x80 && marker <= 0x8F)
+    BoltValue_to_Null(value);
+    value->data.extended.as_ptr = (void*)(data);
+    value->data_size = 0;
+    value->flags |= BOLT_VALUE_VIEW;
+    _set_type(value, type, size);
+}
+
+int _is_view_size(struct BoltProtocolV1State* state, int32_t size)
+{
+    return state->view_threshold >= 0 && size >= state->view_threshold;
+}
+
+/**
+ * Read the size of a String or Bytes value from its marker and any
+ * bytes that follow, where `sized` is the first marker carrying a
+ * separate size and `tiny` the marker for an empty value (or 0 if there
+ * is no tiny form).
+ */
+int _unload_data_size(struct BoltBuffer* buffer, uint8_t marker, uint8_t tiny, uint8_t sized, int32_t* size)
+{
+    if (tiny != 0 && marker >= tiny && marker <= tiny + 0x0F)
     {
-        int32_t size;
-        size = marker & 0x0F;
-        BoltValue_to_String8(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString8_get(value), size);
-        return 0;
+        *size = marker & 0x0F;
     }
-    if (marker == 0xD0)
+    else if (marker == sized)
     {
-        uint8_t size;
-        BoltBuffer_unload_uint8(state->rx_buffer, &size);
-        BoltValue_to_String8(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString8_get(value), size);
-        return 0;
+        uint8_t size_8;
+        try(BoltBuffer_unload_uint8(buffer, &size_8));
+        *size = size_8;
     }
-    if (marker == 0xD1)
+    else if (marker == sized + 1)
     {
-        uint16_t size;
-        BoltBuffer_unload_uint16_be(state->rx_buffer, &size);
-        BoltValue_to_String8(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString8_get(value), size);
-        return 0;
+        uint16_t size_16;
+        try(BoltBuffer_unload_uint16_be(buffer, &size_16));
+        *size = size_16;
     }
-    if (marker == 0xD2)
+    else if (marker == sized + 2)
     {
-        int32_t size;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &size);
-        BoltValue_to_String8(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString8_get(value), size);
-        return 0;
+        try(BoltBuffer_unload_int32_be(buffer, size));
     }
-    BoltLog_error("[NET] Wrong marker type: %d", marker);
-    return -1;  // BOLT_ERROR_WRONG_TYPE
+    else
+    {
+        BoltLog_error("[NET] Wrong marker type: %d", marker);
+        return -1;  // BOLT_ERROR_WRONG_TYPE
+    }
+    return *size < 0 ? -1 : 0;
 }
 
-int _unload_list(struct BoltConnection* connection, struct BoltValue* value)
+int _unload_string(struct BoltConnection* connection, struct BoltValue* value)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
     int32_t size;
     BoltBuffer_unload_uint8(state->rx_buffer, &marker);
-    if (marker >= 0x90 && marker <= 0x9F)
+    try(_unload_data_size(state->rx_buffer, marker, 0x80, 0xD0, &size));
+    const char* string = BoltBuffer_unload_target(state->rx_buffer, size);
+    if (string == NULL) return -1;
+    if (_is_view_size(state, size))
     {
-        size = marker & 0x0F;
-        BoltValue_to_List(value, size);
-        for (int i = 0; i < size; i++)
-        {
-            _unload(connection, BoltList_value(value, i));
-        }
-        return 0;
+        _to_view(value, BOLT_STRING8, string, size);
     }
-    // TODO: bigger lists
-    return -1;  // BOLT_ERROR_WRONG_TYPE
+    else
+    {
+        BoltArena_to_String8(state->fetched_arena, value, string, size);
+    }
+    return 0;
 }
 
-int _unload_map(struct BoltConnection* connection, struct BoltValue* value)
+int _unload_bytes(struct BoltConnection* connection, struct BoltValue* value)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
     int32_t size;
     BoltBuffer_unload_uint8(state->rx_buffer, &marker);
-    if (marker >= 0xA0 && marker <= 0xAF)
+    try(_unload_data_size(state->rx_buffer, marker, 0, 0xCC, &size));
+    const char* data = BoltBuffer_unload_target(state->rx_buffer, size);
+    if (data == NULL) return -1;
+    if (_is_view_size(state, size))
     {
-        size = marker & 0x0F;
-        BoltValue_to_Dictionary8(value, size);
-        for (int i = 0; i < size; i++)
-        {
-            _unload(connection, BoltDictionary8_key(value, i));
-            _unload(connection, BoltDictionary8_value(value, i));
-        }
-        return 0;
+        _to_view(value, BOLT_BYTE_ARRAY, data, size);
     }
-    // TODO: bigger maps
-    return -1;  // BOLT_ERROR_WRONG_TYPE
+    else
+    {
+        BoltArena_to_ByteArray(state->fetched_arena, value, data, size);
+    }
+    return 0;
+}
+
+/**
+ * Unload a string that is likely to recur, such as a dictionary key,
+ * sharing its storage through the intern table where possible. Values
+ * other than short strings are unloaded as normal.
+ */
+int _unload_key(struct BoltConnection* connection, struct BoltValue* value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    uint8_t marker;
+    int32_t size;
+    BoltBuffer_peek_uint8(state->rx_buffer, &marker);
+    if (marker >= 0x80 && marker <= 0x8F)
+    {
+        BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+        size = marker & 0x0F;
+    }
+    else if (marker == 0xD0)
+    {
+        uint8_t size_8;
+        BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+        BoltBuffer_unload_uint8(state->rx_buffer, &size_8);
+        size = size_8;
+    }
+    else
+    {
+        return _unload(connection, value);
+    }
+    const char* string = BoltBuffer_unload_target(state->rx_buffer, size);
+    if (string == NULL) return -1;
+    if (BoltInternTable_to_String8(state->interned_keys, value, string, size) < 0)
+    {
+        BoltArena_to_String8(state->fetched_arena, value, string, size);
+    }
+    return 0;
+}
+
+/**
+ * Unload the label list of a node, interning each label.
+ */
+int _unload_labels(struct BoltConnection* connection, struct BoltValue* value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    uint8_t marker;
+    int32_t size;
+    BoltBuffer_peek_uint8(state->rx_buffer, &marker);
+    if (marker >= 0x90 && marker <= 0x9F)
+    {
+        BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+        size = marker & 0x0F;
+        BoltArena_to_List(state->fetched_arena, value, size);
+        for (int i = 0; i < size; i++)
+        {
+            _unload_key(connection, BoltList_value(value, i));
+        }
+        return 0;
+    }
+    return _unload(connection, value);
+}
+
+/**
+ * Read the size of a list or map from its marker and any bytes that
+ * follow, where `tiny` is the marker for an empty container and
+ * `sized` the first marker carrying a separate size.
+ */
+int _unload_container_size(struct BoltBuffer* buffer, uint8_t marker, uint8_t tiny, uint8_t sized,
+                           int32_t* size)
+{
+    if (marker >= tiny && marker <= tiny + 0x0F)
+    {
+        *size = marker & 0x0F;
+    }
+    else if (marker == sized)
+    {
+        uint8_t size_8;
+        try(BoltBuffer_unload_uint8(buffer, &size_8));
+        *size = size_8;
+    }
+    else if (marker == sized + 1)
+    {
+        uint16_t size_16;
+        try(BoltBuffer_unload_uint16_be(buffer, &size_16));
+        *size = size_16;
+    }
+    else if (marker == sized + 2)
+    {
+        try(BoltBuffer_unload_int32_be(buffer, size));
+    }
+    else
+    {
+        return -1;  // BOLT_ERROR_WRONG_TYPE
+    }
+    // Every entry occupies at least one byte, so anything larger than
+    // the remaining data cannot be valid
+    if (*size < 0 || *size > BoltBuffer_unloadable(buffer))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int _unload_list(struct BoltConnection* connection, struct BoltValue* value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    uint8_t marker;
+    int32_t size;
+    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    try(_unload_container_size(state->rx_buffer, marker, 0x90, 0xD4, &size));
+    BoltArena_to_List(state->fetched_arena, value, size);
+    for (int i = 0; i < size; i++)
+    {
+        _unload(connection, BoltList_value(value, i));
+    }
+    return 0;
+}
+
+int _unload_map(struct BoltConnection* connection, struct BoltValue* value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    uint8_t marker;
+    int32_t size;
+    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    try(_unload_container_size(state->rx_buffer, marker, 0xA0, 0xD8, &size));
+    BoltArena_to_Dictionary8(state->fetched_arena, value, size);
+    for (int i = 0; i < size; i++)
+    {
+        _unload_key(connection, BoltDictionary8_key(value, i));
+        _unload(connection, BoltDictionary8_value(value, i));
+    }
+    return 0;
+}
+
+int _unload_fields(struct BoltConnection* connection, struct BoltValue* value, int8_t code, int32_t size)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    BoltArena_to_Structure(state->fetched_arena, value, code, size);
+    for (int i = 0; i < size; i++)
+    {
+        if (code == 'N' && i == 1)
+        {
+            _unload_labels(connection, BoltStructure_value(value, i));
+        }
+        else
+        {
+            _unload(connection, BoltStructure_value(value, i));
+        }
+    }
+    return 0;
+}
+
+static const struct BoltEventHandler SKIP_HANDLER = {NULL};
+
+/**
+ * Unload a node or relationship through the entity map. The first
+ * occurrence of each entity within a result is decoded into storage
+ * that lasts until the end of the result. Every later occurrence skips
+ * over everything after the id and shares the nested values of the first.
+ */
+int _unload_entity(struct BoltConnection* connection, struct BoltValue* value, int8_t code, int32_t size)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct _entity_map* entities = state->entities;
+    struct BoltIdMap* ids = code == 'N' && size == 3 ? entities->nodes :
+                            code == 'R' && size == 5 ? entities->relationships :
+                            code == 'r' && size == 3 ? entities->unbound_relationships : NULL;
+    if (ids == NULL) return _unload_fields(connection, value, code, size);
+    int32_t cursor = state->rx_buffer->cursor;
+    uint8_t marker;
+    int64_t id;
+    try(BoltBuffer_unload_uint8(state->rx_buffer, &marker));
+    if (BoltProtocolV1_marker_type(marker) != BOLT_V1_INTEGER ||
+        _unload_integer_data(state->rx_buffer, marker, &id) == -1)
+    {
+        state->rx_buffer->cursor = cursor;
+        return _unload_fields(connection, value, code, size);
+    }
+    int32_t index = BoltIdMap_add(ids, id, entities->n_values);
+    if (index < entities->n_values)
+    {
+        for (int32_t i = 1; i < size; i++)
+        {
+            try(_unload_events(state->rx_buffer, &SKIP_HANDLER, NULL));
+        }
+    }
+    else
+    {
+        if (entities->n_values == entities->capacity)
+        {
+            int32_t capacity = 2 * entities->capacity;
+            entities->values = BoltAllocator_reallocate(state->allocator, entities->values,
+                                                        sizeof_n(struct BoltValue*, entities->capacity),
+                                                        sizeof_n(struct BoltValue*, capacity));
+            entities->capacity = capacity;
+        }
+        struct BoltValue* entity = BoltArena_allocate(entities->storage, sizeof(struct BoltValue));
+        memset(entity, 0, sizeof(struct BoltValue));
+        entities->values[index] = entity;
+        entities->n_values += 1;
+        // Decode the whole entity, nested values and all, into the entity
+        // storage, and without views into the receive buffer
+        struct BoltArena* fetched_arena = state->fetched_arena;
+        int32_t view_threshold = state->view_threshold;
+        state->fetched_arena = entities->storage;
+        state->view_threshold = -1;
+        state->rx_buffer->cursor = cursor;
+        int decoded = _unload_fields(connection, entity, code, size);
+        state->fetched_arena = fetched_arena;
+        state->view_threshold = view_threshold;
+        try(decoded);
+    }
+    // The copy is flagged as arena storage, like the entity itself, so
+    // the shared nested values are never freed through it
+    BoltValue_to_Null(value);
+    *value = *entities->values[index];
+    return 0;
+}
+
+/**
+ * Unload a Point2D or Point3D structure as a Float64 pair or triple,
+ * falling back to a plain structure for any with fields of the wrong
+ * types.
+ */
+int _unload_point(struct BoltConnection* connection, struct BoltValue* value, int8_t code, int32_t size)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    int32_t cursor = state->rx_buffer->cursor;
+    uint8_t marker;
+    int64_t srid;
+    double coordinates[3];
+    try(BoltBuffer_unload_uint8(state->rx_buffer, &marker));
+    int valid = BoltProtocolV1_marker_type(marker) == BOLT_V1_INTEGER &&
+                _unload_integer_data(state->rx_buffer, marker, &srid) == 0;
+    for (int32_t i = 0; valid && i < size - 1; i++)
+    {
+        valid = BoltBuffer_unload_uint8(state->rx_buffer, &marker) == 0 && marker == 0xC1 &&
+                BoltBuffer_unload_double_be(state->rx_buffer, &coordinates[i]) == 0;
+    }
+    if (!valid)
+    {
+        state->rx_buffer->cursor = cursor;
+        return _unload_fields(connection, value, code, size);
+    }
+    if (code == POINT_2D)
+    {
+        BoltArena_to_Float64Pair(state->fetched_arena, value, srid, coordinates[0], coordinates[1]);
+    }
+    else
+    {
+        BoltArena_to_Float64Triple(state->fetched_arena, value, srid,
+                                   coordinates[0], coordinates[1], coordinates[2]);
+    }
+    return 0;
 }
 
 int _unload_structure(struct BoltConnection* connection, struct BoltValue* value)
@@ -731,12 +1420,15 @@ int _unload_structure(struct BoltConnection* connection, struct BoltValue* value
     {
         size = marker & 0x0F;
         BoltBuffer_unload_int8(state->rx_buffer, &code);
-        BoltValue_to_Structure(value, code, size);
-        for (int i = 0; i < size; i++)
+        if ((code == POINT_2D && size == 3) || (code == POINT_3D && size == 4))
         {
-            _unload(connection, BoltStructure_value(value, i));
+            return _unload_point(connection, value, code, size);
         }
-        return 0;
+        if (state->entities != NULL && state->fetched_arena != NULL)
+        {
+            return _unload_entity(connection, value, code, size);
+        }
+        return _unload_fields(connection, value, code, size);
     }
     // TODO: bigger structures (that are never actually used)
     return -1;  // BOLT_ERROR_WRONG_TYPE
@@ -759,6 +1451,8 @@ int _unload(struct BoltConnection* connection, struct BoltValue* value)
             return _unload_float(connection, value);
         case BOLT_V1_STRING:
             return _unload_string(connection, value);
+        case BOLT_V1_BYTES:
+            return _unload_bytes(connection, value);
         case BOLT_V1_LIST:
             return _unload_list(connection, value);
         case BOLT_V1_MAP:
@@ -771,6 +1465,419 @@ int _unload(struct BoltConnection* connection, struct BoltValue* value)
     }
 }
 
+int _unload_events(struct BoltBuffer* buffer, const struct BoltEventHandler* handler, void* context)
+{
+    uint8_t marker;
+    int32_t size;
+    try(BoltBuffer_unload_uint8(buffer, &marker));
+    switch (BoltProtocolV1_marker_type(marker))
+    {
+        case BOLT_V1_NULL:
+            return handler->on_null == NULL || handler->on_null(context) == 0 ? 0 : -1;
+        case BOLT_V1_BOOLEAN:
+            return handler->on_boolean == NULL || handler->on_boolean(context, marker == 0xC3) == 0 ? 0 : -1;
+        case BOLT_V1_INTEGER:
+        {
+            int64_t x;
+            try(_unload_integer_data(buffer, marker, &x));
+            return handler->on_int == NULL || handler->on_int(context, x) == 0 ? 0 : -1;
+        }
+        case BOLT_V1_FLOAT:
+        {
+            double x;
+            try(BoltBuffer_unload_double_be(buffer, &x));
+            return handler->on_float == NULL || handler->on_float(context, x) == 0 ? 0 : -1;
+        }
+        case BOLT_V1_STRING:
+        {
+            try(_unload_data_size(buffer, marker, 0x80, 0xD0, &size));
+            const char* string = BoltBuffer_unload_target(buffer, size);
+            if (string == NULL) return -1;
+            return handler->on_string == NULL || handler->on_string(context, string, size) == 0 ? 0 : -1;
+        }
+        case BOLT_V1_BYTES:
+        {
+            try(_unload_data_size(buffer, marker, 0, 0xCC, &size));
+            const char* data = BoltBuffer_unload_target(buffer, size);
+            if (data == NULL) return -1;
+            return handler->on_bytes == NULL || handler->on_bytes(context, data, size) == 0 ? 0 : -1;
+        }
+        case BOLT_V1_LIST:
+        {
+            try(_unload_container_size(buffer, marker, 0x90, 0xD4, &size));
+            if (handler->on_list_begin != NULL && handler->on_list_begin(context, size) != 0) return -1;
+            break;
+        }
+        case BOLT_V1_MAP:
+        {
+            try(_unload_container_size(buffer, marker, 0xA0, 0xD8, &size));
+            if (handler->on_map_begin != NULL && handler->on_map_begin(context, size) != 0) return -1;
+            size *= 2;
+            break;
+        }
+        case BOLT_V1_STRUCTURE:
+        {
+            int8_t code;
+            if (marker > 0xBF) return -1;  // TODO: bigger structures (that are never actually used)
+            size = marker & 0x0F;
+            try(BoltBuffer_unload_int8(buffer, &code));
+            if (handler->on_struct_begin != NULL && handler->on_struct_begin(context, code, size) != 0) return -1;
+            break;
+        }
+        default:
+            return -1;  // BOLT_ERROR_WRONG_TYPE
+    }
+    for (int32_t i = 0; i < size; i++)
+    {
+        try(_unload_events(buffer, handler, context));
+    }
+    return handler->on_end == NULL || handler->on_end(context) == 0 ? 0 : -1;
+}
+
+int BoltProtocolV1_unload_value(struct BoltConnection* connection, struct BoltValue* value)
+{
+    return _unload(connection, value);
+}
+
+int BoltProtocolV1_unload_value_events(struct BoltBuffer* buffer, const struct BoltEventHandler* handler,
+                                       void* context)
+{
+    return _unload_events(buffer, handler, context);
+}
+
+int BoltProtocolV1_unload_events(struct BoltConnection* connection, const struct BoltEventHandler* handler,
+                                 void* context)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer* rx_buffer = state->rx_buffer;
+    if (BoltBuffer_unloadable(rx_buffer) < 2 || (uint8_t)(rx_buffer->data[rx_buffer->cursor]) != 0xB1 ||
+        rx_buffer->data[rx_buffer->cursor + 1] != 0x71)
+    {
+        return 0;
+    }
+    rx_buffer->cursor += 2;
+    if (_unload_events(rx_buffer, handler, context) == -1)
+    {
+        // Discard whatever is left of the message.
+        rx_buffer->cursor = rx_buffer->extent;
+        return -1;
+    }
+    return 1;
+}
+
+static void _clear_entities(struct _entity_map* entities)
+{
+    BoltArena_reset(entities->storage);
+    BoltIdMap_clear(entities->nodes);
+    BoltIdMap_clear(entities->relationships);
+    BoltIdMap_clear(entities->unbound_relationships);
+    entities->n_values = 0;
+}
+
+int BoltProtocolV1_set_stream_sink(struct BoltConnection* connection, int32_t threshold,
+                                   const struct BoltStreamSink* sink, void* context)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (sink != NULL && threshold < 0) return -1;
+    state->stream_threshold = sink == NULL ? -1 : threshold;
+    state->stream_sink = sink;
+    state->stream_context = context;
+    if (sink != NULL && state->stream_chunk == NULL)
+    {
+        state->stream_chunk = BoltAllocator_allocate(state->allocator, MAX_CHUNK_SIZE);
+    }
+    return 0;
+}
+
+void BoltProtocolV1_begin_stream(struct BoltConnection* connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    memset(&state->stream, 0, sizeof(struct _stream_scanner));
+}
+
+/**
+ * Find the size of the header of a value from its marker, or -1 if the
+ * marker is not recognised.
+ */
+static int _header_size(uint8_t marker)
+{
+    if (marker < 0xB0 || marker >= 0xF0) return 1;
+    if (marker <= 0xBF) return 2;
+    switch (marker)
+    {
+        case 0xC0:
+        case 0xC2:
+        case 0xC3:
+        case 0xD7:
+        case 0xDB:
+        case 0xDF:
+            return 1;
+        case 0xC1:
+        case 0xCB:
+            return 9;
+        case 0xC8:
+        case 0xCC:
+        case 0xD0:
+        case 0xD4:
+        case 0xD8:
+            return 2;
+        case 0xC9:
+        case 0xCD:
+        case 0xD1:
+        case 0xD5:
+        case 0xD9:
+        case 0xDC:
+            return 3;
+        case 0xDD:
+            return 4;
+        case 0xCA:
+        case 0xCE:
+        case 0xD2:
+        case 0xD6:
+        case 0xDA:
+            return 5;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Find the size of the data following a complete header, for strings
+ * and byte arrays (every other value has none of its own).
+ */
+static int32_t _payload_size(const uint8_t* header)
+{
+    uint8_t marker = header[0];
+    if (marker >= 0x80 && marker <= 0x8F) return marker & 0x0F;
+    switch (marker)
+    {
+        case 0xCC:
+        case 0xD0:
+            return header[1];
+        case 0xCD:
+        case 0xD1:
+            return (int32_t)(header[1] << 8 | header[2]);
+        case 0xCE:
+        case 0xD2:
+            return (int32_t)((uint32_t)header[1] << 24 | (uint32_t)header[2] << 16 |
+                             (uint32_t)header[3] << 8 | header[4]);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Find the number of nested items following a complete header, for
+ * lists, maps (counting keys and values separately) and structures, or
+ * -1 for any other value.
+ */
+static int32_t _container_size(const uint8_t* header)
+{
+    uint8_t marker = header[0];
+    if (marker >= 0x90 && marker <= 0x9F) return marker & 0x0F;
+    if (marker >= 0xA0 && marker <= 0xAF) return 2 * (marker & 0x0F);
+    if (marker >= 0xB0 && marker <= 0xBF) return marker & 0x0F;
+    switch (marker)
+    {
+        case 0xD4:
+        case 0xDC:
+            return header[1];
+        case 0xD8:
+            return 2 * header[1];
+        case 0xD5:
+        case 0xDD:
+            return (int32_t)(header[1] << 8 | header[2]);
+        case 0xD9:
+            return 2 * (int32_t)(header[1] << 8 | header[2]);
+        case 0xD6:
+            return (int32_t)((uint32_t)header[1] << 24 | (uint32_t)header[2] << 16 |
+                             (uint32_t)header[3] << 8 | header[4]);
+        case 0xDA:
+        {
+            int32_t size = (int32_t)((uint32_t)header[1] << 24 | (uint32_t)header[2] << 16 |
+                                     (uint32_t)header[3] << 8 | header[4]);
+            return size < 0 || size > INT32_MAX / 2 ? -2 : 2 * size;
+        }
+        case 0xD7:
+        case 0xDB:
+            // Streamed lists and maps have no size to follow
+            return -2;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Track where a complete header sits among the values of the message,
+ * and whether it is a map key.
+ *
+ * @return 1 for a map key, 0 for any other value, -1 where the
+ *         message cannot be followed (or is not a record)
+ */
+static int _stream_position(struct _stream_scanner* scanner)
+{
+    if (!scanner->started)
+    {
+        // Only records are streamed: RECORD is a structure of one field
+        scanner->started = 1;
+        if (scanner->header[0] != 0xB1 || scanner->header[1] != 0x71) return -1;
+    }
+    else
+    {
+        while (scanner->depth > 0 && scanner->remaining[scanner->depth - 1] == 0)
+        {
+            scanner->depth -= 1;
+        }
+    }
+    int is_key = 0;
+    if (scanner->depth > 0)
+    {
+        int top = scanner->depth - 1;
+        is_key = scanner->is_map[top] && scanner->remaining[top] % 2 == 0;
+        scanner->remaining[top] -= 1;
+    }
+    int32_t items = _container_size(scanner->header);
+    if (items < -1 || (items > 0 && scanner->depth == STREAM_MAX_DEPTH)) return -1;
+    if (items > 0)
+    {
+        uint8_t marker = scanner->header[0];
+        scanner->remaining[scanner->depth] = items;
+        scanner->is_map[scanner->depth] = (marker >= 0xA0 && marker <= 0xAF) || (marker >= 0xD8 && marker <= 0xDA);
+        scanner->depth += 1;
+    }
+    return is_key;
+}
+
+static void _stream_call(struct BoltProtocolV1State* state, int result)
+{
+    if (result != 0) state->stream.failed = 1;
+}
+
+/**
+ * Act on a complete header: either keep it (and its data) or, for a
+ * large enough string or byte array within a record, other than a map
+ * key, leave a placeholder in its stead and start streaming its data.
+ */
+static void _stream_header(struct BoltProtocolV1State* state)
+{
+    struct _stream_scanner* scanner = &state->stream;
+    uint8_t marker = scanner->header[0];
+    int32_t size = _payload_size(scanner->header);
+    int bytes = marker >= 0xCC && marker <= 0xCE;
+    int string = (marker >= 0x80 && marker <= 0x8F) || (marker >= 0xD0 && marker <= 0xD2);
+    int position = _stream_position(scanner);
+    if (position == -1)
+    {
+        scanner->passthrough = 1;
+    }
+    if (position == 0 && (bytes || string) && size >= state->stream_threshold)
+    {
+        const struct BoltStreamSink* sink = state->stream_sink;
+        char placeholder[8] = {(char)0xB2, BOLT_STREAMED_CODE, (char)(bytes ? BOLT_BYTE_ARRAY : BOLT_STRING8),
+                               (char)0xCA, (char)(size >> 24), (char)(size >> 16), (char)(size >> 8), (char)size};
+        BoltBuffer_load(state->rx_buffer, placeholder, sizeof(placeholder));
+        if (!scanner->failed && sink->on_begin != NULL)
+        {
+            _stream_call(state, sink->on_begin(state->stream_context, bytes ? BOLT_BYTE_ARRAY : BOLT_STRING8, size));
+        }
+        scanner->stream = size;
+        if (size == 0 && !scanner->failed && sink->on_end != NULL)
+        {
+            _stream_call(state, sink->on_end(state->stream_context));
+        }
+    }
+    else
+    {
+        BoltBuffer_load(state->rx_buffer, (const char*)(scanner->header), scanner->header_size);
+        scanner->keep = size;
+    }
+    scanner->header_size = 0;
+    scanner->header_needed = 0;
+}
+
+void BoltProtocolV1_stream_chunk(struct BoltConnection* connection, const char* data, int size)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct _stream_scanner* scanner = &state->stream;
+    const struct BoltStreamSink* sink = state->stream_sink;
+    while (size > 0)
+    {
+        if (scanner->passthrough)
+        {
+            BoltBuffer_load(state->rx_buffer, data, size);
+            return;
+        }
+        if (scanner->keep > 0)
+        {
+            int n = scanner->keep < size ? scanner->keep : size;
+            BoltBuffer_load(state->rx_buffer, data, n);
+            scanner->keep -= n;
+            data += n;
+            size -= n;
+        }
+        else if (scanner->stream > 0)
+        {
+            int n = scanner->stream < size ? scanner->stream : size;
+            if (!scanner->failed && sink->on_data != NULL)
+            {
+                _stream_call(state, sink->on_data(state->stream_context, data, n));
+            }
+            scanner->stream -= n;
+            if (scanner->stream == 0 && !scanner->failed && sink->on_end != NULL)
+            {
+                _stream_call(state, sink->on_end(state->stream_context));
+            }
+            data += n;
+            size -= n;
+        }
+        else
+        {
+            if (scanner->header_size == 0)
+            {
+                scanner->header_needed = _header_size((uint8_t)(data[0]));
+                if (scanner->header_needed == -1)
+                {
+                    scanner->passthrough = 1;
+                    continue;
+                }
+            }
+            scanner->header[scanner->header_size++] = (uint8_t)(data[0]);
+            data += 1;
+            size -= 1;
+            if (scanner->header_size == scanner->header_needed)
+            {
+                _stream_header(state);
+            }
+        }
+    }
+}
+
+int BoltProtocolV1_end_stream(struct BoltConnection* connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state->stream.failed)
+    {
+        state->rx_buffer->cursor = state->rx_buffer->extent;
+        return -1;
+    }
+    return 0;
+}
+
+int BoltProtocolV1_set_entity_sharing(struct BoltConnection* connection, int enabled)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state->fetched_arena == NULL) return -1;
+    if (!enabled)
+    {
+        _destroy_entities(state);
+    }
+    else if (state->entities == NULL)
+    {
+        state->entities = _create_entities(state->allocator);
+    }
+    return 0;
+}
+
 int BoltProtocolV1_unload(struct BoltConnection* connection)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
@@ -787,7 +1894,17 @@ int BoltProtocolV1_unload(struct BoltConnection* connection)
         return -1;
     }
     size = marker & 0x0F;
-    struct BoltValue* received = ((struct BoltProtocolV1State*)(connection->protocol_state))->fetched;
+    struct BoltValue* received = state->fetched;
+    if (state->fetched_arena != NULL)
+    {
+        // Everything nested within the previous value lives in the arena,
+        // so letting go of that value and resetting the arena is all that
+        // is needed to recycle it.
+        BoltValue_to_Null(received);
+        BoltArena_reset(state->fetched_arena);
+    }
+    // Otherwise, the previous value is reformatted in place, reusing
+    // as much of its storage as possible.
     BoltBuffer_unload_uint8(state->rx_buffer, &code);
     if (code == 0x71)  // RECORD
     {
@@ -796,22 +1913,25 @@ int BoltProtocolV1_unload(struct BoltConnection* connection)
             _unload(connection, received);
             if (size > 1)
             {
-                struct BoltValue* black_hole = BoltValue_create();
+                struct BoltValue black_hole;
+                memset(&black_hole, 0, sizeof(struct BoltValue));
                 for (int i = 1; i < size; i++)
                 {
-                    _unload(connection, black_hole);
+                    _unload(connection, &black_hole);
                 }
-                BoltValue_destroy(black_hole);
+                BoltValue_to_Null(&black_hole);
             }
         }
-        else
-        {
-            BoltValue_to_Null(received);
-        }
     }
     else
     {
-        BoltValue_to_Summary(received, code, size);
+        if (state->entities != NULL)
+        {
+            // A summary marks the end of a result (or of a request that
+            // returns none) so nothing decoded before it is shared further
+            _clear_entities(state->entities);
+        }
+        BoltArena_to_Summary(state->fetched_arena, received, code, size);
         for (int i = 0; i < size; i++)
         {
             _unload(connection, BoltSummary_value(received, i));
@@ -832,6 +1952,10 @@ const char* BoltProtocolV1_structure_name(int16_t code)
             return "UnboundRelationship";
         case 'P':
             return "Path";
+        case POINT_2D:
+            return "Point2D";
+        case POINT_3D:
+            return "Point3D";
         default:
             return NULL;
     }
@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <connect.h>
+#include <events.h>
 
 
 enum BoltProtocolV1Type
@@ -49,12 +50,95 @@ struct _run_request
     struct BoltValue* parameters;
 };
 
+/**
+ * Data sent straight from where it lies rather than copied into a
+ * buffer: `size` bytes at `data`, to go out just before byte `offset`
+ * of the buffer.
+ */
+struct _gather_segment
+{
+    int32_t offset;
+    int32_t size;
+    const char* data;
+};
+
+struct _gather_list
+{
+    struct _gather_segment* segments;
+    int32_t size;
+    int32_t capacity;
+};
+
+/// Deepest nesting of values followed while streaming, beyond which a
+/// record is received in full
+#define STREAM_MAX_DEPTH 32
+
+/**
+ * Progress through the values of a message as it is received, chunk by
+ * chunk, for streaming large strings and byte arrays.
+ */
+struct _stream_scanner
+{
+    /// Marker (and any bytes that follow it) of the current value, as far as received
+    uint8_t header[9];
+    int header_size;
+    /// Size of the header, once known from the marker
+    int header_needed;
+    /// Bytes of the current value still to keep in the receive buffer
+    int32_t keep;
+    /// Bytes of the current value still to stream
+    int32_t stream;
+    /// Items still to come in each enclosing list, map (counting keys
+    /// and values separately) and structure, innermost last
+    int32_t remaining[STREAM_MAX_DEPTH];
+    /// Whether each enclosing container is a map
+    uint8_t is_map[STREAM_MAX_DEPTH];
+    int depth;
+    /// Set once the first value (the message structure) has been seen
+    int started;
+    /// Set where the message is not a record or the data cannot be
+    /// followed, after which all of it is kept
+    int passthrough;
+    /// Set once the sink has failed, after which streamed data is dropped
+    int failed;
+};
+
+/**
+ * Nodes and relationships decoded so far within the current result, by
+ * entity id, so that repeat occurrences can share the first.
+ */
+struct _entity_map
+{
+    /// Storage for the decoded entities, reset at the end of each result
+    struct BoltArena* storage;
+    struct BoltIdMap* nodes;
+    struct BoltIdMap* relationships;
+    struct BoltIdMap* unbound_relationships;
+    /// Decoded entities, indexed by the id maps
+    struct BoltValue** values;
+    int32_t n_values;
+    int32_t capacity;
+};
+
 struct BoltProtocolV1State
 {
+    /// Allocator used for buffers and fetched values
+    struct BoltAllocator* allocator;
+
     // These buffers exclude chunk headers.
     struct BoltBuffer* tx_buffer;
     struct BoltBuffer* rx_buffer;
 
+    /// Lowest protocol version able to carry everything loaded through a
+    /// bare encoder (see `BoltProtocolV1_init_encoder`)
+    int32_t required_version;
+
+    /// Borrowed and mapped data referenced by the request in `tx_buffer`
+    struct _gather_list pending;
+    /// Borrowed and mapped data referenced by the requests queued in the
+    /// connection transmit buffer, which go out with the next send
+    struct _gather_list queued;
+
     int next_request_id;
     int response_counter;
 
@@ -67,9 +151,47 @@ struct BoltProtocolV1State
 
     /// Holder for fetched data and metadata
     struct BoltValue* fetched;
+    /// Storage for values nested within `fetched`, reset on each fetch
+    /// (if NULL, nested values are allocated individually instead)
+    struct BoltArena* fetched_arena;
+    /// Shared storage for received dictionary keys and node labels
+    /// (if NULL, these are decoded like any other string)
+    struct BoltInternTable* interned_keys;
+    /// Minimum size of received strings and byte arrays to decode as
+    /// views into `rx_buffer` (if negative, all are copied)
+    int32_t view_threshold;
+    /// Nodes and relationships shared between the records of a result
+    /// (if NULL, every occurrence is decoded separately)
+    struct _entity_map* entities;
+    /// Minimum size of received strings and byte arrays to stream to
+    /// `stream_sink` as they arrive (if NULL, all are received in full)
+    int32_t stream_threshold;
+    const struct BoltStreamSink* stream_sink;
+    void* stream_context;
+    /// Scratch space for a received chunk, while streaming
+    char* stream_chunk;
+    struct _stream_scanner stream;
 };
 
-struct BoltProtocolV1State* BoltProtocolV1_create_state();
+/**
+ * A RUN request for a statement that is executed repeatedly.
+ *
+ * Everything except the parameter values is encoded once, up front: the
+ * RUN structure header, the statement and the parameter map header
+ * (`header`) plus each parameter key (held, encoded, as a byte array in
+ * `keys`). Loading the request then only encodes the values.
+ */
+struct BoltPreparedStatement
+{
+    struct BoltAllocator* allocator;
+    struct BoltBuffer* header;
+    struct BoltValue* keys;
+    struct BoltValue* values;
+    /// Scratch space for encoding keys
+    struct BoltBuffer* buffer;
+};
+
+struct BoltProtocolV1State* BoltProtocolV1_create_state(struct BoltAllocator* allocator);
 
 void BoltProtocolV1_destroy_state(struct BoltProtocolV1State* state);
 
@@ -89,10 +211,149 @@ int BoltProtocolV1_load_bytes(struct BoltConnection* connection, const char* str
 
 int BoltProtocolV1_load_string(struct BoltConnection* connection, const char* string, int32_t size);
 
+int BoltProtocolV1_load_list_header(struct BoltConnection* connection, int32_t size);
+
+int BoltProtocolV1_load_map_header(struct BoltConnection* connection, int32_t size);
+
 int BoltProtocolV1_load(struct BoltConnection* connection, struct BoltValue* value);
 
+/**
+ * Set up a bare connection for encoding values straight into a buffer,
+ * outside of any request. Its protocol state has nothing but a transmit
+ * buffer, so nothing loaded through it is ever enqueued or sent.
+ *
+ * @param encoder the connection to set up
+ * @param state storage for its protocol state
+ * @param buffer the buffer to encode into
+ * @param protocol_version the version to encode for, which decides
+ *        whether values such as points can be encoded at all
+ */
+void BoltProtocolV1_init_encoder(struct BoltConnection* encoder, struct BoltProtocolV1State* state,
+                                 struct BoltBuffer* buffer, int32_t protocol_version);
+
+/**
+ * Start loading a RUN request, up to and including the header of its
+ * parameter map. The parameters are then loaded one key and value at a
+ * time, and the request is finished with `BoltProtocolV1_end_request`.
+ *
+ * @param connection
+ * @param statement
+ * @param size
+ * @param n_parameters
+ * @return 0 on success, -1 if any size is out of range
+ */
+int BoltProtocolV1_begin_run(struct BoltConnection* connection, const char* statement, int32_t size,
+                             int32_t n_parameters);
+
+/**
+ * Finish loading a request started by hand, queueing it to be sent.
+ *
+ * @param connection
+ * @return request ID
+ */
+int BoltProtocolV1_end_request(struct BoltConnection* connection);
+
+/**
+ * Create a prepared RUN request.
+ *
+ * @param connection
+ * @param statement
+ * @param size
+ * @param n_parameters
+ * @return the prepared statement, or NULL if it cannot be encoded
+ */
+struct BoltPreparedStatement* BoltProtocolV1_prepare(struct BoltConnection* connection, const char* statement,
+                                                     int32_t size, int32_t n_parameters);
+
+/**
+ * Load a prepared RUN request, encoding only the parameter values.
+ *
+ * @param connection
+ * @param prepared
+ * @return request ID, or -1 if a key is missing or a value cannot be encoded
+ */
+int BoltProtocolV1_load_prepared(struct BoltConnection* connection, struct BoltPreparedStatement* prepared);
+
 int BoltProtocolV1_compile_INIT(struct BoltValue* value, const char* user_agent, const char* user, const char* password);
 
+/**
+ * Take the end of the request being encoded back off the transmit
+ * buffer, along with any borrowed data it referenced.
+ *
+ * @param connection
+ * @param extent the extent of the transmit buffer to go back to
+ */
+void BoltProtocolV1_truncate_request(struct BoltConnection* connection, int extent);
+
+/**
+ * Stream received strings and byte arrays of at least a given size to a
+ * sink, or stop streaming if the sink is NULL.
+ *
+ * @param connection
+ * @param threshold
+ * @param sink
+ * @param context
+ * @return 0 on success, -1 if the threshold is negative
+ */
+int BoltProtocolV1_set_stream_sink(struct BoltConnection* connection, int32_t threshold,
+                                   const struct BoltStreamSink* sink, void* context);
+
+/**
+ * Prepare to receive a message through the stream sink.
+ *
+ * @param connection
+ */
+void BoltProtocolV1_begin_stream(struct BoltConnection* connection);
+
+/**
+ * Receive a chunk of a message through the stream sink, appending to the
+ * receive buffer everything that is not streamed.
+ *
+ * @param connection
+ * @param data
+ * @param size
+ */
+void BoltProtocolV1_stream_chunk(struct BoltConnection* connection, const char* data, int size);
+
+/**
+ * Finish receiving a message through the stream sink.
+ *
+ * @param connection
+ * @return 0 on success, -1 if the sink failed (in which case the message
+ *         is discarded)
+ */
+int BoltProtocolV1_end_stream(struct BoltConnection* connection);
+
+/**
+ * Turn sharing of received nodes and relationships on or off.
+ *
+ * @param connection
+ * @param enabled
+ * @return 0 on success, -1 if values are not decoded into an arena
+ */
+int BoltProtocolV1_set_entity_sharing(struct BoltConnection* connection, int enabled);
+
+/**
+ * Unload a single value from the receive buffer, outside of any message.
+ *
+ * @param connection
+ * @param value
+ * @return 0 on success, -1 on error
+ */
+int BoltProtocolV1_unload_value(struct BoltConnection* connection, struct BoltValue* value);
+
+/**
+ * Unload a single value from a buffer as a sequence of events delivered
+ * to a handler (see `BoltProtocolV1_unload_events`).
+ *
+ * @param buffer
+ * @param handler
+ * @param context
+ * @return 0 on success, -1 on error or if the handler stopped decoding
+ */
+int BoltProtocolV1_unload_value_events(struct BoltBuffer* buffer, const struct BoltEventHandler* handler,
+                                       void* context);
+
 /**
  * Top-level unload.
  *
@@ -104,6 +365,20 @@ int BoltProtocolV1_compile_INIT(struct BoltValue* value, const char* user_agent,
  */
 int BoltProtocolV1_unload(struct BoltConnection* connection);
 
+/**
+ * Unload a received record as a sequence of events delivered to a
+ * handler, leaving any other message untouched.
+ *
+ * @param connection
+ * @param handler
+ * @param context passed to every callback
+ * @return 1 if a record was delivered, 0 if the message is not a record
+ *         (to be unloaded by `BoltProtocolV1_unload` instead), -1 if the
+ *         record cannot be decoded or a callback stops it
+ */
+int BoltProtocolV1_unload_events(struct BoltConnection* connection, const struct BoltEventHandler* handler,
+                                 void* context);
+
 const char* BoltProtocolV1_structure_name(int16_t code);
 
 const char* BoltProtocolV1_request_name(int16_t code);
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <sys/socket.h>
+#include "buffer.h"
+#include "reader.h"
+#include "mem.h"
+#include "protocol/v1.h"
+
+
+#define LOAD(variable) __atomic_load_n(&(variable), __ATOMIC_SEQ_CST)
+#define STORE(variable, value) __atomic_store_n(&(variable), value, __ATOMIC_SEQ_CST)
+
+#define INITIAL_SLOT_BUFFER_SIZE 1024
+
+
+struct BoltReaderSlot
+{
+    struct BoltValue* value;
+    /// Received message data (decoder threads only)
+    struct BoltBuffer* raw;
+    int status;
+    int ready;
+    enum BoltConnectionStatus connection_status;
+    enum BoltConnectionError connection_error;
+};
+
+
+static int _is_full(struct BoltReader* reader)
+{
+    return reader->head - LOAD(reader->tail) == reader->capacity;
+}
+
+static int _is_ready(struct BoltReader* reader)
+{
+    return reader->tail != LOAD(reader->head) && LOAD(reader->slots[reader->tail % reader->capacity].ready);
+}
+
+static int _is_exhausted(struct BoltReader* reader)
+{
+    return LOAD(reader->finished) && reader->tail == LOAD(reader->head);
+}
+
+static int _is_claimable(struct BoltReader* reader)
+{
+    return LOAD(reader->claimed) != LOAD(reader->head);
+}
+
+/**
+ * Wake the other side if (and only if) it is asleep. The waiting flag
+ * is always set before the queue is checked for the last time, so either
+ * the sleeper sees the new queue position or we see the flag.
+ */
+static void _wake(struct BoltReader* reader, int* waiting, pthread_cond_t* condition)
+{
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&reader->mutex);
+        pthread_cond_signal(condition);
+        pthread_mutex_unlock(&reader->mutex);
+    }
+}
+
+static void _wake_all(struct BoltReader* reader)
+{
+    pthread_mutex_lock(&reader->mutex);
+    pthread_cond_broadcast(&reader->not_full);
+    pthread_cond_broadcast(&reader->not_empty);
+    pthread_cond_broadcast(&reader->received);
+    pthread_mutex_unlock(&reader->mutex);
+}
+
+static void* _run(void* argument)
+{
+    struct BoltReader* reader = argument;
+    struct BoltConnection* connection = &reader->shadow;
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    int status = 0;
+    while (status == 0)
+    {
+        while (_is_full(reader) && !LOAD(reader->stopping))
+        {
+            pthread_mutex_lock(&reader->mutex);
+            STORE(reader->reader_waiting, 1);
+            if (_is_full(reader) && !LOAD(reader->stopping))
+            {
+                pthread_cond_wait(&reader->not_full, &reader->mutex);
+            }
+            STORE(reader->reader_waiting, 0);
+            pthread_mutex_unlock(&reader->mutex);
+        }
+        if (LOAD(reader->stopping))
+        {
+            break;
+        }
+        struct BoltReaderSlot* slot = &reader->slots[reader->head % reader->capacity];
+        if (reader->n_decoders > 0)
+        {
+            // receive directly into the slot, leaving decoding to a decoder thread
+            state->rx_buffer = slot->raw;
+            slot->raw->cursor = 0;
+            slot->raw->extent = 0;
+        }
+        status = _fetch_message_b(connection);
+        if (status == 0 && reader->n_decoders == 0)
+        {
+            state->fetched = slot->value;
+            BoltProtocolV1_unload(connection);
+        }
+        slot->status = status;
+        slot->connection_status = connection->status;
+        slot->connection_error = connection->error;
+        STORE(slot->ready, reader->n_decoders == 0);
+        STORE(reader->head, reader->head + 1);
+        if (reader->n_decoders == 0)
+        {
+            _wake(reader, &reader->consumer_waiting, &reader->not_empty);
+        }
+        else
+        {
+            _wake(reader, &reader->decoders_waiting, &reader->received);
+        }
+    }
+    STORE(reader->finished, 1);
+    _wake_all(reader);
+    return NULL;
+}
+
+static void* _decode(void* argument)
+{
+    struct BoltReaderDecoder* decoder = argument;
+    struct BoltReader* reader = decoder->reader;
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(&decoder->shadow);
+    while (!LOAD(reader->stopping))
+    {
+        size_t claim = LOAD(reader->claimed);
+        if (claim == LOAD(reader->head))
+        {
+            if (LOAD(reader->finished) && !_is_claimable(reader))
+            {
+                break;
+            }
+            pthread_mutex_lock(&reader->mutex);
+            __atomic_add_fetch(&reader->decoders_waiting, 1, __ATOMIC_SEQ_CST);
+            if (!_is_claimable(reader) && !LOAD(reader->finished) && !LOAD(reader->stopping))
+            {
+                pthread_cond_wait(&reader->received, &reader->mutex);
+            }
+            __atomic_sub_fetch(&reader->decoders_waiting, 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&reader->mutex);
+            continue;
+        }
+        if (!__atomic_compare_exchange_n(&reader->claimed, &claim, claim + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        {
+            continue;
+        }
+        struct BoltReaderSlot* slot = &reader->slots[claim % reader->capacity];
+        if (slot->status == 0)
+        {
+            state->rx_buffer = slot->raw;
+            state->fetched = slot->value;
+            BoltProtocolV1_unload(&decoder->shadow);
+        }
+        STORE(slot->ready, 1);
+        _wake(reader, &reader->consumer_waiting, &reader->not_empty);
+    }
+    return NULL;
+}
+
+static void _create_decoder(struct BoltReader* reader, struct BoltReaderDecoder* decoder)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_create_state(reader->connection->allocator);
+    decoder->reader = reader;
+    decoder->shadow = *reader->connection;
+    decoder->shadow.protocol_state = state;
+    decoder->fetched = state->fetched;
+    decoder->rx_buffer = state->rx_buffer;
+    decoder->fetched_arena = state->fetched_arena;
+    state->fetched_arena = NULL;
+}
+
+static void _destroy_decoder(struct BoltReaderDecoder* decoder)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(&decoder->shadow);
+    state->fetched = decoder->fetched;
+    state->rx_buffer = decoder->rx_buffer;
+    state->fetched_arena = decoder->fetched_arena;
+    BoltProtocolV1_destroy_state(state);
+}
+
+static void _destroy(struct BoltReader* reader)
+{
+    struct BoltConnection* connection = reader->connection;
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    state->fetched = reader->fetched;
+    state->fetched_arena = reader->fetched_arena;
+    state->rx_buffer = reader->rx_buffer;
+    state->view_threshold = reader->view_threshold;
+    for (int i = 0; i < reader->n_decoders; i++)
+    {
+        _destroy_decoder(&reader->decoders[i]);
+    }
+    for (size_t i = 0; i < reader->capacity; i++)
+    {
+        BoltValue_destroy(reader->slots[i].value);
+        if (reader->slots[i].raw != NULL)
+        {
+            BoltBuffer_destroy(reader->slots[i].raw);
+        }
+    }
+    pthread_cond_destroy(&reader->received);
+    pthread_cond_destroy(&reader->not_full);
+    pthread_cond_destroy(&reader->not_empty);
+    pthread_mutex_destroy(&reader->mutex);
+    if (reader->decoders != NULL)
+    {
+        BoltAllocator_deallocate(connection->allocator, reader->decoders,
+                                 reader->n_decoders * sizeof(struct BoltReaderDecoder));
+    }
+    BoltAllocator_deallocate(connection->allocator, reader->slots, reader->capacity * sizeof(struct BoltReaderSlot));
+    BoltAllocator_deallocate(connection->allocator, reader, sizeof(struct BoltReader));
+}
+
+struct BoltReader* BoltReader_start(struct BoltConnection* connection, int capacity, int n_decoders)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state == NULL || capacity < 1 || n_decoders < 0)
+    {
+        return NULL;
+    }
+    if (state->stream_sink != NULL)
+    {
+        // Sink callbacks would otherwise be made on the reader thread
+        return NULL;
+    }
+    struct BoltReader* reader = BoltAllocator_allocate(connection->allocator, sizeof(struct BoltReader));
+    reader->connection = connection;
+    reader->shadow = *connection;
+    reader->started = 0;
+    reader->capacity = (size_t)(capacity);
+    reader->slots = BoltAllocator_allocate(connection->allocator, reader->capacity * sizeof(struct BoltReaderSlot));
+    for (size_t i = 0; i < reader->capacity; i++)
+    {
+        reader->slots[i].value = BoltValue_create();
+        reader->slots[i].raw = n_decoders == 0 ? NULL : BoltBuffer_create(connection->allocator, INITIAL_SLOT_BUFFER_SIZE);
+        reader->slots[i].status = 0;
+        reader->slots[i].ready = 0;
+    }
+    reader->head = 0;
+    reader->claimed = 0;
+    reader->tail = 0;
+    reader->holding = 0;
+    pthread_mutex_init(&reader->mutex, NULL);
+    pthread_cond_init(&reader->not_empty, NULL);
+    pthread_cond_init(&reader->not_full, NULL);
+    pthread_cond_init(&reader->received, NULL);
+    reader->reader_waiting = 0;
+    reader->consumer_waiting = 0;
+    reader->decoders_waiting = 0;
+    reader->stopping = 0;
+    reader->finished = 0;
+    // Each message is decoded into a queue slot of its own, so nothing may
+    // be shared between consecutive messages: neither the fetched arena
+    // (which is reset per message) nor the receive buffer (which views
+    // would refer to).
+    reader->fetched = state->fetched;
+    reader->fetched_arena = state->fetched_arena;
+    reader->rx_buffer = state->rx_buffer;
+    reader->view_threshold = state->view_threshold;
+    state->fetched_arena = NULL;
+    state->view_threshold = -1;
+    reader->n_decoders = n_decoders;
+    reader->n_started_decoders = 0;
+    reader->decoders = n_decoders == 0 ? NULL :
+                       BoltAllocator_allocate(connection->allocator, n_decoders * sizeof(struct BoltReaderDecoder));
+    for (int i = 0; i < n_decoders; i++)
+    {
+        _create_decoder(reader, &reader->decoders[i]);
+    }
+    for (int i = 0; i < n_decoders; i++)
+    {
+        if (pthread_create(&reader->decoders[i].thread, NULL, _decode, &reader->decoders[i]) != 0)
+        {
+            BoltReader_stop(reader);
+            return NULL;
+        }
+        reader->n_started_decoders += 1;
+    }
+    if (pthread_create(&reader->thread, NULL, _run, reader) != 0)
+    {
+        BoltReader_stop(reader);
+        return NULL;
+    }
+    reader->started = 1;
+    BoltLog_info("bolt: Started reader thread (%d messages ahead, %d decoders)", capacity, n_decoders);
+    return reader;
+}
+
+void BoltReader_stop(struct BoltReader* reader)
+{
+    STORE(reader->stopping, 1);
+    _wake_all(reader);
+    if (reader->started)
+    {
+        shutdown(reader->connection->socket, SHUT_RDWR);
+        pthread_join(reader->thread, NULL);
+    }
+    for (int i = 0; i < reader->n_started_decoders; i++)
+    {
+        pthread_join(reader->decoders[i].thread, NULL);
+    }
+    BoltLog_info("bolt: Stopped reader thread");
+    _destroy(reader);
+}
+
+int BoltReader_next_b(struct BoltReader* reader, struct BoltValue** fetched)
+{
+    if (reader->holding)
+    {
+        STORE(reader->tail, reader->tail + 1);
+        reader->holding = 0;
+        _wake(reader, &reader->reader_waiting, &reader->not_full);
+    }
+    while (!_is_ready(reader))
+    {
+        if (_is_exhausted(reader))
+        {
+            return -1;
+        }
+        pthread_mutex_lock(&reader->mutex);
+        STORE(reader->consumer_waiting, 1);
+        if (!_is_ready(reader) && !_is_exhausted(reader))
+        {
+            pthread_cond_wait(&reader->not_empty, &reader->mutex);
+        }
+        STORE(reader->consumer_waiting, 0);
+        pthread_mutex_unlock(&reader->mutex);
+    }
+    struct BoltReaderSlot* slot = &reader->slots[reader->tail % reader->capacity];
+    reader->holding = 1;
+    *fetched = slot->value;
+    if (slot->status == -1)
+    {
+        // only now does the consumer see the failure
+        reader->connection->status = slot->connection_status;
+        reader->connection->error = slot->connection_error;
+    }
+    return slot->status;
+}
+
+struct BoltValue* BoltReader_fetched(struct BoltReader* reader)
+{
+    if (reader->holding)
+    {
+        return reader->slots[reader->tail % reader->capacity].value;
+    }
+    return reader->fetched;
+}
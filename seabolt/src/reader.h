@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_READER
+#define SEABOLT_READER
+
+#include <pthread.h>
+#include <stddef.h>
+#include <connect.h>
+#include <values.h>
+
+
+struct BoltReaderSlot;
+
+/**
+ * A decoder thread, with protocol state of its own.
+ */
+struct BoltReaderDecoder
+{
+    struct BoltReader* reader;
+    /// Copy of the connection, pointing at the decoder's protocol state
+    struct BoltConnection shadow;
+    pthread_t thread;
+    // Decoder state storage set aside while the thread is running
+    struct BoltValue* fetched;
+    struct BoltBuffer* rx_buffer;
+    struct BoltArena* fetched_arena;
+};
+
+/**
+ * A background thread that receives and decodes messages ahead of the
+ * consumer, handing them over through a bounded queue.
+ *
+ * The queue positions are only ever advanced by one side each (`head`
+ * by the reader thread, `tail` by the consumer) so neither side takes a
+ * lock while there is work to do. The mutex and condition variables are
+ * only used to sleep when the queue is full or empty. Once the queue is
+ * full the reader thread stops reading from the socket, leaving the
+ * server to block on TCP flow control.
+ *
+ * Where decoder threads are used, the reader thread only receives and
+ * dechunks each message into its queue slot. Decoders claim received
+ * slots in turn (advancing `claimed`) and mark them `ready` once decoded,
+ * in whatever order they finish. The consumer always waits for the slot
+ * at `tail`, so the queue doubles as a reorder buffer and messages are
+ * still delivered in the order received.
+ */
+struct BoltReader
+{
+    struct BoltConnection* connection;
+    /// Copy of the connection used by the reader thread, so that any
+    /// change of status is only passed on when the consumer reaches it
+    struct BoltConnection shadow;
+    pthread_t thread;
+    int started;
+
+    struct BoltReaderDecoder* decoders;
+    int n_decoders;
+    int n_started_decoders;
+
+    struct BoltReaderSlot* slots;
+    size_t capacity;
+    size_t head;
+    size_t claimed;
+    size_t tail;
+    /// Whether the consumer is still using the slot at `tail`
+    int holding;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t received;
+    int reader_waiting;
+    int consumer_waiting;
+    int decoders_waiting;
+    int stopping;
+    int finished;
+
+    // Protocol state set aside while the reader thread is running
+    struct BoltValue* fetched;
+    struct BoltArena* fetched_arena;
+    struct BoltBuffer* rx_buffer;
+    int32_t view_threshold;
+};
+
+
+/**
+ * Start a reader thread for a connection.
+ *
+ * @param connection an insecure Bolt v1 connection
+ * @param capacity the maximum number of messages to receive ahead
+ * @param n_decoders the number of decoder threads, or 0 to decode on
+ *                   the reader thread
+ * @return the new reader, or NULL if the connection streams to a sink
+ *         (see `BoltConnection_set_stream_sink`) or the threads cannot
+ *         be started
+ */
+struct BoltReader* BoltReader_start(struct BoltConnection* connection, int capacity, int n_decoders);
+
+/**
+ * Stop a reader thread, shutting down the connection socket so that
+ * the thread is not left blocked in a receive call, and destroy the
+ * reader.
+ *
+ * @param reader
+ */
+void BoltReader_stop(struct BoltReader* reader);
+
+/**
+ * Take the next decoded message, blocking until one is available.
+ *
+ * The previously taken message is released back to the reader thread.
+ *
+ * @param reader
+ * @param fetched pointer to receive the decoded message
+ * @return 0 on success, -1 if the reader thread failed or has finished
+ */
+int BoltReader_next_b(struct BoltReader* reader, struct BoltValue** fetched);
+
+/**
+ * Obtain the message most recently taken with `BoltReader_next_b`.
+ *
+ * @param reader
+ * @return
+ */
+struct BoltValue* BoltReader_fetched(struct BoltReader* reader);
+
+/**
+ * Receive and dechunk one whole message into the protocol receive
+ * buffer (implemented alongside the other transport functions).
+ *
+ * @param connection
+ * @return 0 on success, -1 on transport failure
+ */
+int _fetch_message_b(struct BoltConnection* connection);
+
+
+#endif // SEABOLT_READER
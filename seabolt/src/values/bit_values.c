@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <values.h>
 #include <assert.h>
 #include "mem.h"
@@ -72,6 +74,42 @@ void BoltValue_to_ByteArray(struct BoltValue* value, char* array, int32_t size)
     }
 }
 
+void BoltValue_to_BorrowedByteArray(struct BoltValue* value, const char* array, int32_t size)
+{
+    _format(value, BOLT_BYTE_ARRAY, size, NULL, 0);
+    value->data.extended.as_ptr = (void*)(array);
+    value->flags |= BOLT_VALUE_BORROWED;
+}
+
+int BoltValue_to_MappedByteArray(struct BoltValue* value, int fd, int64_t offset, int32_t size)
+{
+    if (offset < 0 || size < 0)
+    {
+        return -1;
+    }
+    if (size == 0)
+    {
+        BoltValue_to_ByteArray(value, NULL, 0);
+        return 0;
+    }
+    // Mappings must start on a page boundary
+    int64_t page_size = sysconf(_SC_PAGESIZE);
+    int64_t skip = offset % page_size;
+    size_t data_size = (size_t)(skip + size);
+    void* mapping = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, (off_t)(offset - skip));
+    if (mapping == MAP_FAILED)
+    {
+        return -1;
+    }
+    madvise(mapping, data_size, MADV_SEQUENTIAL);
+    _format(value, BOLT_BYTE_ARRAY, size, NULL, 0);
+    value->data.extended.as_ptr = (char*)(mapping) + skip;
+    value->data.as_ptr[1] = mapping;
+    value->data_size = data_size;
+    value->flags |= BOLT_VALUE_MAPPED;
+    return 0;
+}
+
 char BoltBit_get(const struct BoltValue* value)
 {
     return to_bit(value->data.as_char[0]);
@@ -84,21 +122,21 @@ char BoltByte_get(const struct BoltValue* value)
 
 char BoltBitArray_get(const struct BoltValue* value, int32_t index)
 {
-    const char* data = value->size <= sizeof(value->data) / sizeof(char) ?
+    const char* data = value->size <= sizeof(value->data) / sizeof(char) && !(value->flags & BOLT_VALUE_EXTERNAL) ?
                        value->data.as_char : value->data.extended.as_char;
     return to_bit(data[index]);
 }
 
 char BoltByteArray_get(const struct BoltValue* value, int32_t index)
 {
-    const char* data = value->size <= sizeof(value->data) / sizeof(char) ?
+    const char* data = value->size <= sizeof(value->data) / sizeof(char) && !(value->flags & BOLT_VALUE_EXTERNAL) ?
                        value->data.as_char : value->data.extended.as_char;
     return data[index];
 }
 
 char* BoltByteArray_get_all(struct BoltValue* value)
 {
-    return value->size <= sizeof(value->data) / sizeof(char) ?
+    return value->size <= sizeof(value->data) / sizeof(char) && !(value->flags & BOLT_VALUE_EXTERNAL) ?
            value->data.as_char : value->data.extended.as_char;
 }
 
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stddef.h>
+#include <string.h>
+#include <compact.h>
+#include "mem.h"
+
+
+#define INLINE_SIZE 8
+
+/**
+ * Each compact tree is preceded by a header recording the size of its
+ * block, padded so that the values that follow remain 16-byte aligned.
+ */
+struct _compact_header
+{
+    size_t memory;
+    size_t padding;
+};
+
+#define header_of(value) ((struct _compact_header*)(value) - 1)
+
+
+static int _children(const struct BoltValue* value)
+{
+    switch (BoltValue_type(value))
+    {
+        case BOLT_LIST:
+        case BOLT_STRUCTURE:
+        case BOLT_SUMMARY:
+            return value->size;
+        case BOLT_DICTIONARY8:
+            return 2 * value->size;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Count the nested values and external bytes needed to hold a copy of
+ * a value, returning -1 if it cannot be copied.
+ */
+static int _measure(const struct BoltValue* value, size_t* n_values, size_t* n_bytes)
+{
+    switch (BoltValue_type(value))
+    {
+        case BOLT_NULL:
+        case BOLT_BIT:
+        case BOLT_INT64:
+        case BOLT_FLOAT64:
+            return 0;
+        case BOLT_STRING8:
+        case BOLT_BYTE_ARRAY:
+            if (value->size > INLINE_SIZE) *n_bytes += (size_t)(value->size);
+            return 0;
+        case BOLT_LIST:
+        case BOLT_DICTIONARY8:
+        case BOLT_STRUCTURE:
+        case BOLT_SUMMARY:
+        {
+            int n = _children(value);
+            *n_values += n;
+            for (int i = 0; i < n; i++)
+            {
+                if (_measure(&value->data.extended.as_value[i], n_values, n_bytes) == -1) return -1;
+            }
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Copy a value, drawing nested values and external bytes from the
+ * cursors given.
+ */
+static void _copy(const struct BoltValue* value, struct BoltCompactValue* target,
+                  struct BoltCompactValue** values, char** bytes)
+{
+    enum BoltType type = BoltValue_type(value);
+    target->type = (int8_t)(type);
+    target->flags = 0;
+    target->code = value->code;
+    target->size = value->size;
+    target->data.as_int64 = 0;
+    switch (type)
+    {
+        case BOLT_BIT:
+            target->data.as_char[0] = value->data.as_char[0];
+            break;
+        case BOLT_INT64:
+            target->data.as_int64 = value->data.as_int64[0];
+            break;
+        case BOLT_FLOAT64:
+            target->data.as_double = value->data.as_double[0];
+            break;
+        case BOLT_STRING8:
+        case BOLT_BYTE_ARRAY:
+        {
+            const char* data = type == BOLT_STRING8 ? BoltString8_get((struct BoltValue*)(value)) :
+                               BoltByteArray_get_all((struct BoltValue*)(value));
+            if (value->size > INLINE_SIZE)
+            {
+                memcpy(*bytes, data, (size_t)(value->size));
+                target->data.as_ptr = *bytes;
+                *bytes += value->size;
+            }
+            else if (value->size > 0)
+            {
+                memcpy(target->data.as_char, data, (size_t)(value->size));
+            }
+            break;
+        }
+        case BOLT_LIST:
+        case BOLT_DICTIONARY8:
+        case BOLT_STRUCTURE:
+        case BOLT_SUMMARY:
+        {
+            int n = _children(value);
+            struct BoltCompactValue* children = *values;
+            *values += n;
+            target->data.as_value = children;
+            for (int i = 0; i < n; i++)
+            {
+                _copy(&value->data.extended.as_value[i], &children[i], values, bytes);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+const struct BoltCompactValue* BoltCompactValue_create(const struct BoltValue* value)
+{
+    size_t n_values = 1;
+    size_t n_bytes = 0;
+    if (_measure(value, &n_values, &n_bytes) == -1)
+    {
+        return NULL;
+    }
+    size_t memory = sizeof(struct _compact_header) + sizeof_n(struct BoltCompactValue, n_values) + n_bytes;
+    struct _compact_header* header = BoltMem_allocate(memory);
+    header->memory = memory;
+    struct BoltCompactValue* root = (struct BoltCompactValue*)(header + 1);
+    struct BoltCompactValue* values = root + 1;
+    char* bytes = (char*)(root + n_values);
+    _copy(value, root, &values, &bytes);
+    return root;
+}
+
+void BoltCompactValue_destroy(const struct BoltCompactValue* value)
+{
+    if (value == NULL) return;
+    struct _compact_header* header = header_of(value);
+    BoltMem_deallocate(header, header->memory);
+}
+
+size_t BoltCompactValue_memory(const struct BoltCompactValue* value)
+{
+    return header_of(value)->memory;
+}
+
+enum BoltType BoltCompactValue_type(const struct BoltCompactValue* value)
+{
+    return (enum BoltType)(value->type);
+}
+
+char BoltCompactBit_get(const struct BoltCompactValue* value)
+{
+    return value->data.as_char[0];
+}
+
+int64_t BoltCompactInt64_get(const struct BoltCompactValue* value)
+{
+    return value->data.as_int64;
+}
+
+double BoltCompactFloat64_get(const struct BoltCompactValue* value)
+{
+    return value->data.as_double;
+}
+
+const char* BoltCompactString8_get(const struct BoltCompactValue* value)
+{
+    return value->size > INLINE_SIZE ? value->data.as_ptr : value->data.as_char;
+}
+
+const char* BoltCompactByteArray_get_all(const struct BoltCompactValue* value)
+{
+    return value->size > INLINE_SIZE ? value->data.as_ptr : value->data.as_char;
+}
+
+const struct BoltCompactValue* BoltCompactList_value(const struct BoltCompactValue* value, int32_t index)
+{
+    return &value->data.as_value[index];
+}
+
+const struct BoltCompactValue* BoltCompactDictionary8_key(const struct BoltCompactValue* value, int32_t index)
+{
+    return &value->data.as_value[2 * index];
+}
+
+const struct BoltCompactValue* BoltCompactDictionary8_value(const struct BoltCompactValue* value, int32_t index)
+{
+    return &value->data.as_value[2 * index + 1];
+}
+
+const struct BoltCompactValue* BoltCompactStructure_value(const struct BoltCompactValue* value, int32_t index)
+{
+    return &value->data.as_value[index];
+}
@@ -36,12 +36,36 @@ void BoltValue_to_Float64(struct BoltValue* value, double x)
     value->data.as_double[0] = x;
 }
 
+/**
+ * Reformat a value to hold `size` points of `n` coordinates each, all
+ * zero, with the SRID held in external storage ahead of them.
+ */
+static void _to_points(struct BoltValue* value, enum BoltType type, int64_t srid, int32_t n, int32_t size)
+{
+    size_t data_size = sizeof(int64_t) + sizeof_n(double, n * size);
+    _format(value, type, size, NULL, data_size);
+    memset(value->data.extended.as_char, 0, data_size);
+    value->data.extended.as_int64[0] = srid;
+}
+
+void BoltValue_to_Float64Pair(struct BoltValue* value, int64_t srid, double x, double y)
+{
+    _to_points(value, BOLT_FLOAT64_PAIR, srid, 2, 1);
+    BoltFloat64PairArray_set(value, 0, x, y);
+}
+
+void BoltValue_to_Float64Triple(struct BoltValue* value, int64_t srid, double x, double y, double z)
+{
+    _to_points(value, BOLT_FLOAT64_TRIPLE, srid, 3, 1);
+    BoltFloat64TripleArray_set(value, 0, x, y, z);
+}
+
 void BoltValue_to_Float32Array(struct BoltValue* value, float* array, int32_t size)
 {
     if (size <= sizeof(value->data) / sizeof(float))
     {
         _format(value, BOLT_FLOAT32_ARRAY, size, NULL, 0);
-        memcpy(value->data.as_float, array, (size_t)(size));
+        memcpy(value->data.as_float, array, sizeof_n(float, size));
     }
     else
     {
@@ -54,7 +78,7 @@ void BoltValue_to_Float64Array(struct BoltValue* value, double* array, int32_t s
     if (size <= sizeof(value->data) / sizeof(double))
     {
         _format(value, BOLT_FLOAT64_ARRAY, size, NULL, 0);
-        memcpy(value->data.as_double, array, (size_t)(size));
+        memcpy(value->data.as_double, array, sizeof_n(double, size));
     }
     else
     {
@@ -62,6 +86,16 @@ void BoltValue_to_Float64Array(struct BoltValue* value, double* array, int32_t s
     }
 }
 
+void BoltValue_to_Float64PairArray(struct BoltValue* value, int64_t srid, int32_t size)
+{
+    _to_points(value, BOLT_FLOAT64_PAIR_ARRAY, srid, 2, size);
+}
+
+void BoltValue_to_Float64TripleArray(struct BoltValue* value, int64_t srid, int32_t size)
+{
+    _to_points(value, BOLT_FLOAT64_TRIPLE_ARRAY, srid, 3, size);
+}
+
 float BoltFloat32_get(const struct BoltValue* value)
 {
     return value->data.as_float[0];
@@ -86,6 +120,81 @@ double BoltFloat64Array_get(const struct BoltValue* value, int32_t index)
     return data[index];
 }
 
+int64_t BoltPoint_srid(const struct BoltValue* value)
+{
+    return value->data.extended.as_int64[0];
+}
+
+const double* BoltPoint_coordinates(const struct BoltValue* value)
+{
+    return value->data.extended.as_double + 1;
+}
+
+double BoltFloat64Pair_get_first(const struct BoltValue* value)
+{
+    return BoltPoint_coordinates(value)[0];
+}
+
+double BoltFloat64Pair_get_second(const struct BoltValue* value)
+{
+    return BoltPoint_coordinates(value)[1];
+}
+
+double BoltFloat64Triple_get_first(const struct BoltValue* value)
+{
+    return BoltPoint_coordinates(value)[0];
+}
+
+double BoltFloat64Triple_get_second(const struct BoltValue* value)
+{
+    return BoltPoint_coordinates(value)[1];
+}
+
+double BoltFloat64Triple_get_third(const struct BoltValue* value)
+{
+    return BoltPoint_coordinates(value)[2];
+}
+
+double BoltFloat64PairArray_get_first(const struct BoltValue* value, int32_t index)
+{
+    return BoltPoint_coordinates(value)[2 * index];
+}
+
+double BoltFloat64PairArray_get_second(const struct BoltValue* value, int32_t index)
+{
+    return BoltPoint_coordinates(value)[2 * index + 1];
+}
+
+void BoltFloat64PairArray_set(struct BoltValue* value, int32_t index, double x, double y)
+{
+    double* data = value->data.extended.as_double + 1;
+    data[2 * index] = x;
+    data[2 * index + 1] = y;
+}
+
+double BoltFloat64TripleArray_get_first(const struct BoltValue* value, int32_t index)
+{
+    return BoltPoint_coordinates(value)[3 * index];
+}
+
+double BoltFloat64TripleArray_get_second(const struct BoltValue* value, int32_t index)
+{
+    return BoltPoint_coordinates(value)[3 * index + 1];
+}
+
+double BoltFloat64TripleArray_get_third(const struct BoltValue* value, int32_t index)
+{
+    return BoltPoint_coordinates(value)[3 * index + 2];
+}
+
+void BoltFloat64TripleArray_set(struct BoltValue* value, int32_t index, double x, double y, double z)
+{
+    double* data = value->data.extended.as_double + 1;
+    data[3 * index] = x;
+    data[3 * index + 1] = y;
+    data[3 * index + 2] = z;
+}
+
 int BoltFloat32_write(struct BoltValue * value, FILE * file)
 {
     assert(BoltValue_type(value) == BOLT_FLOAT32);
@@ -123,3 +232,45 @@ int BoltFloat64Array_write(struct BoltValue * value, FILE * file)
     fprintf(file, "]");
     return 0;
 }
+
+int BoltFloat64Pair_write(struct BoltValue * value, FILE * file)
+{
+    assert(BoltValue_type(value) == BOLT_FLOAT64_PAIR);
+    fprintf(file, "point(%ld; %f, %f)", BoltPoint_srid(value),
+            BoltFloat64Pair_get_first(value), BoltFloat64Pair_get_second(value));
+    return 0;
+}
+
+int BoltFloat64Triple_write(struct BoltValue * value, FILE * file)
+{
+    assert(BoltValue_type(value) == BOLT_FLOAT64_TRIPLE);
+    fprintf(file, "point(%ld; %f, %f, %f)", BoltPoint_srid(value), BoltFloat64Triple_get_first(value),
+            BoltFloat64Triple_get_second(value), BoltFloat64Triple_get_third(value));
+    return 0;
+}
+
+int BoltFloat64PairArray_write(struct BoltValue * value, FILE * file)
+{
+    assert(BoltValue_type(value) == BOLT_FLOAT64_PAIR_ARRAY);
+    fprintf(file, "point(%ld)[", BoltPoint_srid(value));
+    for (int i = 0; i < value->size; i++)
+    {
+        fprintf(file, i == 0 ? "(%f, %f)" : ", (%f, %f)",
+                BoltFloat64PairArray_get_first(value, i), BoltFloat64PairArray_get_second(value, i));
+    }
+    fprintf(file, "]");
+    return 0;
+}
+
+int BoltFloat64TripleArray_write(struct BoltValue * value, FILE * file)
+{
+    assert(BoltValue_type(value) == BOLT_FLOAT64_TRIPLE_ARRAY);
+    fprintf(file, "point(%ld)[", BoltPoint_srid(value));
+    for (int i = 0; i < value->size; i++)
+    {
+        fprintf(file, i == 0 ? "(%f, %f, %f)" : ", (%f, %f, %f)", BoltFloat64TripleArray_get_first(value, i),
+                BoltFloat64TripleArray_get_second(value, i), BoltFloat64TripleArray_get_third(value, i));
+    }
+    fprintf(file, "]");
+    return 0;
+}
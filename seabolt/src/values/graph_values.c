@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <graph.h>
+#include "mem.h"
+
+
+#define NODE_CODE 'N'
+#define RELATIONSHIP_CODE 'R'
+#define UNBOUND_RELATIONSHIP_CODE 'r'
+#define PATH_CODE 'P'
+
+
+static int _is_structure(const struct BoltTape* tape, int32_t index, int16_t code, int32_t size)
+{
+    return index >= 0 && index < tape->n_tokens && BoltTape_type(tape, index) == BOLT_STRUCTURE &&
+           BoltTape_code(tape, index) == code && BoltTape_size(tape, index) == size;
+}
+
+/**
+ * Ensure room for `size` elements of `unit` bytes in an array that
+ * grows, but is never shrunk, as a path view is reused.
+ */
+static void* _grow(void* array, int32_t* capacity, int32_t size, size_t unit)
+{
+    if (size <= *capacity) return array;
+    array = BoltMem_reallocate(array, *capacity * unit, size * unit);
+    *capacity = size;
+    return array;
+}
+
+int BoltTape_node(const struct BoltTape* tape, int32_t index, struct BoltNodeView* node)
+{
+    if (!_is_structure(tape, index, NODE_CODE, 3)) return -1;
+    int32_t id = index + 1;
+    int32_t labels = BoltTape_next(tape, id);
+    if (BoltTape_type(tape, id) != BOLT_INT64 || BoltTape_type(tape, labels) != BOLT_LIST) return -1;
+    int32_t properties = BoltTape_next(tape, labels);
+    if (BoltTape_type(tape, properties) != BOLT_DICTIONARY8) return -1;
+    int32_t n_labels = BoltTape_size(tape, labels);
+    for (int32_t i = 0; i < n_labels; i++)
+    {
+        if (BoltTape_type(tape, labels + 1 + i) != BOLT_STRING8) return -1;
+    }
+    node->id = BoltTape_int64(tape, id);
+    node->n_labels = n_labels;
+    node->labels = labels + 1;
+    node->properties = properties;
+    return 0;
+}
+
+int BoltTape_relationship(const struct BoltTape* tape, int32_t index, struct BoltRelationshipView* relationship)
+{
+    int32_t type;
+    if (_is_structure(tape, index, RELATIONSHIP_CODE, 5))
+    {
+        for (int32_t i = 1; i <= 3; i++)
+        {
+            if (BoltTape_type(tape, index + i) != BOLT_INT64) return -1;
+        }
+        relationship->start_id = BoltTape_int64(tape, index + 2);
+        relationship->end_id = BoltTape_int64(tape, index + 3);
+        type = index + 4;
+    }
+    else if (_is_structure(tape, index, UNBOUND_RELATIONSHIP_CODE, 3))
+    {
+        if (BoltTape_type(tape, index + 1) != BOLT_INT64) return -1;
+        relationship->start_id = -1;
+        relationship->end_id = -1;
+        type = index + 2;
+    }
+    else
+    {
+        return -1;
+    }
+    int32_t properties = type + 1;
+    if (BoltTape_type(tape, type) != BOLT_STRING8 || BoltTape_type(tape, properties) != BOLT_DICTIONARY8) return -1;
+    relationship->id = BoltTape_int64(tape, index + 1);
+    relationship->type = type;
+    relationship->properties = properties;
+    return 0;
+}
+
+struct BoltPathView* BoltPathView_create()
+{
+    struct BoltPathView* path = BoltMem_allocate(sizeof(struct BoltPathView));
+    path->n_nodes = 0;
+    path->nodes = NULL;
+    path->n_relationships = 0;
+    path->relationships = NULL;
+    path->n_hops = 0;
+    path->hops = NULL;
+    path->node_capacity = 0;
+    path->relationship_capacity = 0;
+    path->hop_capacity = 0;
+    return path;
+}
+
+void BoltPathView_destroy(struct BoltPathView* path)
+{
+    BoltMem_deallocate(path->hops, path->hop_capacity * sizeof(struct BoltPathHop));
+    BoltMem_deallocate(path->relationships, path->relationship_capacity * sizeof(struct BoltRelationshipView));
+    BoltMem_deallocate(path->nodes, path->node_capacity * sizeof(struct BoltNodeView));
+    BoltMem_deallocate(path, sizeof(struct BoltPathView));
+}
+
+int BoltTape_path(const struct BoltTape* tape, int32_t index, struct BoltPathView* path)
+{
+    if (!_is_structure(tape, index, PATH_CODE, 3)) return -1;
+    int32_t nodes = index + 1;
+    int32_t relationships = BoltTape_next(tape, nodes);
+    int32_t sequence = BoltTape_next(tape, relationships);
+    if (BoltTape_type(tape, nodes) != BOLT_LIST || BoltTape_type(tape, relationships) != BOLT_LIST ||
+        BoltTape_type(tape, sequence) != BOLT_LIST) return -1;
+    int32_t n_nodes = BoltTape_size(tape, nodes);
+    int32_t n_relationships = BoltTape_size(tape, relationships);
+    int32_t n_sequence = BoltTape_size(tape, sequence);
+    if (n_nodes == 0 || n_sequence % 2 != 0) return -1;
+    path->nodes = _grow(path->nodes, &path->node_capacity, n_nodes, sizeof(struct BoltNodeView));
+    path->relationships = _grow(path->relationships, &path->relationship_capacity, n_relationships,
+                                   sizeof(struct BoltRelationshipView));
+    path->hops = _grow(path->hops, &path->hop_capacity, n_sequence / 2, sizeof(struct BoltPathHop));
+    path->n_nodes = 0;
+    path->n_relationships = 0;
+    path->n_hops = 0;
+    int32_t entry = nodes + 1;
+    for (int32_t i = 0; i < n_nodes; i++)
+    {
+        if (BoltTape_node(tape, entry, &path->nodes[i]) == -1) return -1;
+        entry = BoltTape_next(tape, entry);
+    }
+    entry = relationships + 1;
+    for (int32_t i = 0; i < n_relationships; i++)
+    {
+        if (BoltTape_relationship(tape, entry, &path->relationships[i]) == -1) return -1;
+        entry = BoltTape_next(tape, entry);
+    }
+    int32_t last = 0;
+    for (int32_t i = 0; i < n_sequence / 2; i++)
+    {
+        int32_t step = sequence + 1 + 2 * i;
+        if (BoltTape_type(tape, step) != BOLT_INT64 || BoltTape_type(tape, step + 1) != BOLT_INT64) return -1;
+        int64_t r = BoltTape_int64(tape, step);
+        int64_t n = BoltTape_int64(tape, step + 1);
+        if (r == 0 || r < -n_relationships || r > n_relationships || n < 0 || n >= n_nodes) return -1;
+        struct BoltPathHop* hop = &path->hops[i];
+        hop->relationship = (int32_t)(r > 0 ? r - 1 : -r - 1);
+        hop->forward = r > 0;
+        hop->node = (int32_t)(n);
+        struct BoltRelationshipView* relationship = &path->relationships[hop->relationship];
+        if (relationship->start_id == -1)
+        {
+            relationship->start_id = path->nodes[hop->forward ? last : hop->node].id;
+            relationship->end_id = path->nodes[hop->forward ? hop->node : last].id;
+        }
+        last = hop->node;
+    }
+    path->n_nodes = n_nodes;
+    path->n_relationships = n_relationships;
+    path->n_hops = n_sequence / 2;
+    return 0;
+}
@@ -39,11 +39,19 @@ static const char HEX_DIGITS[] = {'0', '1', '2', '3', '4', '5', '6', '7',
 
 void _to_structure(struct BoltValue* value, enum BoltType type, int16_t code, int32_t size)
 {
+    if (BoltValue_type(value) == type && type != BOLT_STRUCTURE_ARRAY)
+    {
+        // As for lists, keep the existing fields and their storage
+        _resize(value, size, 1);
+        value->code = code;
+        return;
+    }
     _recycle(value);
-    value->data.extended.as_ptr = BoltMem_adjust(value->data.extended.as_ptr, value->data_size,
-                                                 sizeof_n(struct BoltValue, size));
-    value->data_size = sizeof_n(struct BoltValue, size);
-    memset(value->data.extended.as_char, 0, value->data_size);
+    _reserve(value, sizeof(struct BoltValue), size);
+    if (size > 0)
+    {
+        memset(value->data.extended.as_char, 0, sizeof_n(struct BoltValue, size));
+    }
     _set_type(value, type, size);
     value->code = code;
 }
@@ -130,6 +138,7 @@ int BoltStructure_write(struct BoltValue * value, FILE * file, int32_t protocol_
     switch (protocol_version)
     {
         case 1:
+        case 2:
         {
             const char* name = BoltProtocolV1_structure_name(code);
             fprintf(file, "$%s", name);
@@ -155,6 +164,7 @@ int BoltStructureArray_write(struct BoltValue * value, FILE * file, int32_t prot
     switch (protocol_version)
     {
         case 1:
+        case 2:
         {
             const char* name = BoltProtocolV1_structure_name(code);
             if (name == NULL)
@@ -191,6 +201,7 @@ int BoltRequest_write(struct BoltValue * value, FILE * file, int32_t protocol_ve
     switch (protocol_version)
     {
         case 1:
+        case 2:
         {
             const char* name = BoltProtocolV1_request_name(code);
             if (name == NULL)
@@ -223,6 +234,7 @@ int BoltSummary_write(struct BoltValue * value, FILE * file, int32_t protocol_ve
     switch (protocol_version)
     {
         case 1:
+        case 2:
         {
             const char* name = BoltProtocolV1_summary_name(code);
             if (name == NULL)
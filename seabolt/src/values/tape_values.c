@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2002-2017 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <string.h>
+#include <tape.h>
+#include "mem.h"
+
+
+#define INITIAL_TOKEN_CAPACITY 64
+#define INITIAL_STRINGS_CAPACITY 256
+
+
+struct BoltTape* BoltTape_create()
+{
+    struct BoltTape* tape = BoltMem_allocate(sizeof(struct BoltTape));
+    tape->tokens = BoltMem_allocate(INITIAL_TOKEN_CAPACITY * sizeof(struct BoltTapeToken));
+    tape->token_capacity = INITIAL_TOKEN_CAPACITY;
+    tape->strings = BoltMem_allocate(INITIAL_STRINGS_CAPACITY);
+    tape->strings_capacity = INITIAL_STRINGS_CAPACITY;
+    BoltTape_reset(tape);
+    return tape;
+}
+
+void BoltTape_destroy(struct BoltTape* tape)
+{
+    BoltMem_deallocate(tape->strings, (size_t)(tape->strings_capacity));
+    BoltMem_deallocate(tape->tokens, tape->token_capacity * sizeof(struct BoltTapeToken));
+    BoltMem_deallocate(tape, sizeof(struct BoltTape));
+}
+
+void BoltTape_reset(struct BoltTape* tape)
+{
+    tape->n_tokens = 0;
+    tape->strings_size = 0;
+    tape->n_records = 0;
+    tape->depth = 0;
+}
+
+/**
+ * Append a token for a value within the record being appended.
+ */
+static struct BoltTapeToken* _append(struct BoltTape* tape, enum BoltType type, int32_t size)
+{
+    if (tape->n_tokens == tape->token_capacity)
+    {
+        if (tape->token_capacity > INT32_MAX / 2) return NULL;
+        int32_t capacity = 2 * tape->token_capacity;
+        tape->tokens = BoltMem_reallocate(tape->tokens, tape->token_capacity * sizeof(struct BoltTapeToken),
+                                          capacity * sizeof(struct BoltTapeToken));
+        tape->token_capacity = capacity;
+    }
+    struct BoltTapeToken* token = &tape->tokens[tape->n_tokens];
+    tape->n_tokens += 1;
+    token->type = (int8_t)(type);
+    token->flags = 0;
+    token->code = 0;
+    token->size = size;
+    token->data.as_int64 = 0;
+    return token;
+}
+
+static int _append_data(struct BoltTape* tape, enum BoltType type, const char* data, int32_t size)
+{
+    if (size > INT32_MAX - tape->strings_size) return -1;
+    if (tape->strings_size + size > tape->strings_capacity)
+    {
+        int32_t capacity = tape->strings_capacity;
+        while (capacity < tape->strings_size + size)
+        {
+            capacity = capacity > INT32_MAX / 2 ? INT32_MAX : 2 * capacity;
+        }
+        tape->strings = BoltMem_reallocate(tape->strings, (size_t)(tape->strings_capacity), (size_t)(capacity));
+        tape->strings_capacity = capacity;
+    }
+    struct BoltTapeToken* token = _append(tape, type, size);
+    if (token == NULL) return -1;
+    memcpy(&tape->strings[tape->strings_size], data, (size_t)(size));
+    token->data.as_offset = tape->strings_size;
+    tape->strings_size += size;
+    return 0;
+}
+
+static int _open(struct BoltTape* tape, enum BoltType type, int16_t code, int32_t size)
+{
+    if (tape->depth == BOLT_TAPE_MAX_DEPTH) return -1;
+    struct BoltTapeToken* token = _append(tape, type, size);
+    if (token == NULL) return -1;
+    token->code = code;
+    tape->stack[tape->depth] = tape->n_tokens - 1;
+    tape->depth += 1;
+    return 0;
+}
+
+static int _on_null(void* context)
+{
+    return _append((struct BoltTape*)(context), BOLT_NULL, 0) == NULL ? -1 : 0;
+}
+
+static int _on_boolean(void* context, int x)
+{
+    struct BoltTapeToken* token = _append((struct BoltTape*)(context), BOLT_BIT, 0);
+    if (token == NULL) return -1;
+    token->data.as_int64 = x;
+    return 0;
+}
+
+static int _on_int(void* context, int64_t x)
+{
+    struct BoltTapeToken* token = _append((struct BoltTape*)(context), BOLT_INT64, 0);
+    if (token == NULL) return -1;
+    token->data.as_int64 = x;
+    return 0;
+}
+
+static int _on_float(void* context, double x)
+{
+    struct BoltTapeToken* token = _append((struct BoltTape*)(context), BOLT_FLOAT64, 0);
+    if (token == NULL) return -1;
+    token->data.as_double = x;
+    return 0;
+}
+
+static int _on_string(void* context, const char* string, int32_t size)
+{
+    return _append_data((struct BoltTape*)(context), BOLT_STRING8, string, size);
+}
+
+static int _on_bytes(void* context, const char* data, int32_t size)
+{
+    return _append_data((struct BoltTape*)(context), BOLT_BYTE_ARRAY, data, size);
+}
+
+static int _on_list_begin(void* context, int32_t size)
+{
+    return _open((struct BoltTape*)(context), BOLT_LIST, 0, size);
+}
+
+static int _on_map_begin(void* context, int32_t size)
+{
+    return _open((struct BoltTape*)(context), BOLT_DICTIONARY8, 0, size);
+}
+
+static int _on_struct_begin(void* context, int16_t code, int32_t size)
+{
+    return _open((struct BoltTape*)(context), BOLT_STRUCTURE, code, size);
+}
+
+static int _on_end(void* context)
+{
+    struct BoltTape* tape = (struct BoltTape*)(context);
+    tape->depth -= 1;
+    tape->tokens[tape->stack[tape->depth]].data.as_next = tape->n_tokens;
+    if (tape->depth == 0)
+    {
+        tape->n_records += 1;
+    }
+    return 0;
+}
+
+static const struct BoltEventHandler TAPE_HANDLER = {
+        _on_null, _on_boolean, _on_int, _on_float, _on_string, _on_bytes,
+        _on_list_begin, _on_map_begin, _on_struct_begin, _on_end,
+};
+
+const struct BoltEventHandler* BoltTape_handler()
+{
+    return &TAPE_HANDLER;
+}
+
+int BoltTape_fetch_b(struct BoltTape* tape, struct BoltConnection* connection, int request_id)
+{
+    int32_t n_tokens = tape->n_tokens;
+    int32_t strings_size = tape->strings_size;
+    int status = BoltConnection_fetch_events_b(connection, request_id, &TAPE_HANDLER, tape);
+    if (status == -1)
+    {
+        tape->n_tokens = n_tokens;
+        tape->strings_size = strings_size;
+        tape->depth = 0;
+    }
+    return status;
+}
+
+int32_t BoltTape_next(const struct BoltTape* tape, int32_t index)
+{
+    const struct BoltTapeToken* token = &tape->tokens[index];
+    switch (token->type)
+    {
+        case BOLT_LIST:
+        case BOLT_DICTIONARY8:
+        case BOLT_STRUCTURE:
+            return (int32_t)(token->data.as_next);
+        default:
+            return index + 1;
+    }
+}
+
+enum BoltType BoltTape_type(const struct BoltTape* tape, int32_t index)
+{
+    return (enum BoltType)(tape->tokens[index].type);
+}
+
+int32_t BoltTape_size(const struct BoltTape* tape, int32_t index)
+{
+    return tape->tokens[index].size;
+}
+
+int16_t BoltTape_code(const struct BoltTape* tape, int32_t index)
+{
+    return tape->tokens[index].code;
+}
+
+char BoltTape_bit(const struct BoltTape* tape, int32_t index)
+{
+    return (char)(tape->tokens[index].data.as_int64);
+}
+
+int64_t BoltTape_int64(const struct BoltTape* tape, int32_t index)
+{
+    return tape->tokens[index].data.as_int64;
+}
+
+double BoltTape_float64(const struct BoltTape* tape, int32_t index)
+{
+    return tape->tokens[index].data.as_double;
+}
+
+const char* BoltTape_data(const struct BoltTape* tape, int32_t index)
+{
+    return &tape->strings[tape->tokens[index].data.as_offset];
+}
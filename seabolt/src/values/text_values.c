@@ -21,9 +21,26 @@
 #include <stdint.h>
 #include <string.h>
 #include <values.h>
+#include "../arena.h"
 #include "mem.h"
 
 
+/// Dictionaries of at least this size are indexed for keyed lookup
+#define DICTIONARY8_INDEX_THRESHOLD 16
+
+/**
+ * Open addressing hash index from key to entry position. Each slot
+ * holds one more than the entry position, so that zero marks a free slot.
+ */
+struct BoltDictionaryIndex
+{
+    int32_t capacity;
+    int32_t slots[];
+};
+
+#define index_size(capacity) (sizeof(struct BoltDictionaryIndex) + sizeof_n(int32_t, capacity))
+
+
 void BoltValue_to_Char16(struct BoltValue* value, uint16_t x)
 {
     _format(value, BOLT_CHAR16, 1, NULL, 0);
@@ -48,7 +65,7 @@ void BoltValue_to_String8(struct BoltValue* value, const char* string, int32_t s
             memcpy(value->data.as_char, string, (size_t)(size));
         }
     }
-    else if (BoltValue_type(value) == BOLT_STRING8)
+    else if (BoltValue_type(value) == BOLT_STRING8 && !(value->flags & BOLT_VALUE_UNOWNED))
     {
         // This is already a UTF-8 string so we can just tweak it
         size_t data_size = size >= 0 ? (size_t)(size) : 0;
@@ -57,7 +74,7 @@ void BoltValue_to_String8(struct BoltValue* value, const char* string, int32_t s
         value->size = size;
         if (string != NULL)
         {
-            memcpy(value->data.as_char, string, (size_t)(size));
+            memcpy(value->data.extended.as_char, string, (size_t)(size));
         }
     }
     else
@@ -67,6 +84,13 @@ void BoltValue_to_String8(struct BoltValue* value, const char* string, int32_t s
     }
 }
 
+void BoltValue_to_BorrowedString8(struct BoltValue* value, const char* string, int32_t size)
+{
+    _format(value, BOLT_STRING8, size, NULL, 0);
+    value->data.extended.as_ptr = (void*)(string);
+    value->flags |= BOLT_VALUE_BORROWED;
+}
+
 void BoltValue_to_String16(struct BoltValue* value, uint16_t* string, int32_t size)
 {
     if (size <= sizeof(value->data) / sizeof(uint16_t))
@@ -108,22 +132,45 @@ void BoltValue_to_Dictionary8(struct BoltValue* value, int32_t size)
     }
     else
     {
-        size_t unit_size = sizeof(struct BoltValue);
-        size_t data_size = 2 * unit_size * size;
+        size_t unit_size = 2 * sizeof(struct BoltValue);
         _recycle(value);
-        value->data.extended.as_ptr = BoltMem_adjust(value->data.extended.as_ptr, value->data_size, data_size);
-        value->data_size = data_size;
-        memset(value->data.extended.as_char, 0, data_size);
+        _reserve(value, unit_size, size);
+        if (size > 0)
+        {
+            memset(value->data.extended.as_char, 0, sizeof_n(struct BoltValue, 2 * size));
+        }
+        value->data.as_ptr[1] = NULL;
         _set_type(value, BOLT_DICTIONARY8, size);
     }
 }
 
 char* BoltString8_get(struct BoltValue* value)
 {
-    return value->size <= sizeof(value->data) / sizeof(char) ?
+    // Interned strings and views are always held externally, whatever their size
+    return value->size <= sizeof(value->data) / sizeof(char) && !(value->flags & BOLT_VALUE_EXTERNAL) ?
            value->data.as_char : value->data.extended.as_char;
 }
 
+uint32_t BoltString8_hash(const struct BoltValue* value)
+{
+    if (value->flags & BOLT_VALUE_INTERNED)
+    {
+        return value->data.as_uint32[2];
+    }
+    return BoltString8_hash_of(BoltString8_get((struct BoltValue*)(value)), value->size);
+}
+
+uint32_t BoltString8_hash_of(const char* string, int32_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (int32_t i = 0; i < size; i++)
+    {
+        hash ^= (uint8_t)(string[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 char* BoltString8Array_get(struct BoltValue* value, int32_t index)
 {
     struct array_t string = value->data.extended.as_array[index];
@@ -157,6 +204,7 @@ int BoltDictionary8_set_key(struct BoltValue* value, int32_t index, const char*
     if (key_size <= INT32_MAX)
     {
         assert(BoltValue_type(value) == BOLT_DICTIONARY8);
+        _invalidate_index(value);
         BoltValue_to_String8(&value->data.extended.as_value[2 * index], key, key_size);
         return 0;
     }
@@ -172,6 +220,110 @@ struct BoltValue* BoltDictionary8_value(struct BoltValue* value, int32_t index)
     return &value->data.extended.as_value[2 * index + 1];
 }
 
+static int _key_equals(struct BoltValue* key, const char* string, size_t size)
+{
+    return BoltValue_type(key) == BOLT_STRING8 && (size_t)(key->size) == size &&
+           memcmp(BoltString8_get(key), string, size) == 0;
+}
+
+void _invalidate_index(struct BoltValue* value)
+{
+    if (!(value->flags & BOLT_VALUE_INDEXED)) return;
+    struct BoltDictionaryIndex* index = value->data.as_ptr[1];
+    if (!(value->flags & BOLT_VALUE_ARENA))
+    {
+        BoltMem_deallocate(index, index_size(index->capacity));
+    }
+    // An index drawn from an arena is simply forgotten, along with the
+    // arena itself, so the dictionary will not be indexed again
+    value->data.as_ptr[1] = NULL;
+    value->flags &= ~BOLT_VALUE_INDEXED;
+}
+
+static struct BoltDictionaryIndex* _build_index(struct BoltValue* value)
+{
+    int32_t capacity = DICTIONARY8_INDEX_THRESHOLD;
+    while (capacity < 2 * value->size)
+    {
+        capacity *= 2;
+    }
+    struct BoltDictionaryIndex* index;
+    if (value->flags & BOLT_VALUE_ARENA)
+    {
+        struct BoltArena* arena = value->data.as_ptr[1];
+        if (arena == NULL) return NULL;
+        index = BoltArena_allocate(arena, index_size(capacity));
+    }
+    else
+    {
+        index = BoltMem_allocate(index_size(capacity));
+    }
+    index->capacity = capacity;
+    memset(index->slots, 0, sizeof_n(int32_t, capacity));
+    uint32_t mask = (uint32_t)(capacity - 1);
+    for (int32_t i = 0; i < value->size; i++)
+    {
+        struct BoltValue* key = BoltDictionary8_key(value, i);
+        if (BoltValue_type(key) != BOLT_STRING8) continue;
+        const char* string = BoltString8_get(key);
+        for (uint32_t j = BoltString8_hash(key) & mask; ; j = (j + 1) & mask)
+        {
+            int32_t slot = index->slots[j];
+            if (slot == 0)
+            {
+                index->slots[j] = i + 1;
+                break;
+            }
+            if (_key_equals(BoltDictionary8_key(value, slot - 1), string, (size_t)(key->size)))
+            {
+                // Keep the first of any duplicate keys
+                break;
+            }
+        }
+    }
+    value->data.as_ptr[1] = index;
+    value->flags |= BOLT_VALUE_INDEXED;
+    return index;
+}
+
+struct BoltValue* BoltDictionary8_value_by_key(struct BoltValue* value, const char* key, size_t key_size)
+{
+    assert(BoltValue_type(value) == BOLT_DICTIONARY8);
+    struct BoltDictionaryIndex* index = NULL;
+    if (value->flags & BOLT_VALUE_INDEXED)
+    {
+        index = value->data.as_ptr[1];
+    }
+    else if (value->size >= DICTIONARY8_INDEX_THRESHOLD && key_size <= INT32_MAX)
+    {
+        index = _build_index(value);
+    }
+    if (index == NULL)
+    {
+        for (int32_t i = 0; i < value->size; i++)
+        {
+            if (_key_equals(BoltDictionary8_key(value, i), key, key_size))
+            {
+                return BoltDictionary8_value(value, i);
+            }
+        }
+        return NULL;
+    }
+    uint32_t mask = (uint32_t)(index->capacity - 1);
+    for (uint32_t j = BoltString8_hash_of(key, (int32_t)(key_size)) & mask; ; j = (j + 1) & mask)
+    {
+        int32_t slot = index->slots[j];
+        if (slot == 0)
+        {
+            return NULL;
+        }
+        if (_key_equals(BoltDictionary8_key(value, slot - 1), key, key_size))
+        {
+            return BoltDictionary8_value(value, slot - 1);
+        }
+    }
+}
+
 void _write_string(FILE* file, const char* data, size_t size)
 {
     fprintf(file, "\"");
@@ -21,10 +21,20 @@
 #include <assert.h>
 #include <memory.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include <values.h>
+#include "../arena.h"
 #include "mem.h"
 
 
+/// External storage up to this size is kept when a container shrinks
+#define RETAINED_DATA_SIZE 512
+/// Beyond that, storage is given back once less than this fraction of it is used
+#define SHRINK_FACTOR 4
+
+#define owns_arena(value) (((value)->flags & BOLT_VALUE_ARENA_OWNER) == BOLT_VALUE_ARENA_OWNER)
+
+
 /**
  * Clean up a value for reuse.
  *
@@ -34,6 +44,43 @@
  */
 void _recycle(struct BoltValue* value)
 {
+    value->flags &= ~(BOLT_VALUE_FROZEN | BOLT_VALUE_FROZEN_V2);
+    if (BoltValue_type(value) == BOLT_DICTIONARY8)
+    {
+        _invalidate_index(value);
+    }
+    if (owns_arena(value))
+    {
+        // Everything nested within the value lives in the arena, so it
+        // all goes along with it
+        BoltArena_destroy(value->data.as_ptr[1]);
+        value->data.as_ptr[1] = NULL;
+        value->data.extended.as_ptr = NULL;
+        value->data_size = 0;
+        value->flags &= ~BOLT_VALUE_ARENA_OWNER;
+        return;
+    }
+    if (value->flags & BOLT_VALUE_MAPPED)
+    {
+        // The start of the mapping, which is page aligned, is held
+        // alongside the pointer to the data within it
+        munmap(value->data.as_ptr[1], value->data_size);
+        value->data.as_ptr[1] = NULL;
+        value->data.extended.as_ptr = NULL;
+        value->data_size = 0;
+        value->flags &= ~BOLT_VALUE_MAPPED;
+        return;
+    }
+    if (value->flags & BOLT_VALUE_UNOWNED)
+    {
+        // Arena storage, including that of any nested values, is
+        // reclaimed wholesale by the arena, and interned storage lives
+        // as long as its table, so we simply let go of it.
+        value->data.extended.as_ptr = NULL;
+        value->data_size = 0;
+        value->flags &= ~BOLT_VALUE_UNOWNED;
+        return;
+    }
     enum BoltType type = BoltValue_type(value);
     if (type == BOLT_LIST || type == BOLT_STRUCTURE || type == BOLT_STRUCTURE_ARRAY || type == BOLT_REQUEST || type == BOLT_SUMMARY)
     {
@@ -86,6 +133,28 @@ void _format(struct BoltValue* value, enum BoltType type, int size, const void*
 }
 
 
+void _reserve(struct BoltValue* value, size_t unit_size, int32_t size)
+{
+    size_t capacity = value->data_size / unit_size;
+    size_t new_capacity = capacity;
+    if ((size_t)(size) > capacity)
+    {
+        // Grow by at least half again, so that repeated growth stays cheap
+        new_capacity = capacity + capacity / 2;
+        if (new_capacity < (size_t)(size)) new_capacity = (size_t)(size);
+    }
+    else if (value->data_size > RETAINED_DATA_SIZE && (size_t)(size) < capacity / SHRINK_FACTOR)
+    {
+        new_capacity = (size_t)(size);
+    }
+    if (new_capacity != capacity)
+    {
+        size_t data_size = unit_size * new_capacity;
+        value->data.extended.as_ptr = BoltMem_adjust(value->data.extended.as_ptr, value->data_size, data_size);
+        value->data_size = data_size;
+    }
+}
+
 /**
  * Resize a value that contains multiple sub-values.
  *
@@ -95,16 +164,41 @@ void _format(struct BoltValue* value, enum BoltType type, int size, const void*
  */
 void _resize(struct BoltValue* value, int32_t size, int multiplier)
 {
+    if (owns_arena(value))
+    {
+        // The nested values cannot leave the arena without it, so swap
+        // in a copy of the whole value that owns its storage outright
+        struct BoltValue copy;
+        memset(&copy, 0, sizeof(copy));
+        BoltValue_copy(value, &copy);
+        BoltValue_to_Null(value);
+        *value = copy;
+    }
+    if (BoltValue_type(value) == BOLT_DICTIONARY8)
+    {
+        // Any index is now stale, and the storage is about to leave the
+        // arena, so forget both
+        _invalidate_index(value);
+        value->data.as_ptr[1] = NULL;
+    }
+    if (value->flags & BOLT_VALUE_ARENA)
+    {
+        // Move the nested values out of the arena into storage of our own
+        // before resizing as normal.
+        size_t data_size = multiplier * sizeof_n(struct BoltValue, value->size);
+        void* data = BoltMem_allocate(data_size);
+        memcpy(data, value->data.extended.as_ptr, data_size);
+        value->data.extended.as_ptr = data;
+        value->data_size = data_size;
+        value->flags &= ~BOLT_VALUE_ARENA;
+    }
+    size_t unit_size = multiplier * sizeof(struct BoltValue);
     if (size > value->size)
     {
-        // grow physically
-        size_t unit_size = sizeof(struct BoltValue);
-        size_t new_data_size = multiplier * unit_size * size;
-        size_t old_data_size = value->data_size;
-        value->data.extended.as_ptr = BoltMem_adjust(value->data.extended.as_ptr, value->data_size, new_data_size);
-        value->data_size = new_data_size;
-        // grow logically
-        memset(value->data.extended.as_char + old_data_size, 0, new_data_size - old_data_size);
+        // grow physically, if needed
+        _reserve(value, unit_size, size);
+        // grow logically, clearing only the newly used slots
+        memset(value->data.extended.as_char + unit_size * value->size, 0, unit_size * (size - value->size));
         value->size = size;
     }
     else if (size < value->size)
@@ -115,10 +209,8 @@ void _resize(struct BoltValue* value, int32_t size, int multiplier)
             BoltValue_to_Null(&value->data.extended.as_value[i]);
         }
         value->size = size;
-        // shrink physically
-        size_t new_data_size = multiplier * sizeof_n(struct BoltValue, size);
-        value->data.extended.as_ptr = BoltMem_adjust(value->data.extended.as_ptr, value->data_size, new_data_size);
-        value->data_size = new_data_size;
+        // shrink physically, if worthwhile
+        _reserve(value, unit_size, size);
     }
     else
     {
@@ -131,6 +223,7 @@ struct BoltValue* BoltValue_create()
     size_t size = sizeof(struct BoltValue);
     struct BoltValue* value = BoltMem_allocate(size);
     _set_type(value, BOLT_NULL, 0);
+    value->flags = 0;
     value->data_size = 0;
     value->data.as_uint64[0] = 0;
     value->data.extended.as_ptr = NULL;
@@ -153,11 +246,12 @@ void BoltValue_to_List(struct BoltValue* value, int32_t size)
     }
     else
     {
-        size_t data_size = sizeof(struct BoltValue) * size;
         _recycle(value);
-        value->data.extended.as_ptr = BoltMem_adjust(value->data.extended.as_ptr, value->data_size, data_size);
-        value->data_size = data_size;
-        memset(value->data.extended.as_char, 0, data_size);
+        _reserve(value, sizeof(struct BoltValue), size);
+        if (size > 0)
+        {
+            memset(value->data.extended.as_char, 0, sizeof_n(struct BoltValue, size));
+        }
         _set_type(value, BOLT_LIST, size);
     }
 }
@@ -173,6 +267,143 @@ void BoltValue_destroy(struct BoltValue* value)
     BoltMem_deallocate(value, sizeof(struct BoltValue));
 }
 
+int BoltValue_materialise(struct BoltValue* value, struct BoltValue* target)
+{
+    if (target == value && !(value->flags & (BOLT_VALUE_VIEW | BOLT_VALUE_BORROWED)))
+    {
+        // Nothing to do: the value already holds its own data
+        return 0;
+    }
+    switch (BoltValue_type(value))
+    {
+        case BOLT_STRING8:
+            BoltValue_to_String8(target, BoltString8_get(value), value->size);
+            return 0;
+        case BOLT_BYTE_ARRAY:
+            BoltValue_to_ByteArray(target, BoltByteArray_get_all(value), value->size);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Return the number of nested values held by a container, or -1 for
+ * any other type.
+ */
+static int32_t _nested_size(const struct BoltValue* value)
+{
+    switch (BoltValue_type(value))
+    {
+        case BOLT_LIST:
+        case BOLT_STRUCTURE:
+        case BOLT_STRUCTURE_ARRAY:
+        case BOLT_REQUEST:
+        case BOLT_SUMMARY:
+            return value->size;
+        case BOLT_DICTIONARY8:
+            return 2 * value->size;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Determine whether a value and everything nested within it owns its
+ * storage outright, so that it can be moved without copying.
+ */
+static int _is_self_contained(const struct BoltValue* value)
+{
+    if (value->flags & BOLT_VALUE_UNOWNED)
+    {
+        return 0;
+    }
+    int32_t n = _nested_size(value);
+    for (int32_t i = 0; i < n; i++)
+    {
+        if (!_is_self_contained(&value->data.extended.as_value[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void BoltValue_copy(const struct BoltValue* value, struct BoltValue* target)
+{
+    if (target == value) return;
+    enum BoltType type = BoltValue_type(value);
+    int32_t n = _nested_size(value);
+    if (n >= 0)
+    {
+        // Allocate all nested values in one go, then copy each in turn
+        size_t data_size = sizeof_n(struct BoltValue, n);
+        BoltValue_to_Null(target);
+        target->data.extended.as_ptr = BoltMem_allocate(data_size);
+        target->data.as_ptr[1] = NULL;
+        target->data_size = data_size;
+        memset(target->data.extended.as_char, 0, data_size);
+        for (int32_t i = 0; i < n; i++)
+        {
+            BoltValue_copy(&value->data.extended.as_value[i], &target->data.extended.as_value[i]);
+        }
+        _set_type(target, type, value->size);
+    }
+    else if (type == BOLT_STRING8 || type == BOLT_BYTE_ARRAY)
+    {
+        // These may be views or interned, so copy by content
+        BoltValue_materialise((struct BoltValue*)(value), target);
+        target->flags |= value->flags & (BOLT_VALUE_FROZEN | BOLT_VALUE_FROZEN_V2);
+    }
+    else if (type == BOLT_STRING8_ARRAY)
+    {
+        BoltValue_to_String8Array(target, value->size);
+        for (int32_t i = 0; i < value->size; i++)
+        {
+            struct array_t string = value->data.extended.as_array[i];
+            BoltString8Array_put(target, i, string.data.as_char, string.size);
+        }
+    }
+    else
+    {
+        // Anything else is either held inline or in a single block of
+        // external storage
+        _format(target, type, value->size, value->data.extended.as_ptr, value->data_size);
+        if (value->data_size == 0)
+        {
+            memcpy(&target->data, &value->data, sizeof(value->data));
+        }
+    }
+    target->code = value->code;
+}
+
+void BoltValue_move(struct BoltValue* value, struct BoltValue* target)
+{
+    if (target == value) return;
+    if (owns_arena(value) || _is_self_contained(value))
+    {
+        BoltValue_to_Null(target);
+        *target = *value;
+        _set_type(value, BOLT_NULL, 0);
+        value->flags = 0;
+        value->code = 0;
+        value->data_size = 0;
+        value->data.extended.as_ptr = NULL;
+    }
+    else
+    {
+        BoltValue_copy(value, target);
+        BoltValue_to_Null(value);
+    }
+}
+
+void BoltValue_swap(struct BoltValue* a, struct BoltValue* b)
+{
+    struct BoltValue swap = *a;
+    *a = *b;
+    *b = swap;
+}
+
 void BoltList_resize(struct BoltValue* value, int32_t size)
 {
     assert(BoltValue_type(value) == BOLT_LIST);
@@ -273,6 +504,14 @@ int BoltValue_write(struct BoltValue * value, FILE * file, int32_t protocol_vers
             return BoltFloat64_write(value, file);
         case BOLT_FLOAT64_ARRAY:
             return BoltFloat64Array_write(value, file);
+        case BOLT_FLOAT64_PAIR:
+            return BoltFloat64Pair_write(value, file);
+        case BOLT_FLOAT64_TRIPLE:
+            return BoltFloat64Triple_write(value, file);
+        case BOLT_FLOAT64_PAIR_ARRAY:
+            return BoltFloat64PairArray_write(value, file);
+        case BOLT_FLOAT64_TRIPLE_ARRAY:
+            return BoltFloat64TripleArray_write(value, file);
         case BOLT_STRUCTURE:
             return BoltStructure_write(value, file, protocol_version);
         case BOLT_STRUCTURE_ARRAY: